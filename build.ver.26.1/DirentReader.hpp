@@ -0,0 +1,41 @@
+#pragma once
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ===== Raw Directory Reading =====
+// getdents64 record layout
+// Read every entry of an open directory (skips . and ..), callback(d_ino, d_type, name)
+struct Linux_Dirent64 {
+    std::uint64_t d_ino;
+    std::int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+// One getdents64 call into buf: > 0 more entries may follow, 0 at the end of the directory, < 0 on error
+// Lets a caller read a huge directory piece by piece (FileEntryTable.hpp streams listings this way)
+template<typename Fn>
+inline long Dirent_Read_Chunk(const int dir_fd, char* buf, const std::size_t buf_size, Fn&& callback){
+    long nread = syscall(SYS_getdents64,dir_fd,buf,buf_size);
+    for(long pos=0; pos<nread; ){
+        const auto* dirent = reinterpret_cast<const Linux_Dirent64*>(buf+pos);
+        pos += dirent->d_reclen;
+        std::string_view name(dirent->d_name);
+        if(name=="."||name=="..") continue;
+        callback(dirent->d_ino,dirent->d_type,name);
+    }
+    return nread;
+}
+template<typename Fn>
+inline bool Dirent_Read_All(const int dir_fd, Fn&& callback){
+    alignas(Linux_Dirent64) char buf[64*1024];
+    while(true){
+        long nread = Dirent_Read_Chunk(dir_fd,buf,sizeof(buf),callback);
+        if(nread<0) return false;
+        if(nread==0) return true;
+    }
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include "DirentReader.hpp"
+#include "ParallelTask.hpp"
+#include "FileRemove.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <climits>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+
+// ===== Copy Engine =====
+// Data is moved by the cheapest mechanism the filesystems allow, tried in order:
+// FICLONE reflink (no data copied) -> copy_file_range (in-kernel) -> splice through a pipe -> read/write
+// Folder trees are copied folder-parallel on the shared work queue; symlinks are recreated, never followed
+// Plain cp semantics: modes follow the umask, owners and timestamps are not preserved
+struct File_Copy_Stats{
+    std::uint64_t files = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t cloned = 0;
+    std::uint64_t failed = 0;
+    double seconds = 0;
+    double Throughput_MiB() const { return seconds>0 ? bytes/1048576.0/seconds : 0; }
+};
+// Progress callback (files copied, bytes copied), throttled like File_Remove_Report
+using File_Copy_Report = std::function<void(std::uint64_t,std::uint64_t)>;
+
+namespace File_Copy_Impl{
+    constexpr std::size_t COPY_CHUNK = 1024*1024;
+    constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds(200);
+    // FICLONE from <linux/fs.h>, spelled out: that header defines BLOCK_SIZE and clashes with Core.hpp
+    constexpr unsigned long IOCTL_FICLONE = _IOW(0x94,9,int);
+
+    // splice file -> pipe -> file; returns false without writing anything when splice is unsupported
+    inline bool Copy_Fd_Splice(const int in_fd,const int out_fd,std::uint64_t& written,bool& unsupported){
+        int pipe_fd[2];
+        if(pipe2(pipe_fd,O_CLOEXEC)!=0){ unsupported = true; return false; }
+        fcntl(pipe_fd[1],F_SETPIPE_SZ,static_cast<int>(COPY_CHUNK));
+        bool SFBoolState = true;
+        bool first = true;
+        while(true){
+            ssize_t got = splice(in_fd,nullptr,pipe_fd[1],nullptr,COPY_CHUNK,SPLICE_F_MOVE);
+            if(got==0) break;
+            if(got<0){
+                unsupported = first&&(errno==EINVAL||errno==ENOSYS);
+                SFBoolState = false;
+                break;
+            }
+            first = false;
+            for(ssize_t left=got; left>0; ){
+                ssize_t put = splice(pipe_fd[0],nullptr,out_fd,nullptr,left,SPLICE_F_MOVE);
+                if(put<=0){ SFBoolState = false; break; }
+                left -= put; written += put;
+            }
+            if(!SFBoolState) break;
+        }
+        close(pipe_fd[0]); close(pipe_fd[1]);
+        return SFBoolState;
+    }
+    // Last resort: plain read/write with one buffer per worker thread
+    inline bool Copy_Fd_Buffered(const int in_fd,const int out_fd,std::uint64_t& written){
+        thread_local std::unique_ptr<char[]> buf(new char[COPY_CHUNK]);
+        while(true){
+            ssize_t got = read(in_fd,buf.get(),COPY_CHUNK);
+            if(got==0) return true;
+            if(got<0){ if(errno==EINTR) continue; return false; }
+            for(ssize_t done=0; done<got; ){
+                ssize_t put = write(out_fd,buf.get()+done,got-done);
+                if(put<0){ if(errno==EINTR) continue; return false; }
+                done += put; written += put;
+            }
+        }
+    }
+    // Copy the whole content of in_fd into the empty out_fd (both at offset 0)
+    inline bool Copy_Fd(const int in_fd,const int out_fd,const std::uint64_t size,std::uint64_t& written,bool& cloned){
+        if(ioctl(out_fd,IOCTL_FICLONE,in_fd)==0){
+            cloned = true; written += size;
+            return true;
+        }
+        // copy_file_range until EOF; on EXDEV/ENOSYS/EINVAL the offsets are unchanged and the next method resumes
+        while(true){
+            ssize_t put = copy_file_range(in_fd,nullptr,out_fd,nullptr,COPY_CHUNK,0);
+            if(put==0) return true;
+            if(put<0) break;
+            written += put;
+        }
+        bool unsupported = false;
+        if(Copy_Fd_Splice(in_fd,out_fd,written,unsupported)) return true;
+        if(!unsupported) return false;
+        return Copy_Fd_Buffered(in_fd,out_fd,written);
+    }
+    // Copy one regular file relative to two directory fds (AT_FDCWD for absolute paths); target must not exist
+    inline bool Copy_File_At(const int src_dir,const char* src_name,const int dst_dir,const char* dst_name,std::uint64_t& written,bool& cloned){
+        int in_fd = openat(src_dir,src_name,O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+        if(in_fd<0) return false;
+        struct stat st{};
+        if(fstat(in_fd,&st)!=0||!S_ISREG(st.st_mode)){ close(in_fd); return false; }
+        int out_fd = openat(dst_dir,dst_name,O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC,st.st_mode&07777);
+        if(out_fd<0){ close(in_fd); return false; }
+        std::uint64_t copied = 0;
+        bool SFBoolState = Copy_Fd(in_fd,out_fd,st.st_size,copied,cloned);
+        written += copied;
+        if(close(out_fd)!=0) SFBoolState = false;
+        close(in_fd);
+        if(!SFBoolState) unlinkat(dst_dir,dst_name,0);
+        return SFBoolState;
+    }
+    // Recreate a symlink with the same target text
+    inline bool Copy_Link_At(const int src_dir,const char* src_name,const int dst_dir,const char* dst_name){
+        char link_target[PATH_MAX];
+        ssize_t len = readlinkat(src_dir,src_name,link_target,sizeof(link_target)-1);
+        if(len<0) return false;
+        link_target[len] = '\0';
+        return symlinkat(link_target,dst_dir,dst_name)==0;
+    }
+
+    struct Copy_Task{
+        std::string source;
+        std::string target;
+    };
+
+    class Copy_Engine{
+        Parallel_Work_Queue<Copy_Task> queue;
+        const File_Copy_Report& report;
+        std::atomic<std::uint64_t> files = 0;
+        std::atomic<std::uint64_t> bytes = 0;
+        std::atomic<std::uint64_t> cloned = 0;
+        std::atomic<std::uint64_t> failed = 0;
+        std::mutex report_mtx;
+        std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+        void Progress_Report(){
+            if(!report) return;
+            std::unique_lock lock(report_mtx,std::try_to_lock);
+            if(!lock.owns_lock()) return;
+            auto now = std::chrono::steady_clock::now();
+            if(now-last_report<PROGRESS_INTERVAL) return;
+            last_report = now;
+            report(files,bytes);
+        }
+        // Sub-folders are created here and become tasks; files and links are copied by the worker that found them
+        void Folder_Copy(const Copy_Task& task){
+            int src_fd = open(task.source.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            int dst_fd = open(task.target.c_str(),O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+            if(src_fd<0||dst_fd<0){
+                failed++;
+                if(src_fd>=0) close(src_fd);
+                if(dst_fd>=0) close(dst_fd);
+                return;
+            }
+            std::vector<std::pair<std::string,unsigned char>> entries;
+            if(!Dirent_Read_All(src_fd,[&entries](std::uint64_t,unsigned char d_type,std::string_view name){
+                entries.emplace_back(std::string(name),d_type);
+            })) failed++;
+
+            for(auto& [name,d_type]: entries){
+                struct stat st{};
+                if(d_type==DT_DIR||d_type==DT_UNKNOWN){
+                    if(fstatat(src_fd,name.c_str(),&st,AT_SYMLINK_NOFOLLOW)!=0){ failed++; continue; }
+                    d_type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+                }
+                if(d_type==DT_DIR){
+                    // Owner keeps write access so the copy can be filled
+                    if(mkdirat(dst_fd,name.c_str(),(st.st_mode&07777)|S_IRWXU)==0) queue.Push(Copy_Task{task.source+"/"+name,task.target+"/"+name});
+                    else failed++;
+                    continue;
+                }
+                std::uint64_t written = 0;
+                bool file_cloned = false;
+                bool SFBoolState = d_type==DT_REG ? Copy_File_At(src_fd,name.c_str(),dst_fd,name.c_str(),written,file_cloned)
+                    : d_type==DT_LNK ? Copy_Link_At(src_fd,name.c_str(),dst_fd,name.c_str())
+                    : false;
+                if(SFBoolState) files++;
+                else failed++;
+                if(file_cloned) cloned++;
+                bytes += written;
+                Progress_Report();
+            }
+            close(src_fd);
+            close(dst_fd);
+        }
+    public:
+        explicit Copy_Engine(const File_Copy_Report& _report): report(_report) {}
+
+        File_Copy_Stats Run(const std::filesystem::path source_folder,const std::filesystem::path target_folder,const unsigned workers){
+            queue.Push(Copy_Task{source_folder.string(),target_folder.string()});
+            queue.Run(Parallel_Worker_Count(workers),[this](Copy_Task& task){ Folder_Copy(task); });
+            if(report) report(files,bytes);
+            return File_Copy_Stats{files,bytes,cloned,failed,0};
+        }
+    };
+};
+
+// Copy a file, symlink or whole folder tree to target_path (which must not exist yet)
+// A folder is never copied into itself; workers = 0 uses the hardware thread count
+inline File_Copy_Stats File_Copy_Parallel(const std::filesystem::path source_path,const std::filesystem::path target_path,
+    const File_Copy_Report& report = nullptr,const unsigned workers = 0){
+    auto begin = std::chrono::steady_clock::now();
+    File_Copy_Stats stats;
+    struct stat st{}, target_st{};
+    if(lstat(source_path.c_str(),&st)!=0||lstat(target_path.c_str(),&target_st)==0){
+        stats.failed = 1;
+        return stats;
+    }
+    if(S_ISDIR(st.st_mode)){
+        std::error_code ec;
+        auto source_abs = std::filesystem::weakly_canonical(source_path,ec);
+        auto target_abs = std::filesystem::weakly_canonical(target_path,ec);
+        auto [src_end,tgt_it] = std::mismatch(source_abs.begin(),source_abs.end(),target_abs.begin(),target_abs.end());
+        if(ec||src_end==source_abs.end()||mkdir(target_path.c_str(),(st.st_mode&07777)|S_IRWXU)!=0){
+            stats.failed = 1;
+            return stats;
+        }
+        File_Copy_Impl::Copy_Engine engine(report);
+        stats = engine.Run(source_path,target_path,workers);
+    }else{
+        bool cloned = false;
+        bool SFBoolState = S_ISREG(st.st_mode) ? File_Copy_Impl::Copy_File_At(AT_FDCWD,source_path.c_str(),AT_FDCWD,target_path.c_str(),stats.bytes,cloned)
+            : S_ISLNK(st.st_mode) ? File_Copy_Impl::Copy_Link_At(AT_FDCWD,source_path.c_str(),AT_FDCWD,target_path.c_str())
+            : false;
+        if(SFBoolState) stats.files = 1;
+        else stats.failed = 1;
+        if(cloned) stats.cloned = 1;
+        if(report) report(stats.files,stats.bytes);
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
+
+// ===== Move =====
+// rename() within one filesystem; across devices (EXDEV) copy, then remove the source only if the copy is complete
+inline bool File_Move_Path(const std::filesystem::path source_path,const std::filesystem::path target_path,
+    const File_Copy_Report& report = nullptr,const unsigned workers = 0){
+    struct stat target_st{};
+    if(lstat(target_path.c_str(),&target_st)==0) return false;
+    if(std::rename(source_path.c_str(),target_path.c_str())==0) return true;
+    if(errno!=EXDEV) return false;
+
+    File_Copy_Stats stats = File_Copy_Parallel(source_path,target_path,report,workers);
+    if(stats.failed!=0){
+        File_Remove_Parallel(target_path);
+        return false;
+    }
+    return File_Remove_Parallel(source_path,nullptr,workers);
+}
@@ -0,0 +1,291 @@
+#pragma once
+#include "GeneralFileOper.hpp"
+#include "DirentReader.hpp"
+#include "Utf8Width.hpp"
+#include "ParallelTask.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <atomic>
+#include <optional>
+#include <mutex>
+#include <thread>
+#include <stop_token>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// ===== Permissions From Mode =====
+// Format st_mode as Linux style permissions (e.g., drwxr-xr-x) without touching the filesystem
+inline std::string File_Permission_Mode_Format(const std::uint32_t mode){
+    std::string s(10,'-');
+    if(S_ISDIR(mode)) s[0] = 'd';
+    else if(S_ISLNK(mode)) s[0] = 'l';
+    const char flag[] = {'r','w','x'};
+    for(int bit=0; bit<9; bit++)
+        if(mode&(0400>>bit)) s[1+bit] = flag[bit%3];
+    return s;
+}
+
+// ===== Compact Entry Table =====
+// One folder listing as struct-of-arrays: names live in a single arena,
+// d_type comes from getdents64, mode/size/mtime come from one statx per entry,
+// filled lazily so only rows that are actually shown pay for a stat
+// Load_Start reads up to LOAD_SYNC_ENTRIES at once (a usual folder in full, a huge one past its first screen)
+// and leaves the rest to a loader thread that stages every further buffer; the UI thread merges staged entries
+// with Load_Merge, so entries only ever get appended and an index stays valid while the listing grows
+// The usage column (tree size of sub-folders) is written by the background worker in FolderUsageCache.hpp
+class File_Entry_Table{
+    enum : std::uint8_t {Stat_Done = 1, Stat_Failed = 2};
+
+    std::filesystem::path folder;
+    int dir_fd = -1;
+    std::string name_arena;
+    std::vector<std::uint32_t> name_offset;
+    std::vector<std::uint16_t> name_length;
+    std::vector<std::uint8_t> dtype;
+    std::vector<std::uint8_t> stat_state;
+    std::vector<std::uint32_t> mode;
+    std::vector<std::uint64_t> size_bytes;
+    std::vector<std::int64_t> mtime;
+    std::vector<std::int32_t> width;
+    std::wstring wname_arena;
+    std::vector<std::uint32_t> wname_offset;
+    std::vector<std::uint32_t> wname_length;
+    std::vector<std::atomic<std::uint64_t>> usage_bytes;
+    std::atomic<bool> usage_requested = false;
+    std::uint64_t stat_generation = 0;
+    bool stat_links = false;
+
+    static constexpr std::uint64_t Usage_Pending = UINT64_MAX;
+    static constexpr std::size_t DIRENT_BUF = 64*1024;
+    static constexpr std::size_t LOAD_SYNC_ENTRIES = 16384;
+
+    // Entries the loader read but the UI thread has not merged yet
+    struct Load_Staged{
+        std::string names;
+        std::vector<std::uint16_t> lengths;
+        std::vector<std::uint8_t> dtypes;
+    };
+    std::mutex load_mtx;
+    Load_Staged load_staged;
+    std::atomic<bool> load_running = false;
+    bool load_finished = true;
+    bool load_cancelled = false;
+    inline static std::atomic<std::uint64_t> load_generation = 0;
+    std::jthread loader;
+
+    void Entry_Append(const std::string_view name, const unsigned char d_type){
+        name_offset.push_back(name_arena.size());
+        name_length.push_back(name.size());
+        name_arena.append(name);
+        dtype.push_back(d_type);
+    }
+    // Per-entry slots for entries appended since the last call; earlier slots keep their values
+    void Entry_Slots_Grow(){
+        std::size_t count = name_offset.size();
+        stat_state.resize(count,0);
+        mode.resize(count,0); size_bytes.resize(count,0); mtime.resize(count,0);
+        width.resize(count,-1);
+        // A decoded name is never longer than its UTF-8 bytes: reserving here keeps views into the arena valid
+        // until the next merge
+        wname_arena.reserve(name_arena.size());
+        wname_offset.resize(count,UINT32_MAX); wname_length.resize(count,0);
+    }
+    // The usage column is created once the entry count is final (the usage worker reads it from its own thread)
+    void Load_Finish(){
+        if(loader.joinable()) loader.join();
+        usage_bytes = std::vector<std::atomic<std::uint64_t>>(size());
+        for(auto& usage: usage_bytes) usage = Usage_Pending;
+        load_finished = true;
+    }
+    void Loader_Run(const std::stop_token stop){
+        alignas(Linux_Dirent64) char buf[DIRENT_BUF];
+        Load_Staged batch;
+        while(!stop.stop_requested()){
+            long nread = Dirent_Read_Chunk(dir_fd,buf,sizeof(buf),[&batch](std::uint64_t, unsigned char d_type, std::string_view name){
+                batch.names.append(name);
+                batch.lengths.push_back(name.size());
+                batch.dtypes.push_back(d_type);
+            });
+            if(nread<=0) break;
+            {
+                std::lock_guard lock(load_mtx);
+                load_staged.names.append(batch.names);
+                load_staged.lengths.insert(load_staged.lengths.end(),batch.lengths.begin(),batch.lengths.end());
+                load_staged.dtypes.insert(load_staged.dtypes.end(),batch.dtypes.begin(),batch.dtypes.end());
+            }
+            batch.names.clear(); batch.lengths.clear(); batch.dtypes.clear();
+            load_generation++;
+            Parallel_Progress_Event::instance().Notify();
+        }
+        load_running.store(false,std::memory_order_release);
+        load_generation++;
+        Parallel_Progress_Event::instance().Notify();
+    }
+public:
+    File_Entry_Table() = default;
+    File_Entry_Table(const File_Entry_Table&) = delete;
+    File_Entry_Table& operator=(const File_Entry_Table&) = delete;
+    ~File_Entry_Table(){
+        // The loader reads through dir_fd: stop it before the descriptor goes away
+        if(loader.joinable()){ loader.request_stop(); loader.join(); }
+        if(dir_fd>=0) close(dir_fd);
+    }
+
+    // Open the folder and read its first entries (no stat); a loader thread reads the rest
+    // False when it cannot be opened
+    bool Load_Start(const std::filesystem::path source_path){
+        folder = source_path;
+        dir_fd = open(source_path.c_str(),O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+        if(dir_fd<0){ Load_Finish(); return false; }
+        alignas(Linux_Dirent64) char buf[DIRENT_BUF];
+        long nread;
+        do{
+            nread = Dirent_Read_Chunk(dir_fd,buf,sizeof(buf),[this](std::uint64_t, unsigned char d_type, std::string_view name){
+                Entry_Append(name,d_type);
+            });
+        }while(nread>0&&size()<LOAD_SYNC_ENTRIES);
+        Entry_Slots_Grow();
+        if(nread<=0){ Load_Finish(); return nread==0; }
+        load_finished = false;
+        load_running = true;
+        loader = std::jthread([this](std::stop_token stop){ Loader_Run(stop); });
+        return true;
+    }
+    // Append what the loader staged so far (UI thread only); ends the load once the loader is done
+    void Load_Merge(){
+        if(load_finished) return;
+        bool running = load_running.load(std::memory_order_acquire);
+        Load_Staged batch;
+        {
+            std::lock_guard lock(load_mtx);
+            std::swap(batch,load_staged);
+        }
+        name_arena.reserve(name_arena.size()+batch.names.size());
+        for(std::size_t idx=0, pos=0; idx<batch.lengths.size(); pos+=batch.lengths[idx], idx++)
+            Entry_Append(std::string_view(batch.names).substr(pos,batch.lengths[idx]),batch.dtypes[idx]);
+        Entry_Slots_Grow();
+        if(!running) Load_Finish();
+    }
+    // Stop a load in progress, keeping the entries read so far; false when there was nothing to stop
+    bool Load_Cancel(){
+        if(load_finished||load_cancelled) return false;
+        loader.request_stop();
+        load_cancelled = true;
+        return true;
+    }
+    // Block until every entry is read
+    void Load_Wait(){
+        if(load_finished) return;
+        loader.join();
+        Load_Merge();
+    }
+    bool Load_Done() const { return load_finished; }
+    bool Loading() const { return !load_finished&&!load_cancelled; }
+    bool Load_Cancelled() const { return load_cancelled; }
+    // Changes whenever a loader staged entries or finished (any listing); the event loop redraws on change
+    static std::uint64_t Load_Generation(){ return load_generation; }
+
+    std::size_t size() const { return name_offset.size(); }
+    bool empty() const { return name_offset.empty(); }
+    const std::filesystem::path& Folder() const { return folder; }
+    std::string_view Entry_Name(const std::size_t idx) const {
+        return std::string_view(name_arena).substr(name_offset[idx],name_length[idx]);
+    }
+    std::filesystem::path Entry_Path(const std::size_t idx) const { return folder/Entry_Name(idx); }
+
+    // Symlinks report their own mode, size and mtime from now on (ls -l), not their target's
+    void Stat_Links_Own(){ stat_links = true; }
+    // One statx per entry (follows symlinks like std::filesystem::status unless Stat_Links_Own was called;
+    // dangling links fall back to lstat data)
+    void Entry_Stat(const std::size_t idx){
+        if(stat_state[idx]) return;
+        std::string name(Entry_Name(idx));
+        struct statx stx{};
+        unsigned mask = STATX_TYPE|STATX_MODE|STATX_SIZE|STATX_MTIME;
+        if(statx(dir_fd,name.c_str(),(stat_links ? AT_SYMLINK_NOFOLLOW : 0)|AT_STATX_SYNC_AS_STAT,mask,&stx)!=0
+            &&statx(dir_fd,name.c_str(),AT_SYMLINK_NOFOLLOW|AT_STATX_SYNC_AS_STAT,mask,&stx)!=0){
+            stat_state[idx] = Stat_Done|Stat_Failed;
+            return;
+        }
+        mode[idx] = stx.stx_mode;
+        size_bytes[idx] = stx.stx_size;
+        mtime[idx] = stx.stx_mtime.tv_sec;
+        stat_state[idx] = Stat_Done;
+    }
+    // Stat [first,last) up front on every hardware thread (sorting by size or time needs all of them);
+    // each worker owns a contiguous slice, so no slot is written by two threads
+    void Entry_Stat_Range(const std::size_t first, const std::size_t last){
+        constexpr std::size_t SLICE_MIN = 4096;
+        std::size_t count = last>first ? last-first : 0;
+        std::size_t workers = std::min<std::size_t>(Parallel_Worker_Count(),count/SLICE_MIN+1);
+        std::size_t slice = (count+workers-1)/workers;
+        std::vector<std::jthread> threads;
+        for(std::size_t worker=1; worker<workers; worker++){
+            std::size_t begin = first+worker*slice, end = std::min(last,begin+slice);
+            threads.emplace_back([this,begin,end]{ for(std::size_t idx=begin; idx<end; idx++) Entry_Stat(idx); });
+        }
+        for(std::size_t idx=first; idx<std::min(last,first+slice); idx++) Entry_Stat(idx);
+    }
+    // Drop the stat data of the named entries (a write to them ended): the next use stats just those again
+    void Entry_Stat_Forget(const std::unordered_set<std::string_view>& names){
+        bool forgot = false;
+        for(std::size_t idx=0; idx<stat_state.size(); idx++)
+            if(stat_state[idx]&&names.contains(Entry_Name(idx))){ stat_state[idx] = 0; forgot = true; }
+        if(forgot) stat_generation++;
+    }
+    // Changes whenever Entry_Stat_Forget dropped something (orders by size or time are stale then)
+    std::uint64_t Stat_Generation() const { return stat_generation; }
+    std::uint32_t Entry_Mode(const std::size_t idx){ Entry_Stat(idx); return mode[idx]; }
+    std::uint64_t Entry_Size(const std::size_t idx){ Entry_Stat(idx); return size_bytes[idx]; }
+    std::int64_t Entry_Mtime(const std::size_t idx){ Entry_Stat(idx); return mtime[idx]; }
+    unsigned char Entry_DType(const std::size_t idx) const { return dtype[idx]; }
+    // What a symlink entry points to (empty when it is none or cannot be read)
+    std::string Entry_Link_Target(const std::size_t idx) const {
+        std::string name(Entry_Name(idx));
+        char target[PATH_MAX];
+        ssize_t len = readlinkat(dir_fd,name.c_str(),target,sizeof(target));
+        return len>0 ? std::string(target,len) : std::string();
+    }
+    // Tree usage in bytes once the background worker stored it (thread safe)
+    std::optional<std::uint64_t> Entry_Usage(const std::size_t idx) const {
+        if(idx>=usage_bytes.size()) return std::nullopt;
+        std::uint64_t usage = usage_bytes[idx].load(std::memory_order_relaxed);
+        if(usage==Usage_Pending) return std::nullopt;
+        return usage;
+    }
+    void Entry_Usage_Store(const std::size_t idx,const std::uint64_t usage){ usage_bytes[idx].store(usage,std::memory_order_relaxed); }
+    // True for the first caller only, so a listing is queued for sizing once
+    bool Usage_Request(){ return !usage_requested.exchange(true); }
+    void Usage_Request_Reset(){ usage_requested = false; }
+    // Directory check from d_type; only symlinks and unknown types need a stat
+    bool Entry_Is_Directory(const std::size_t idx){
+        if(dtype[idx]==DT_DIR) return true;
+        if(dtype[idx]!=DT_LNK&&dtype[idx]!=DT_UNKNOWN) return false;
+        return S_ISDIR(Entry_Mode(idx));
+    }
+    // Wide name for drawing, decoded once into the wide arena (invalid UTF-8 shows as U+FFFD)
+    // Terminal display width of the name, computed once
+    std::wstring_view Entry_WName(const std::size_t idx){
+        if(wname_offset[idx]==UINT32_MAX){
+            wname_offset[idx] = wname_arena.size();
+            Utf8_Decode_Append(Entry_Name(idx),wname_arena);
+            wname_length[idx] = wname_arena.size()-wname_offset[idx];
+        }
+        return std::wstring_view(wname_arena).substr(wname_offset[idx],wname_length[idx]);
+    }
+    int Entry_Width(const std::size_t idx){
+        if(width[idx]<0) width[idx] = WString_View_Cols_Count(Entry_WName(idx));
+        return width[idx];
+    }
+};
@@ -0,0 +1,266 @@
+#pragma once
+#include "FileEntryTable.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// ===== Sort Modes =====
+// Directory keeps getdents64 order; Size and Mtime put the largest / newest first (like ls -S / ls -t)
+// Natural compares digit runs by value and ignores ASCII case; Type puts folders first, then groups by extension
+enum class File_Sort_Mode{Directory,Name,Natural,Size,Mtime,Type};
+constexpr int FILE_SORT_MODES = 6;
+inline const char* File_Sort_Mode_Name(const File_Sort_Mode mode){
+    switch(mode){
+        case File_Sort_Mode::Name: return "name";
+        case File_Sort_Mode::Natural: return "natural";
+        case File_Sort_Mode::Size: return "size";
+        case File_Sort_Mode::Mtime: return "time";
+        case File_Sort_Mode::Type: return "type";
+        default: return "directory";
+    }
+}
+inline File_Sort_Mode File_Sort_Mode_Next(const File_Sort_Mode mode){
+    return static_cast<File_Sort_Mode>((static_cast<int>(mode)+1)%FILE_SORT_MODES);
+}
+
+// ===== Substring Matching =====
+// ASCII lower-casing; UTF-8 bytes past 0x7F are left alone, so folding never changes a length
+inline char Ascii_Fold(const char ch){ return ch>='A'&&ch<='Z' ? ch-'A'+'a' : ch; }
+// True when needle occurs in hay[0,hay_len); hay must stay readable 15 bytes past hay_len (callers pad their arena)
+// SSE2 compares 16 start positions at once against the first and last needle byte and only checks those candidates
+inline bool Substring_Contains_Padded(const char* hay, const std::size_t hay_len, const std::string_view needle){
+    const std::size_t len = needle.size();
+    if(len==0) return true;
+    if(len>hay_len) return false;
+#if defined(__SSE2__)
+    const __m128i first = _mm_set1_epi8(needle.front()), last = _mm_set1_epi8(needle.back());
+    for(std::size_t pos=0; pos+len<=hay_len; pos+=16){
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay+pos));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay+pos+len-1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first,block_first),_mm_cmpeq_epi8(last,block_last)));
+        // Start positions past hay_len-len would run off the end of this name
+        if(std::size_t starts = hay_len-len-pos+1; starts<16) mask &= (1u<<starts)-1;
+        for(; mask!=0; mask &= mask-1)
+            if(std::memcmp(hay+pos+__builtin_ctz(mask),needle.data(),len)==0) return true;
+    }
+    return false;
+#else
+    return std::string_view(hay,hay_len).find(needle)!=std::string_view::npos;
+#endif
+}
+
+// ===== Sorted And Filtered View =====
+// Rows of a File_Entry_Table in sort order, narrowed by a filter; the table itself is never reordered
+// Sort keys are computed once per entry: a 16-byte big-endian prefix decides most comparisons and is sorted
+// next to the index (no indirection), the full key (natural / type modes) or the name breaks ties
+// The filter is a list of space separated terms, each matched as a case-insensitive substring of the name;
+// names are tested in table order (sequential over the folded arena) into a per-entry flag, and a query
+// that extends the previous one only re-checks the entries that matched before
+// A table still loading is followed: new entries are keyed, sorted and merged in, so a refresh costs O(new + rows)
+class File_Entry_View{
+    static constexpr std::size_t ARENA_PAD = 16;
+    struct Sort_Prefix{
+        std::uint64_t high = 0;
+        std::uint64_t low = 0;
+        auto operator<=>(const Sort_Prefix&) const = default;
+    };
+
+    std::shared_ptr<File_Entry_Table> table;
+    File_Sort_Mode mode = File_Sort_Mode::Directory;
+    std::size_t seen = 0;
+    std::uint64_t stat_generation = 0;
+    std::vector<std::uint32_t> order;
+    std::vector<std::uint32_t> rows;
+    std::vector<std::uint8_t> matched;
+
+    std::vector<Sort_Prefix> key_prefix;
+    std::string key_arena;
+    std::vector<std::uint32_t> key_offset;
+    std::string folded_arena;
+    std::vector<std::uint32_t> folded_offset;
+
+    std::string query;
+    std::vector<std::string> terms;
+
+    static Sort_Prefix Prefix_Of(const std::string_view key){
+        Sort_Prefix prefix;
+        for(std::size_t idx=0; idx<16; idx++){
+            std::uint64_t& half = idx<8 ? prefix.high : prefix.low;
+            half = half<<8|(idx<key.size() ? static_cast<unsigned char>(key[idx]) : 0);
+        }
+        return prefix;
+    }
+    // Natural key: folded text, every digit run as '0', its length without leading zeros, then the digits
+    static void Natural_Key_Append(const std::string_view name, std::string& key){
+        for(std::size_t idx=0; idx<name.size(); ){
+            if(name[idx]<'0'||name[idx]>'9'){ key.push_back(Ascii_Fold(name[idx++])); continue; }
+            while(idx+1<name.size()&&name[idx]=='0'&&name[idx+1]>='0'&&name[idx+1]<='9') idx++;
+            std::size_t end = idx;
+            while(end<name.size()&&name[end]>='0'&&name[end]<='9') end++;
+            key.push_back('0');
+            key.push_back(static_cast<char>(std::min<std::size_t>(end-idx,255)));
+            key.append(name.substr(idx,end-idx));
+            idx = end;
+        }
+    }
+    std::string_view Key(const std::uint32_t entry) const {
+        return std::string_view(key_arena).substr(key_offset[entry],key_offset[entry+1]-key_offset[entry]);
+    }
+    std::string_view Folded(const std::uint32_t entry) const {
+        return std::string_view(folded_arena).substr(folded_offset[entry],folded_offset[entry+1]-folded_offset[entry]);
+    }
+
+    // Keys and folded names for entries [seen, table size); stats first where the mode needs them
+    void Keys_Extend(const std::size_t first, const std::size_t last){
+        if(mode==File_Sort_Mode::Size||mode==File_Sort_Mode::Mtime) table->Entry_Stat_Range(first,last);
+        folded_arena.resize(folded_arena.size()-ARENA_PAD);
+        if(folded_offset.empty()) folded_offset.push_back(0);
+        if(key_offset.empty()) key_offset.push_back(0);
+        for(std::size_t idx=first; idx<last; idx++){
+            std::string_view name = table->Entry_Name(idx);
+            for(const char ch: name) folded_arena.push_back(Ascii_Fold(ch));
+            folded_offset.push_back(folded_arena.size());
+
+            Sort_Prefix prefix;
+            std::size_t key_begin = key_arena.size();
+            switch(mode){
+                case File_Sort_Mode::Name: prefix = Prefix_Of(name); break;
+                // Equal sizes / times fall back to the name, whose first bytes ride along in the low half
+                case File_Sort_Mode::Size: prefix = {table->Entry_Size(idx),Prefix_Of(name).high}; break;
+                case File_Sort_Mode::Mtime:
+                    prefix = {static_cast<std::uint64_t>(table->Entry_Mtime(idx))^(1ull<<63),Prefix_Of(name).high};
+                    break;
+                case File_Sort_Mode::Natural: Natural_Key_Append(name,key_arena); break;
+                case File_Sort_Mode::Type:{
+                    bool folder = table->Entry_Is_Directory(idx);
+                    key_arena.push_back(folder ? '0' : '1');
+                    std::size_t dot = name.rfind('.');
+                    if(!folder&&dot!=std::string_view::npos&&dot!=0)
+                        for(const char ch: name.substr(dot+1)) key_arena.push_back(Ascii_Fold(ch));
+                    key_arena.push_back('\0');
+                    Natural_Key_Append(name,key_arena);
+                    break;
+                }
+                default: break;
+            }
+            if(key_arena.size()>key_begin) prefix = Prefix_Of(std::string_view(key_arena).substr(key_begin));
+            key_prefix.push_back(prefix);
+            key_offset.push_back(key_arena.size());
+        }
+        folded_arena.append(ARENA_PAD,'\0');
+    }
+    bool Prefix_Less(const Sort_Prefix& lhs, const Sort_Prefix& rhs) const {
+        if(mode==File_Sort_Mode::Size||mode==File_Sort_Mode::Mtime)
+            return lhs.high!=rhs.high ? lhs.high>rhs.high : lhs.low<rhs.low;
+        return lhs<rhs;
+    }
+    // Order of two entries whose prefixes are equal
+    bool Entry_Tie_Less(const std::uint32_t lhs, const std::uint32_t rhs) const {
+        if(int cmp = Key(lhs).compare(Key(rhs)); cmp!=0) return cmp<0;
+        if(int cmp = table->Entry_Name(lhs).compare(table->Entry_Name(rhs)); cmp!=0) return cmp<0;
+        return lhs<rhs;
+    }
+    bool Entry_Less(const std::uint32_t lhs, const std::uint32_t rhs) const {
+        if(mode==File_Sort_Mode::Directory) return lhs<rhs;
+        if(key_prefix[lhs]!=key_prefix[rhs]) return Prefix_Less(key_prefix[lhs],key_prefix[rhs]);
+        return Entry_Tie_Less(lhs,rhs);
+    }
+    bool Entry_Matches(const std::uint32_t entry) const {
+        std::string_view name = Folded(entry);
+        for(const auto& term: terms)
+            if(!Substring_Contains_Padded(name.data(),name.size(),term)) return false;
+        return true;
+    }
+    // Sort entries [first,last) and merge them into order (and into rows when they pass the filter)
+    void Entries_Merge(const std::size_t first, const std::size_t last){
+        auto less = [this](const std::uint32_t lhs, const std::uint32_t rhs){ return Entry_Less(lhs,rhs); };
+        std::vector<std::uint32_t> fresh(last-first);
+        if(mode==File_Sort_Mode::Directory){
+            for(std::size_t idx=first; idx<last; idx++) fresh[idx-first] = idx;
+        }else{
+            std::vector<std::pair<Sort_Prefix,std::uint32_t>> keyed(last-first);
+            for(std::size_t idx=first; idx<last; idx++) keyed[idx-first] = {key_prefix[idx],static_cast<std::uint32_t>(idx)};
+            std::sort(keyed.begin(),keyed.end(),[this](const auto& lhs, const auto& rhs){
+                if(lhs.first!=rhs.first) return Prefix_Less(lhs.first,rhs.first);
+                return Entry_Tie_Less(lhs.second,rhs.second);
+            });
+            for(std::size_t idx=0; idx<keyed.size(); idx++) fresh[idx] = keyed[idx].second;
+        }
+
+        std::size_t order_mid = order.size();
+        order.insert(order.end(),fresh.begin(),fresh.end());
+        std::inplace_merge(order.begin(),order.begin()+order_mid,order.end(),less);
+
+        matched.resize(last);
+        for(std::size_t idx=first; idx<last; idx++) matched[idx] = Entry_Matches(idx);
+        std::size_t rows_mid = rows.size();
+        for(const auto entry: fresh) if(matched[entry]) rows.push_back(entry);
+        std::inplace_merge(rows.begin(),rows.begin()+rows_mid,rows.end(),less);
+    }
+    void Rebuild(){
+        seen = 0;
+        order.clear(); rows.clear(); matched.clear();
+        key_prefix.clear(); key_arena.clear(); key_offset.clear();
+        folded_arena.assign(ARENA_PAD,'\0'); folded_offset.clear();
+    }
+public:
+    // Follow table (a reloaded listing starts over) in the given sort mode; cheap when nothing changed
+    void Refresh(const std::shared_ptr<File_Entry_Table>& _table, const File_Sort_Mode _mode){
+        bool stat_keyed = _mode==File_Sort_Mode::Size||_mode==File_Sort_Mode::Mtime;
+        if(table!=_table||mode!=_mode||(stat_keyed&&stat_generation!=_table->Stat_Generation())){
+            table = _table; mode = _mode;
+            stat_generation = table->Stat_Generation();
+            Rebuild();
+        }
+        std::size_t total = table->size();
+        if(seen==total) return;
+        Keys_Extend(seen,total);
+        Entries_Merge(seen,total);
+        seen = total;
+    }
+    // Narrow to entries matching every space separated term of text (UTF-8, matched case-insensitively)
+    void Filter_Set(const std::string_view text){
+        std::string folded;
+        for(const char ch: text) folded.push_back(Ascii_Fold(ch));
+        if(folded==query) return;
+        bool narrowing = !query.empty()&&folded.starts_with(query);
+        query = std::move(folded);
+        terms.clear();
+        for(std::size_t pos=0; pos<query.size(); ){
+            std::size_t end = query.find(' ',pos);
+            if(end==std::string::npos) end = query.size();
+            if(end>pos) terms.emplace_back(query.substr(pos,end-pos));
+            pos = end+1;
+        }
+        // Every entry matching the longer query matched the shorter one: only those are checked again
+        for(std::size_t idx=0; idx<matched.size(); idx++)
+            if(matched[idx]||!narrowing) matched[idx] = Entry_Matches(idx);
+        if(narrowing) std::erase_if(rows,[this](const std::uint32_t entry){ return !matched[entry]; });
+        else{
+            rows.clear();
+            for(const auto entry: order) if(matched[entry]) rows.push_back(entry);
+        }
+    }
+    const std::string& Filter() const { return query; }
+
+    std::size_t size() const { return rows.size(); }
+    bool empty() const { return rows.empty(); }
+    std::size_t Entries_Total() const { return order.size(); }
+    // Table index shown on a row
+    std::size_t Entry(const std::size_t row) const { return rows[row]; }
+    // Row showing a table index, size() when it is filtered out
+    std::size_t Row_Of(const std::size_t entry) const {
+        return std::find(rows.begin(),rows.end(),entry)-rows.begin();
+    }
+    File_Entry_Table& Table() const { return *table; }
+};
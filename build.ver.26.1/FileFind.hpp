@@ -0,0 +1,225 @@
+#pragma once
+#include "DirentReader.hpp"
+#include "ParallelTask.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <utility>
+#include <cstdlib>
+#include <ctime>
+#include <cctype>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+
+// ===== Parallel Find =====
+// find(1)-style filters: -name/-iname glob on the entry name, -regex on the full path,
+// -type f|d|l, -size [+-]N[c|k|M|G], -mtime [+-]N (days)
+// Folders are read with getdents64 on the shared work queue; every sub-folder is opened with openat relative to
+// its parent's dirfd (O_NOFOLLOW), so the walk never resolves a full path again and cannot be led out of the tree
+// by a folder swapped for a symlink. Matches are printed under the root as it was given. An entry is only stat'ed
+// when -size/-mtime need it (or the filesystem reports no d_type). Symlinks are never followed
+struct File_Find_Compare{
+    bool active = false;
+    int sign = 0;
+    std::int64_t value = 0;
+    // +N greater than N, -N less than N, N exactly N
+    bool Match(const std::int64_t x) const { return !active||(sign>0 ? x>value : sign<0 ? x<value : x==value); }
+};
+struct File_Find_Filter{
+    std::string name_glob;
+    bool name_icase = false;
+    std::optional<std::regex> path_regex;
+    char type = 0;
+    File_Find_Compare size;
+    std::int64_t size_unit = 1;
+    File_Find_Compare mtime;
+
+    bool Stat_Needed() const { return size.active||mtime.active; }
+};
+struct File_Find_Stats{
+    std::uint64_t matched = 0;
+    std::uint64_t scanned = 0;
+    std::uint64_t failed = 0;
+    double seconds = 0;
+};
+// Called once per match (serialised, in discovery order per folder); return false to stop the search
+using File_Find_Report = std::function<bool(const std::string&)>;
+
+// ===== Filter Parsing =====
+// "[+-]N[suffix]" into a compare; unit receives the suffix multiplier when units are allowed
+inline bool File_Find_Compare_Parse(std::string text,File_Find_Compare& compare,std::int64_t* unit){
+    compare = File_Find_Compare{true,0,0};
+    if(!text.empty()&&(text[0]=='+'||text[0]=='-')){ compare.sign = text[0]=='+' ? 1 : -1; text.erase(0,1); }
+    if(unit!=nullptr&&!text.empty()&&!std::isdigit(static_cast<unsigned char>(text.back()))){
+        switch(text.back()){
+            case 'c': *unit = 1; break;
+            case 'k': *unit = 1024; break;
+            case 'M': *unit = 1024*1024; break;
+            case 'G': *unit = 1024*1024*1024; break;
+            default: return false;
+        }
+        text.pop_back();
+    }
+    if(text.empty()||text.find_first_not_of("0123456789")!=std::string::npos) return false;
+    compare.value = std::strtoll(text.c_str(),nullptr,10);
+    return true;
+}
+// find [path] [filters...]; the first argument is the root unless it starts with '-'
+inline bool File_Find_Filter_Parse(const std::vector<std::string>& args,std::string& root,File_Find_Filter& filter){
+    filter = File_Find_Filter{};
+    root = ".";
+    std::size_t idx = 0;
+    if(!args.empty()&&!args[0].starts_with("-")) root = args[idx++];
+    for(; idx<args.size(); idx++){
+        const std::string& option = args[idx];
+        if(idx+1>=args.size()) return false;
+        const std::string& value = args[++idx];
+        if(option=="-name"||option=="-iname"){
+            filter.name_glob = value;
+            filter.name_icase = option=="-iname";
+        }else if(option=="-regex"){
+            try{ filter.path_regex.emplace(value,std::regex::ECMAScript|std::regex::optimize); }
+            catch(const std::regex_error&){ return false; }
+        }else if(option=="-type"){
+            if(value!="f"&&value!="d"&&value!="l") return false;
+            filter.type = value[0];
+        }else if(option=="-size"){
+            if(!File_Find_Compare_Parse(value,filter.size,&filter.size_unit)) return false;
+        }else if(option=="-mtime"){
+            if(!File_Find_Compare_Parse(value,filter.mtime,nullptr)) return false;
+        }else return false;
+    }
+    return true;
+}
+
+namespace File_Find_Impl{
+    // Folders waiting in the queue beyond which a worker walks on into its sub-folders itself: every queued folder
+    // holds an open descriptor, so this (plus the depth each worker is in) bounds how many are open at once
+    constexpr std::size_t QUEUE_FOLDERS_MAX = 64;
+
+    // A folder, the path it is shown under and its real path; fd is -1 until opened (the root, or a folder queued
+    // while the process was out of descriptors). A cancelled queue drops (and closes) the unread ones
+    struct Find_Folder{
+        int fd = -1;
+        std::string path;
+        std::string real;
+
+        Find_Folder() = default;
+        Find_Folder(const int _fd,std::string _path,std::string _real): fd(_fd), path(std::move(_path)), real(std::move(_real)) {}
+        Find_Folder(Find_Folder&& other) noexcept: fd(std::exchange(other.fd,-1)), path(std::move(other.path)), real(std::move(other.real)) {}
+        Find_Folder& operator=(Find_Folder&& other) noexcept {
+            if(this!=&other){
+                if(fd>=0) close(fd);
+                fd = std::exchange(other.fd,-1);
+                path = std::move(other.path);
+                real = std::move(other.real);
+            }
+            return *this;
+        }
+        ~Find_Folder(){ if(fd>=0) close(fd); }
+    };
+
+    class Find_Engine{
+        Parallel_Work_Queue<Find_Folder> queue;
+        const File_Find_Filter& filter;
+        const File_Find_Report& report;
+        const std::time_t now = std::time(nullptr);
+        std::mutex report_mtx;
+        std::atomic<std::uint64_t> matched = 0;
+        std::atomic<std::uint64_t> scanned = 0;
+        std::atomic<std::uint64_t> failed = 0;
+
+        static char Type_Char(const unsigned char d_type){
+            return d_type==DT_DIR ? 'd' : d_type==DT_REG ? 'f' : d_type==DT_LNK ? 'l' : '?';
+        }
+        bool Stat_Match(const struct stat& st) const {
+            std::int64_t size_units = (static_cast<std::int64_t>(st.st_size)+filter.size_unit-1)/filter.size_unit;
+            std::int64_t age_days = (now-st.st_mtime)/86400;
+            return filter.size.Match(size_units)&&filter.mtime.Match(age_days);
+        }
+        void Folder_Find(Find_Folder& folder){
+            if(folder.fd<0) folder.fd = open(folder.real.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            if(folder.fd<0){ failed++; return; }
+            const int dir_fd = folder.fd;
+            std::vector<std::string> matches, sub_folders;
+            std::uint64_t count = 0;
+            std::string prefix = folder.path.ends_with('/') ? folder.path : folder.path+"/";
+            bool SFBoolState = Dirent_Read_All(dir_fd,[&](std::uint64_t,unsigned char d_type,std::string_view name){
+                count++;
+                std::string name_str(name);
+                if(d_type==DT_UNKNOWN){
+                    struct stat st{};
+                    if(fstatat(dir_fd,name_str.c_str(),&st,AT_SYMLINK_NOFOLLOW)==0)
+                        d_type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+                }
+                if(d_type==DT_DIR) sub_folders.push_back(name_str);
+
+                // Cheapest checks first: type and name never need a syscall
+                if(filter.type!=0&&Type_Char(d_type)!=filter.type) return;
+                if(!filter.name_glob.empty()
+                    &&fnmatch(filter.name_glob.c_str(),name_str.c_str(),filter.name_icase ? FNM_CASEFOLD : 0)!=0) return;
+                std::string full_path = prefix+name_str;
+                if(filter.path_regex&&!std::regex_search(full_path,*filter.path_regex)) return;
+                if(filter.Stat_Needed()){
+                    struct stat st{};
+                    if(fstatat(dir_fd,name_str.c_str(),&st,AT_SYMLINK_NOFOLLOW)!=0||!Stat_Match(st)) return;
+                }
+                matches.push_back(std::move(full_path));
+            });
+            if(!SFBoolState) failed++;
+            scanned += count;
+            if(!matches.empty()){
+                // One lock per folder keeps the output streaming without contention per entry
+                std::lock_guard lock(report_mtx);
+                for(const auto& match: matches){
+                    if(queue.Cancelled()) return;
+                    matched++;
+                    if(report&&!report(match)){ queue.Cancel(); return; }
+                }
+            }
+
+            for(const auto& name: sub_folders){
+                if(queue.Cancelled()) return;
+                int sub_fd = openat(dir_fd,name.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+                if(sub_fd<0&&errno!=EMFILE&&errno!=ENFILE){ failed++; continue; }
+                Find_Folder sub_folder(sub_fd,prefix+name,folder.real+"/"+name);
+                // Out of descriptors (a very deep walk): queued by path, opened once a worker gets to it
+                if(sub_folder.fd<0||queue.Queued()<QUEUE_FOLDERS_MAX) queue.Push(std::move(sub_folder));
+                else Folder_Find(sub_folder);
+            }
+        }
+    public:
+        Find_Engine(const File_Find_Filter& _filter,const File_Find_Report& _report): filter(_filter), report(_report) {}
+
+        File_Find_Stats Run(const std::filesystem::path root,std::string shown_root,const unsigned workers){
+            queue.Push(Find_Folder(-1,std::move(shown_root),root.string()));
+            queue.Run(Parallel_Worker_Count(workers),[this](Find_Folder& folder){ Folder_Find(folder); });
+            return File_Find_Stats{matched,scanned,failed,0};
+        }
+    };
+};
+
+// Search below root (the root itself is not reported); matches start with shown_root (root itself when empty),
+// so a caller resolving a relative path can print what the user typed. workers = 0 uses the hardware thread count
+inline File_Find_Stats File_Find_Parallel(const std::filesystem::path root,const File_Find_Filter& filter,
+    const File_Find_Report& report,const unsigned workers = 0,const std::string& shown_root = ""){
+    auto begin = std::chrono::steady_clock::now();
+    File_Find_Impl::Find_Engine engine(filter,report);
+    File_Find_Stats stats = engine.Run(root,shown_root.empty() ? root.string() : shown_root,workers);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
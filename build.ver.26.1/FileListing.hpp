@@ -0,0 +1,292 @@
+#pragma once
+#include "FileEntryView.hpp"
+#include "FileUsage.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+// ===== Buffered Output =====
+// Text gathered in one buffer and handed to write() in large pieces (retried until complete),
+// instead of a formatted stream insertion per line
+// A sink, when given, receives those pieces instead of fd (a background shell job collects its output); false fails it
+using File_Output_Sink = std::function<bool(std::string_view)>;
+class File_Output_Buffer{
+    static constexpr std::size_t FLUSH_SIZE = 1024*1024;
+    int fd;
+    File_Output_Sink sink;
+    std::string buf;
+    bool failed = false;
+public:
+    explicit File_Output_Buffer(const int _fd = STDOUT_FILENO,File_Output_Sink _sink = {}): fd(_fd), sink(std::move(_sink)) {
+        buf.reserve(FLUSH_SIZE+4096);
+    }
+    File_Output_Buffer(const File_Output_Buffer&) = delete;
+    File_Output_Buffer& operator=(const File_Output_Buffer&) = delete;
+    ~File_Output_Buffer(){ Flush(); }
+
+    void Append(const std::string_view text){
+        buf.append(text);
+        if(buf.size()>=FLUSH_SIZE) Flush();
+    }
+    void Append(const std::size_t count,const char ch){ buf.append(count,ch); }
+    void Append(const char ch){ buf.push_back(ch); }
+    // False once a write failed (e.g. the reader of a pipe went away); later output is dropped
+    bool Flush(){
+        if(sink){
+            if(!failed&&!buf.empty()) failed = !sink(buf);
+        }else for(std::size_t done=0; done<buf.size()&&!failed; ){
+            ssize_t wrote = write(fd,buf.data()+done,buf.size()-done);
+            if(wrote<0&&errno==EINTR) continue;
+            if(wrote<=0) failed = true;
+            else done += wrote;
+        }
+        buf.clear();
+        return !failed;
+    }
+    bool Failed() const { return failed; }
+};
+
+// ===== Listing Options =====
+// -l long format, -a names starting with '.', -h human sizes, -r reverse, -1 one name per line
+// Sort: name (default, byte order), -S size, -t mtime, -v natural, -X type, -U directory order
+struct File_Listing_Options{
+    bool long_format = false;
+    bool all = false;
+    bool human = false;
+    bool reverse = false;
+    bool one_per_line = false;
+    File_Sort_Mode sort = File_Sort_Mode::Name;
+};
+// Flags may be combined ("-lah"); "--" ends them; everything else is a path
+inline bool File_Listing_Options_Parse(const std::vector<std::string>& args,File_Listing_Options& options,std::vector<std::string>& paths){
+    options = File_Listing_Options{};
+    paths.clear();
+    bool flags_done = false;
+    for(const auto& arg: args){
+        if(flags_done||arg.size()<2||arg[0]!='-'){ paths.push_back(arg); continue; }
+        if(arg=="--"){ flags_done = true; continue; }
+        for(std::size_t idx=1; idx<arg.size(); idx++){
+            switch(arg[idx]){
+                case 'l': options.long_format = true; break;
+                case 'a': options.all = true; break;
+                case 'h': options.human = true; break;
+                case 'r': options.reverse = true; break;
+                case '1': options.one_per_line = true; break;
+                case 'S': options.sort = File_Sort_Mode::Size; break;
+                case 't': options.sort = File_Sort_Mode::Mtime; break;
+                case 'v': options.sort = File_Sort_Mode::Natural; break;
+                case 'X': options.sort = File_Sort_Mode::Type; break;
+                case 'U': options.sort = File_Sort_Mode::Directory; break;
+                default: return false;
+            }
+        }
+    }
+    if(paths.empty()) paths.push_back(".");
+    return true;
+}
+
+namespace File_Listing_Impl{
+    constexpr int COLUMN_GAP = 2;
+    constexpr int COLUMN_MIN = 1+COLUMN_GAP;
+    constexpr std::int64_t RECENT_SECONDS = 31556952/2;
+
+    // Terminal width of stdout, 0 when it is not a terminal (one name per line, like ls into a pipe)
+    inline int Output_Width(){
+        if(!isatty(STDOUT_FILENO)) return 0;
+        struct winsize ws{};
+        if(ioctl(STDOUT_FILENO,TIOCGWINSZ,&ws)==0&&ws.ws_col>0) return ws.ws_col;
+        if(const char* env = std::getenv("COLUMNS"); env!=nullptr&&std::atoi(env)>0) return std::atoi(env);
+        return 80;
+    }
+    inline bool Control_Byte(const char ch){ return static_cast<unsigned char>(ch)<0x20||ch==0x7F; }
+
+    // Name as written: on a terminal control bytes (a newline in a name) show as '?', like ls
+    inline void Name_Append(File_Output_Buffer& out,const std::string_view name,const bool tty,const bool folder){
+        if(tty&&folder) out.Append("\033[34m");
+        if(!tty||std::none_of(name.begin(),name.end(),Control_Byte)) out.Append(name);
+        else for(const char ch: name) out.Append(Control_Byte(ch) ? '?' : ch);
+        if(tty&&folder) out.Append("\033[0m");
+    }
+    inline int Name_Width(File_Entry_Table& table,const std::size_t idx){
+        std::string_view name = table.Entry_Name(idx);
+        return table.Entry_Width(idx)+static_cast<int>(std::count_if(name.begin(),name.end(),Control_Byte));
+    }
+
+    inline std::string_view Size_Text(char* buf,const std::size_t buf_size,const std::uint64_t bytes,const bool human){
+        if(human){
+            std::string text = File_Size_Human(bytes);
+            std::size_t len = std::min(text.size(),buf_size);
+            std::copy_n(text.data(),len,buf);
+            return std::string_view(buf,len);
+        }
+        auto [end,ec] = std::to_chars(buf,buf+buf_size,bytes);
+        return std::string_view(buf,end-buf);
+    }
+
+    // "Mon dd HH:MM" within half a year of now, "Mon dd  YYYY" otherwise; entries of a huge folder
+    // tend to share their minute, so the last result is reused
+    class Mtime_Formatter{
+        std::int64_t now = std::time(nullptr);
+        std::int64_t cached_minute = INT64_MIN;
+        bool cached_recent = false;
+        char text[32] = {};
+        std::size_t len = 0;
+    public:
+        std::string_view Format(const std::int64_t mtime){
+            bool recent = mtime<=now&&now-mtime<RECENT_SECONDS;
+            std::int64_t minute = mtime>=0 ? mtime/60 : (mtime-59)/60;
+            if(minute==cached_minute&&recent==cached_recent) return std::string_view(text,len);
+            std::time_t seconds = mtime;
+            struct tm local{};
+            localtime_r(&seconds,&local);
+            len = std::strftime(text,sizeof(text),recent ? "%b %e %H:%M" : "%b %e  %Y",&local);
+            cached_minute = minute; cached_recent = recent;
+            return std::string_view(text,len);
+        }
+    };
+
+    // Long format: mode, size (right aligned), mtime, name (and " -> target" for a symlink); stats every entry up
+    // front on all hardware threads, symlinks themselves rather than their targets
+    inline void Long_Write(File_Entry_Table& table,const std::vector<std::uint32_t>& shown,const File_Listing_Options& options,
+                           const bool tty,File_Output_Buffer& out){
+        table.Entry_Stat_Range(0,table.size());
+        char size_buf[32];
+        std::size_t size_width = 0;
+        for(const auto idx: shown)
+            size_width = std::max(size_width,Size_Text(size_buf,sizeof(size_buf),table.Entry_Size(idx),options.human).size());
+        Mtime_Formatter mtime;
+        for(const auto idx: shown){
+            out.Append(File_Permission_Mode_Format(table.Entry_Mode(idx)));
+            std::string_view size = Size_Text(size_buf,sizeof(size_buf),table.Entry_Size(idx),options.human);
+            out.Append(size_width-size.size()+1,' ');
+            out.Append(size);
+            out.Append(' ');
+            out.Append(mtime.Format(table.Entry_Mtime(idx)));
+            out.Append(' ');
+            Name_Append(out,table.Entry_Name(idx),tty,table.Entry_DType(idx)==DT_DIR);
+            if(S_ISLNK(table.Entry_Mode(idx))){
+                out.Append(" -> ");
+                Name_Append(out,table.Entry_Link_Target(idx),tty,false);
+            }
+            out.Append('\n');
+        }
+    }
+
+    // Columns filled top to bottom, as many as fit in width: every column count up to width/COLUMN_MIN
+    // is tried in one pass over the names, growing its column widths until the line would overflow
+    inline void Columns_Write(File_Entry_Table& table,const std::vector<std::uint32_t>& shown,const int width,
+                              const bool tty,File_Output_Buffer& out){
+        std::size_t count = shown.size();
+        if(count==0) return;
+        std::vector<int> widths(count);
+        for(std::size_t pos=0; pos<count; pos++) widths[pos] = Name_Width(table,shown[pos]);
+        struct Column_Fit{
+            bool valid = true;
+            int line = 0;
+            std::vector<int> column;
+        };
+        std::size_t max_cols = std::clamp<std::size_t>(width/COLUMN_MIN,1,count);
+        std::vector<Column_Fit> fits(max_cols);
+        for(std::size_t cols=1; cols<=max_cols; cols++) fits[cols-1].column.assign(cols,0);
+        for(std::size_t pos=0; pos<count; pos++){
+            int needed = widths[pos]+COLUMN_GAP;
+            for(std::size_t cols=2; cols<=max_cols; cols++){
+                Column_Fit& fit = fits[cols-1];
+                if(!fit.valid) continue;
+                std::size_t rows = (count+cols-1)/cols;
+                int& column = fit.column[pos/rows];
+                if(needed<=column) continue;
+                fit.line += needed-column;
+                column = needed;
+                // The last column needs no gap after it
+                if(fit.line-COLUMN_GAP>=width) fit.valid = false;
+            }
+        }
+        std::size_t cols = max_cols;
+        while(cols>1&&!fits[cols-1].valid) cols--;
+        std::size_t rows = (count+cols-1)/cols;
+        for(std::size_t row=0; row<rows; row++){
+            for(std::size_t col=0; col<cols; col++){
+                std::size_t pos = col*rows+row;
+                if(pos>=count) break;
+                std::uint32_t idx = shown[pos];
+                Name_Append(out,table.Entry_Name(idx),tty,table.Entry_DType(idx)==DT_DIR);
+                if(col+1<cols&&pos+rows<count) out.Append(fits[cols-1].column[col]-widths[pos],' ');
+            }
+            out.Append('\n');
+        }
+    }
+};
+
+// ===== Folder Listing =====
+// One getdents64 pass (File_Entry_Table), sorted through File_Entry_View; statx only for -l or a size/time sort
+// False when the folder cannot be read
+inline bool File_Listing_Write(const std::filesystem::path& folder,const File_Listing_Options& options,File_Output_Buffer& out){
+    auto table = std::make_shared<File_Entry_Table>();
+    if(!table->Load_Start(folder)) return false;
+    table->Load_Wait();
+    // Like ls: a symlink's own size and time, also for -S and -t
+    table->Stat_Links_Own();
+    File_Entry_View view;
+    view.Refresh(table,options.sort);
+
+    std::vector<std::uint32_t> shown;
+    shown.reserve(view.size());
+    for(std::size_t row=0; row<view.size(); row++){
+        std::size_t idx = view.Entry(row);
+        if(!options.all&&table->Entry_Name(idx).starts_with('.')) continue;
+        shown.push_back(idx);
+    }
+    if(options.reverse) std::reverse(shown.begin(),shown.end());
+
+    int width = File_Listing_Impl::Output_Width();
+    bool tty = width>0;
+    if(options.long_format) File_Listing_Impl::Long_Write(*table,shown,options,tty,out);
+    else if(options.one_per_line||!tty){
+        for(const auto idx: shown){
+            File_Listing_Impl::Name_Append(out,table->Entry_Name(idx),tty,table->Entry_DType(idx)==DT_DIR);
+            out.Append('\n');
+        }
+    }else File_Listing_Impl::Columns_Write(*table,shown,width,tty,out);
+    return true;
+}
+// A single file given as the path, shown under name (long format from its own stat; a symlink is described
+// itself, with its target)
+inline bool File_Listing_Write_File(const std::filesystem::path& file,const std::string_view name,const File_Listing_Options& options,File_Output_Buffer& out){
+    struct stat st{};
+    if(options.long_format ? lstat(file.c_str(),&st)!=0 : stat(file.c_str(),&st)!=0&&lstat(file.c_str(),&st)!=0) return false;
+    bool tty = isatty(STDOUT_FILENO);
+    if(options.long_format){
+        char size_buf[32];
+        out.Append(File_Permission_Mode_Format(st.st_mode));
+        out.Append(' ');
+        out.Append(File_Listing_Impl::Size_Text(size_buf,sizeof(size_buf),st.st_size,options.human));
+        out.Append(' ');
+        out.Append(File_Listing_Impl::Mtime_Formatter().Format(st.st_mtime));
+        out.Append(' ');
+    }
+    File_Listing_Impl::Name_Append(out,name,tty,false);
+    if(options.long_format&&S_ISLNK(st.st_mode)){
+        char target[PATH_MAX];
+        ssize_t len = readlink(file.c_str(),target,sizeof(target));
+        out.Append(" -> ");
+        File_Listing_Impl::Name_Append(out,std::string_view(target,len>0 ? len : 0),tty,false);
+    }
+    out.Append('\n');
+    return true;
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include "DirentReader.hpp"
+#include "ParallelTask.hpp"
+#include <sodium.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// ===== Integrity Manifest =====
+// BLAKE2b-512 (crypto_generichash, 64-byte output) of every regular file below a root, sorted by relative path
+// Text form is the b2sum one, "<128 hex>  <path>", so `b2sum -c` can check it from inside the root and back
+// Files are hashed in parallel on the shared work queue with 1 MiB sequential reads; symlinks are not followed
+// and names containing a newline cannot be written (counted as failed)
+using File_Manifest_Digest = std::array<unsigned char,crypto_generichash_BYTES_MAX>;
+struct File_Manifest_Entry{
+    std::string path;
+    File_Manifest_Digest digest;
+};
+using File_Manifest = std::vector<File_Manifest_Entry>;
+struct File_Manifest_Stats{
+    std::uint64_t files = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t failed = 0;
+    double seconds = 0;
+    double Throughput_MiB() const { return seconds>0 ? bytes/1048576.0/seconds : 0; }
+};
+// Entries of expected that changed or disappeared, and entries of actual that are new
+struct File_Manifest_Diff{
+    std::vector<std::string> changed;
+    std::vector<std::string> missing;
+    std::vector<std::string> added;
+    bool Clean() const { return changed.empty()&&missing.empty()&&added.empty(); }
+};
+
+namespace File_Manifest_Impl{
+    constexpr std::size_t READ_CHUNK = 1024*1024;
+
+    // Hash an open file from its current offset to the end
+    inline bool Hash_Fd(const int fd,File_Manifest_Digest& digest,std::uint64_t& bytes){
+        thread_local std::vector<unsigned char> buf(READ_CHUNK);
+        posix_fadvise(fd,0,0,POSIX_FADV_SEQUENTIAL);
+        crypto_generichash_state state;
+        crypto_generichash_init(&state,nullptr,0,digest.size());
+        while(true){
+            ssize_t got = read(fd,buf.data(),buf.size());
+            if(got<0){
+                if(errno==EINTR) continue;
+                return false;
+            }
+            if(got==0) break;
+            crypto_generichash_update(&state,buf.data(),got);
+            bytes += got;
+        }
+        crypto_generichash_final(&state,digest.data(),digest.size());
+        return true;
+    }
+
+    struct Manifest_Task{
+        std::string path;
+        bool folder = false;
+    };
+    class Manifest_Engine{
+        Parallel_Work_Queue<Manifest_Task> queue;
+        std::string root;
+        std::mutex result_mtx;
+        File_Manifest& result;
+        std::atomic<std::uint64_t> bytes = 0;
+        std::atomic<std::uint64_t> failed = 0;
+
+        void Folder_Scan(const std::string& folder){
+            std::string full = folder.empty() ? root : root+"/"+folder;
+            int dir_fd = open(full.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            if(dir_fd<0){ failed++; return; }
+            std::string prefix = folder.empty() ? std::string() : folder+"/";
+            bool SFBoolState = Dirent_Read_All(dir_fd,[&](std::uint64_t,unsigned char d_type,std::string_view name){
+                if(d_type==DT_UNKNOWN){
+                    struct stat st{};
+                    std::string name_str(name);
+                    if(fstatat(dir_fd,name_str.c_str(),&st,AT_SYMLINK_NOFOLLOW)==0)
+                        d_type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+                if(d_type==DT_DIR) queue.Push(Manifest_Task{prefix+std::string(name),true});
+                else if(d_type==DT_REG){
+                    if(name.find('\n')!=std::string_view::npos){ failed++; return; }
+                    // One task per file: a few large files still spread over every worker
+                    queue.Push(Manifest_Task{prefix+std::string(name),false});
+                }
+            });
+            close(dir_fd);
+            if(!SFBoolState) failed++;
+        }
+        void File_Hash(Manifest_Task& task){
+            std::string full = root+"/"+task.path;
+            int fd = open(full.c_str(),O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+            if(fd<0){ failed++; return; }
+            File_Manifest_Entry entry{std::move(task.path),{}};
+            std::uint64_t read_bytes = 0;
+            bool SFBoolState = Hash_Fd(fd,entry.digest,read_bytes);
+            close(fd);
+            if(!SFBoolState){ failed++; return; }
+            bytes += read_bytes;
+            std::lock_guard lock(result_mtx);
+            result.push_back(std::move(entry));
+        }
+    public:
+        Manifest_Engine(std::string _root,File_Manifest& _result): root(std::move(_root)), result(_result) {}
+
+        File_Manifest_Stats Run(const unsigned workers){
+            queue.Push(Manifest_Task{std::string(),true});
+            queue.Run(Parallel_Worker_Count(workers),[this](Manifest_Task& task){
+                if(task.folder) Folder_Scan(task.path);
+                else File_Hash(task);
+            });
+            return File_Manifest_Stats{result.size(),bytes,failed,0};
+        }
+    };
+
+    inline int Hex_Value(const char ch){
+        if(ch>='0'&&ch<='9') return ch-'0';
+        if(ch>='a'&&ch<='f') return ch-'a'+10;
+        if(ch>='A'&&ch<='F') return ch-'A'+10;
+        return -1;
+    }
+};
+
+// ===== Manifest Creation =====
+// Manifest of a folder tree (paths relative to it) or of a single file (its own name); workers = 0 uses every hardware thread
+inline File_Manifest_Stats File_Manifest_Create(const std::filesystem::path root,File_Manifest& manifest,const unsigned workers = 0){
+    auto begin = std::chrono::steady_clock::now();
+    manifest.clear();
+    File_Manifest_Stats stats;
+    struct stat st{};
+    if(sodium_init()<0||lstat(root.c_str(),&st)!=0){
+        stats.failed = 1;
+        return stats;
+    }
+    if(S_ISDIR(st.st_mode)){
+        File_Manifest_Impl::Manifest_Engine engine(root.string(),manifest);
+        stats = engine.Run(workers);
+    }else if(S_ISREG(st.st_mode)){
+        File_Manifest_Entry entry{root.filename().string(),{}};
+        int fd = open(root.c_str(),O_RDONLY|O_NOFOLLOW|O_CLOEXEC);
+        if(fd>=0&&File_Manifest_Impl::Hash_Fd(fd,entry.digest,stats.bytes)){
+            manifest.push_back(std::move(entry));
+            stats.files = 1;
+        }else stats.failed = 1;
+        if(fd>=0) close(fd);
+    }else stats.failed = 1;
+    std::sort(manifest.begin(),manifest.end(),[](const auto& lhs,const auto& rhs){ return lhs.path<rhs.path; });
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
+
+// Entry for a relative path, nullptr when absent (binary search: manifests are sorted)
+inline const File_Manifest_Entry* File_Manifest_Find(const File_Manifest& manifest,const std::string_view path){
+    auto it = std::lower_bound(manifest.begin(),manifest.end(),path,[](const auto& entry,const std::string_view key){ return entry.path<key; });
+    if(it==manifest.end()||it->path!=path) return nullptr;
+    return &*it;
+}
+// Drop one path (e.g. the manifest file itself when it is stored inside the tree it describes)
+inline void File_Manifest_Erase(File_Manifest& manifest,const std::string_view path){
+    auto it = std::lower_bound(manifest.begin(),manifest.end(),path,[](const auto& entry,const std::string_view key){ return entry.path<key; });
+    if(it!=manifest.end()&&it->path==path) manifest.erase(it);
+}
+
+// ===== Manifest Text =====
+// One "<hex>  <path>" line
+inline std::string File_Manifest_Line(const File_Manifest_Entry& entry){
+    char hex[crypto_generichash_BYTES_MAX*2+1];
+    sodium_bin2hex(hex,sizeof(hex),entry.digest.data(),entry.digest.size());
+    std::string line(hex);
+    line.append("  ");
+    line.append(entry.path);
+    return line;
+}
+inline bool File_Manifest_Store(const File_Manifest& manifest,const std::filesystem::path manifest_path){
+    std::ofstream ofs(manifest_path,std::ios::binary|std::ios::trunc);
+    if(!ofs.is_open()) return false;
+    for(const auto& entry: manifest) ofs<<File_Manifest_Line(entry)<<'\n';
+    ofs.close();
+    return !ofs.fail();
+}
+// Reads the untagged b2sum format ("  " or " *" separator, a leading "./" is dropped); false on a malformed line
+inline bool File_Manifest_Load(const std::filesystem::path manifest_path,File_Manifest& manifest){
+    manifest.clear();
+    std::ifstream ifs(manifest_path,std::ios::binary);
+    if(!ifs.is_open()) return false;
+    constexpr std::size_t HEX_LEN = crypto_generichash_BYTES_MAX*2;
+    std::string line;
+    while(std::getline(ifs,line)){
+        if(!line.empty()&&line.back()=='\r') line.pop_back();
+        if(line.empty()) continue;
+        if(line.size()<HEX_LEN+3||line[HEX_LEN]!=' '||(line[HEX_LEN+1]!=' '&&line[HEX_LEN+1]!='*')) return false;
+        File_Manifest_Entry entry;
+        for(std::size_t idx=0; idx<entry.digest.size(); idx++){
+            int high = File_Manifest_Impl::Hex_Value(line[idx*2]), low = File_Manifest_Impl::Hex_Value(line[idx*2+1]);
+            if(high<0||low<0) return false;
+            entry.digest[idx] = static_cast<unsigned char>(high<<4|low);
+        }
+        entry.path = line.substr(HEX_LEN+2);
+        if(entry.path.starts_with("./")) entry.path.erase(0,2);
+        manifest.push_back(std::move(entry));
+    }
+    std::sort(manifest.begin(),manifest.end(),[](const auto& lhs,const auto& rhs){ return lhs.path<rhs.path; });
+    return true;
+}
+
+// ===== Manifest Comparison =====
+// Merge of two sorted manifests; digests compared in constant time
+inline File_Manifest_Diff File_Manifest_Compare(const File_Manifest& expected,const File_Manifest& actual){
+    File_Manifest_Diff diff;
+    auto lhs = expected.begin(), rhs = actual.begin();
+    while(lhs!=expected.end()||rhs!=actual.end()){
+        if(rhs==actual.end()||(lhs!=expected.end()&&lhs->path<rhs->path)) diff.missing.push_back((lhs++)->path);
+        else if(lhs==expected.end()||rhs->path<lhs->path) diff.added.push_back((rhs++)->path);
+        else{
+            if(sodium_memcmp(lhs->digest.data(),rhs->digest.data(),lhs->digest.size())!=0) diff.changed.push_back(lhs->path);
+            lhs++; rhs++;
+        }
+    }
+    return diff;
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include "DirentReader.hpp"
+#include "ParallelTask.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+// ===== Parallel Recursive Delete =====
+// Progress callback (removed entries, failed entries), called at most every PROGRESS_INTERVAL and once at the end
+// Every folder is opened with openat relative to its parent's dirfd (O_NOFOLLOW) and read once; files are unlinked
+// with unlinkat relative to it, sub-folders become tasks for the worker pool, and a folder is removed with
+// unlinkat(parent dirfd, name, AT_REMOVEDIR) when its last sub-folder is gone. No full path is built below a root,
+// so a folder swapped for a symlink cannot lead the walk out of the tree and depth is not bounded by PATH_MAX.
+// Below DEPTH_HELD_MAX levels a sub-tree is removed by one worker holding a single descriptor (Subtree_Remove)
+using File_Remove_Report = std::function<void(std::uint64_t,std::uint64_t)>;
+
+namespace File_Remove_Impl{
+    constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds(200);
+    // Folders waiting in the queue beyond which a worker removes the sub-folders it finds itself (see FileFind.hpp)
+    constexpr std::size_t QUEUE_FOLDERS_MAX = 64;
+    // Levels that hold a descriptor each; deeper folders go through Subtree_Remove
+    constexpr std::size_t DEPTH_HELD_MAX = 128;
+
+    // A folder keeps its descriptor from being opened until it is removed (its sub-folders are opened and removed
+    // relative to it); parent_fd is the parent's, or for a root one the engine opened on the folder above it
+    struct Remove_Node{
+        std::string name;
+        Remove_Node* parent;
+        int parent_fd;
+        std::size_t depth;
+        int fd = -1;
+        std::atomic<std::int64_t> pending = 1;
+    };
+
+    // A folder holds one descriptor per level of a deep tree: the soft limit is raised to the hard one, once
+    inline void Descriptor_Limit_Raise(){
+        static std::once_flag once;
+        std::call_once(once,[]{
+            rlimit limit{};
+            if(getrlimit(RLIMIT_NOFILE,&limit)!=0||limit.rlim_cur>=limit.rlim_max) return;
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE,&limit);
+        });
+    }
+
+    class Remove_Engine{
+        Parallel_Work_Queue<Remove_Node*> queue;
+        std::mutex node_mtx;
+        std::vector<std::unique_ptr<Remove_Node>> nodes;
+        std::atomic<std::uint64_t> removed = 0;
+        std::atomic<std::uint64_t> failed = 0;
+
+        std::mutex report_mtx;
+        const File_Remove_Report& report;
+        std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+        Remove_Node* Node_Create(std::string name,Remove_Node* parent,const int parent_fd){
+            std::lock_guard lock(node_mtx);
+            nodes.push_back(std::make_unique<Remove_Node>(std::move(name),parent,parent_fd,parent!=nullptr ? parent->depth+1 : 0));
+            return nodes.back().get();
+        }
+        void Progress_Report(){
+            if(!report) return;
+            std::unique_lock lock(report_mtx,std::try_to_lock);
+            if(!lock.owns_lock()) return;
+            auto now = std::chrono::steady_clock::now();
+            if(now-last_report<PROGRESS_INTERVAL) return;
+            last_report = now;
+            report(removed,failed);
+        }
+        // Last reference to a folder dropped: remove it, then release its parent
+        void Node_Release(Remove_Node* node){
+            while(node!=nullptr&&--node->pending==0){
+                if(node->fd>=0){ close(node->fd); node->fd = -1; }
+                if(unlinkat(node->parent_fd,node->name.c_str(),AT_REMOVEDIR)==0) removed++;
+                else failed++;
+                node = node->parent;
+            }
+        }
+        // Read a folder whole (unlinking while getdents64 walks it may skip entries), unlink everything but
+        // sub-folders and hand back their names
+        std::vector<std::string> Folder_Empty(const int dir_fd){
+            std::vector<std::pair<std::string,unsigned char>> entries;
+            if(!Dirent_Read_All(dir_fd,[&entries](std::uint64_t,unsigned char d_type,std::string_view name){
+                entries.emplace_back(std::string(name),d_type);
+            })) failed++;
+            std::vector<std::string> sub_folders;
+            for(auto& [name,d_type]: entries){
+                if(d_type==DT_UNKNOWN){
+                    struct stat st{};
+                    if(fstatat(dir_fd,name.c_str(),&st,AT_SYMLINK_NOFOLLOW)==0&&S_ISDIR(st.st_mode)) d_type = DT_DIR;
+                }
+                if(d_type==DT_DIR) sub_folders.push_back(std::move(name));
+                else if(unlinkat(dir_fd,name.c_str(),0)==0) removed++;
+                else failed++;
+            }
+            return sub_folders;
+        }
+        // A whole sub-tree with one descriptor open: down into one sub-folder at a time, back up with ".." once a
+        // folder is empty. ".." must still be the folder the walk came from (st_dev/st_ino), otherwise it stops
+        void Subtree_Remove(const int parent_fd,const std::string& name){
+            struct Level{
+                std::string name;
+                dev_t parent_dev;
+                ino_t parent_ino;
+                std::vector<std::string> sub_folders;
+            };
+            std::vector<Level> levels;
+            struct stat st{};
+            int fd = fstat(parent_fd,&st)==0 ? openat(parent_fd,name.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC) : -1;
+            if(fd<0){ failed++; return; }
+            levels.push_back(Level{name,st.st_dev,st.st_ino,Folder_Empty(fd)});
+            while(true){
+                if(!levels.back().sub_folders.empty()){
+                    std::string sub = std::move(levels.back().sub_folders.back());
+                    levels.back().sub_folders.pop_back();
+                    int sub_fd = fstat(fd,&st)==0 ? openat(fd,sub.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC) : -1;
+                    if(sub_fd<0){ failed++; continue; }
+                    close(fd);
+                    fd = sub_fd;
+                    levels.push_back(Level{std::move(sub),st.st_dev,st.st_ino,Folder_Empty(fd)});
+                    continue;
+                }
+                Level done = std::move(levels.back());
+                levels.pop_back();
+                int up_fd = levels.empty() ? parent_fd : openat(fd,"..",O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+                close(fd);
+                if(up_fd<0||fstat(up_fd,&st)!=0||st.st_dev!=done.parent_dev||st.st_ino!=done.parent_ino){
+                    if(up_fd>=0&&up_fd!=parent_fd) close(up_fd);
+                    failed++;
+                    return;
+                }
+                if(unlinkat(up_fd,done.name.c_str(),AT_REMOVEDIR)==0) removed++;
+                else failed++;
+                if(levels.empty()) return;
+                fd = up_fd;
+            }
+        }
+        void Folder_Scan(Remove_Node* node){
+            node->fd = openat(node->parent_fd,node->name.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            if(node->fd<0){
+                failed++;
+                Node_Release(node);
+                return;
+            }
+            for(auto& name: Folder_Empty(node->fd)){
+                if(node->depth+1>=DEPTH_HELD_MAX){
+                    Subtree_Remove(node->fd,name);
+                    continue;
+                }
+                node->pending++;
+                Remove_Node* sub_node = Node_Create(std::move(name),node,node->fd);
+                if(queue.Queued()<QUEUE_FOLDERS_MAX) queue.Push(sub_node);
+                else Folder_Scan(sub_node);
+            }
+            Progress_Report();
+            Node_Release(node);
+        }
+    public:
+        explicit Remove_Engine(const File_Remove_Report& _report): report(_report) {}
+
+        bool Run(const std::vector<std::filesystem::path>& target_folders,const unsigned workers){
+            Descriptor_Limit_Raise();
+            std::vector<int> root_fds;
+            for(const auto& target_folder: target_folders){
+                std::filesystem::path folder = target_folder.lexically_normal();
+                if(!folder.has_filename()) folder = folder.parent_path();
+                std::filesystem::path above = folder.has_parent_path() ? folder.parent_path() : ".";
+                int parent_fd = open(above.c_str(),O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+                if(parent_fd<0){ failed++; continue; }
+                root_fds.push_back(parent_fd);
+                queue.Push(Node_Create(folder.filename().string(),nullptr,parent_fd));
+            }
+            queue.Run(Parallel_Worker_Count(workers),[this](Remove_Node*& node){ Folder_Scan(node); });
+            for(const int parent_fd: root_fds) close(parent_fd);
+            if(report) report(removed,failed);
+            return failed==0;
+        }
+    };
+};
+
+// Remove a file, symlink or whole folder tree (symlinks are removed, never followed)
+// workers = 0 uses the hardware thread count; returns false if anything could not be removed
+inline bool File_Remove_Parallel(const std::filesystem::path target_path,const File_Remove_Report& report = nullptr,const unsigned workers = 0){
+    struct stat st{};
+    if(lstat(target_path.c_str(),&st)!=0) return false;
+    if(!S_ISDIR(st.st_mode)){
+        bool SFBoolState = unlink(target_path.c_str())==0;
+        if(report) report(SFBoolState ? 1 : 0,SFBoolState ? 0 : 1);
+        return SFBoolState;
+    }
+    File_Remove_Impl::Remove_Engine engine(report);
+    return engine.Run({target_path},workers);
+}
+// Several targets (a marked selection) on one worker pool: files and symlinks are unlinked up front,
+// every folder tree is a root in the same queue
+inline bool File_Remove_Parallel(const std::vector<std::filesystem::path>& target_paths,const File_Remove_Report& report = nullptr,const unsigned workers = 0){
+    std::vector<std::filesystem::path> target_folders;
+    std::uint64_t removed = 0, failed = 0;
+    for(const auto& target_path: target_paths){
+        struct stat st{};
+        if(lstat(target_path.c_str(),&st)!=0) failed++;
+        else if(S_ISDIR(st.st_mode)) target_folders.push_back(target_path);
+        else if(unlink(target_path.c_str())==0) removed++;
+        else failed++;
+    }
+    if(target_folders.empty()){
+        if(report) report(removed,failed);
+        return failed==0;
+    }
+    File_Remove_Report folder_report;
+    if(report) folder_report = [&](std::uint64_t folder_removed,std::uint64_t folder_failed){ report(removed+folder_removed,failed+folder_failed); };
+    File_Remove_Impl::Remove_Engine engine(folder_report);
+    return engine.Run(target_folders,workers)&&failed==0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include "DirentReader.hpp"
+#include "ParallelTask.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stop_token>
+#include <unordered_set>
+#include <cstdint>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// ===== Disk Usage =====
+// Apparent bytes (st_size) and allocated bytes (st_blocks*512) of a whole tree, summed folder-parallel
+// Files with several hard links are counted once (by dev/inode); symlinks count as themselves, never followed
+struct File_Usage_Stats{
+    std::uint64_t apparent = 0;
+    std::uint64_t allocated = 0;
+    std::uint64_t files = 0;
+    std::uint64_t folders = 0;
+    std::uint64_t failed = 0;
+    bool cancelled = false;
+    double seconds = 0;
+};
+
+// Size in the short form used by ls -h (e.g. 512, 4.0K, 12M, 1.3G)
+inline std::string File_Size_Human(const std::uint64_t bytes){
+    const char unit[] = {'K','M','G','T','P','E'};
+    if(bytes<1024) return std::to_string(bytes);
+    double value = bytes;
+    int idx = -1;
+    while(value>=1024&&idx<5){ value /= 1024; idx++; }
+    char buf[16];
+    if(value<10) std::snprintf(buf,sizeof(buf),"%.1f%c",value,unit[idx]);
+    else std::snprintf(buf,sizeof(buf),"%.0f%c",value,unit[idx]);
+    return buf;
+}
+
+namespace File_Usage_Impl{
+    // Inodes with st_nlink>1 already counted; sharded so workers rarely share a lock
+    class Hard_Link_Set{
+        static constexpr std::size_t SHARDS = 16;
+        struct Inode_Hash{
+            std::size_t operator()(const std::pair<dev_t,ino_t>& key) const {
+                return std::hash<std::uint64_t>()(key.second*31+key.first);
+            }
+        };
+        struct Shard{
+            std::mutex mtx;
+            std::unordered_set<std::pair<dev_t,ino_t>,Inode_Hash> seen;
+        };
+        std::array<Shard,SHARDS> shards;
+    public:
+        // True the first time an inode is seen
+        bool Insert(const dev_t dev,const ino_t ino){
+            Shard& shard = shards[ino%SHARDS];
+            std::lock_guard lock(shard.mtx);
+            return shard.seen.emplace(dev,ino).second;
+        }
+    };
+
+    class Usage_Engine{
+        Parallel_Work_Queue<std::string> queue;
+        Hard_Link_Set hard_links;
+        std::stop_token stop;
+        std::atomic<std::uint64_t> apparent = 0;
+        std::atomic<std::uint64_t> allocated = 0;
+        std::atomic<std::uint64_t> files = 0;
+        std::atomic<std::uint64_t> folders = 0;
+        std::atomic<std::uint64_t> failed = 0;
+
+        void Stat_Add(const struct stat& st){
+            if(!S_ISDIR(st.st_mode)&&st.st_nlink>1&&!hard_links.Insert(st.st_dev,st.st_ino)) return;
+            apparent += st.st_size;
+            allocated += static_cast<std::uint64_t>(st.st_blocks)*512;
+            if(S_ISDIR(st.st_mode)) folders++;
+            else files++;
+        }
+        void Folder_Scan(const std::string& folder){
+            if(stop.stop_requested()){ queue.Cancel(); return; }
+            int dir_fd = open(folder.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            if(dir_fd<0){ failed++; return; }
+            std::uint64_t local_apparent = 0, local_allocated = 0, local_files = 0;
+            bool SFBoolState = Dirent_Read_All(dir_fd,[&](std::uint64_t,unsigned char,std::string_view name){
+                std::string name_str(name);
+                struct stat st{};
+                if(fstatat(dir_fd,name_str.c_str(),&st,AT_SYMLINK_NOFOLLOW)!=0){ failed++; return; }
+                if(S_ISDIR(st.st_mode)){
+                    Stat_Add(st);
+                    queue.Push(folder+"/"+name_str);
+                    return;
+                }
+                if(st.st_nlink>1&&!hard_links.Insert(st.st_dev,st.st_ino)) return;
+                local_apparent += st.st_size;
+                local_allocated += static_cast<std::uint64_t>(st.st_blocks)*512;
+                local_files++;
+            });
+            close(dir_fd);
+            if(!SFBoolState) failed++;
+            apparent += local_apparent; allocated += local_allocated; files += local_files;
+        }
+    public:
+        explicit Usage_Engine(std::stop_token _stop): stop(std::move(_stop)) {}
+
+        File_Usage_Stats Run(const std::filesystem::path root,const struct stat& root_st,const unsigned workers){
+            Stat_Add(root_st);
+            queue.Push(root.string());
+            queue.Run(Parallel_Worker_Count(workers),[this](std::string& folder){ Folder_Scan(folder); });
+            return File_Usage_Stats{apparent,allocated,files,folders,failed,stop.stop_requested()||queue.Cancelled(),0};
+        }
+    };
+};
+
+// Usage of a file or folder tree; a stop request ends the walk early (stats.cancelled, partial sums)
+inline File_Usage_Stats File_Usage_Parallel(const std::filesystem::path target_path,const unsigned workers = 0,std::stop_token stop = {}){
+    auto begin = std::chrono::steady_clock::now();
+    File_Usage_Stats stats;
+    struct stat st{};
+    if(lstat(target_path.c_str(),&st)!=0){
+        stats.failed = 1;
+        return stats;
+    }
+    if(S_ISDIR(st.st_mode)){
+        File_Usage_Impl::Usage_Engine engine(std::move(stop));
+        stats = engine.Run(target_path,st,workers);
+    }else{
+        stats.apparent = st.st_size;
+        stats.allocated = static_cast<std::uint64_t>(st.st_blocks)*512;
+        stats.files = 1;
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
@@ -0,0 +1,232 @@
+#pragma once
+#include "DirentReader.hpp"
+#include "ParallelTask.hpp"
+#include "FileRemove.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/random.h>
+#include <linux/falloc.h>
+
+// ===== Secure Wipe =====
+// Overwrite file contents before unlinking, so plaintext leftovers are not recoverable by reading the free blocks
+// Large aligned random buffers, drawn again every pass (optionally O_DIRECT to bypass the page cache),
+// fdatasync per pass, then punch-hole/discard of the blocks; folders are wiped file-parallel and removed afterwards
+// A file with other hard links is only unlinked: its data is still reachable through them
+// Note: on copy-on-write filesystems and SSD wear levelling an overwrite cannot reach every old copy
+struct File_Wipe_Option{
+    unsigned passes = 1;
+    bool direct_io = false;
+    unsigned workers = 0;
+};
+struct File_Wipe_Stats{
+    std::uint64_t files = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t failed = 0;
+    std::uint64_t linked = 0;
+    double seconds = 0;
+    double Throughput_MiB() const { return seconds>0 ? bytes/1048576.0/seconds : 0; }
+};
+// Progress callback (files wiped, bytes written), throttled like File_Remove_Report
+using File_Wipe_Report = std::function<void(std::uint64_t,std::uint64_t)>;
+
+namespace File_Wipe_Impl{
+    constexpr std::size_t WIPE_ALIGN = 4096;
+    constexpr std::size_t WIPE_BUFFER = 4*1024*1024;
+    constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds(200);
+
+    // One page aligned buffer per worker thread, reused for every write
+    inline unsigned char* Wipe_Buffer(){
+        struct Buffer_Free{ void operator()(unsigned char* p) const { std::free(p); } };
+        thread_local std::unique_ptr<unsigned char,Buffer_Free> buffer = []{
+            void* raw = nullptr;
+            if(posix_memalign(&raw,WIPE_ALIGN,WIPE_BUFFER)!=0) return std::unique_ptr<unsigned char,Buffer_Free>();
+            return std::unique_ptr<unsigned char,Buffer_Free>(static_cast<unsigned char*>(raw));
+        }();
+        return buffer.get();
+    }
+    // Fresh random bytes for the first len bytes of the buffer, so no two passes write the same pattern
+    inline bool Wipe_Fill(unsigned char* buf,const std::size_t len){
+        for(std::size_t filled=0; filled<len; ){
+            ssize_t got = getrandom(buf+filled,len-filled,0);
+            if(got<0&&errno==EINTR) continue;
+            if(got<=0) return false;
+            filled += got;
+        }
+        return true;
+    }
+
+    // Overwrite an open file in place (bytes written are added to `written`), then discard and truncate it
+    inline bool Wipe_Fd(const int fd,const std::uint64_t size,const File_Wipe_Option& option,const bool direct,std::uint64_t& written){
+        unsigned char* buf = Wipe_Buffer();
+        if(buf==nullptr) return false;
+        for(unsigned pass=0; pass<option.passes; pass++){
+            // Only as much as the file uses (small files are the common case), rounded up for O_DIRECT
+            std::size_t fill = std::min<std::uint64_t>(WIPE_BUFFER,size);
+            if(direct) fill = std::min((fill+WIPE_ALIGN-1)/WIPE_ALIGN*WIPE_ALIGN,WIPE_BUFFER);
+            if(!Wipe_Fill(buf,fill)) return false;
+            for(std::uint64_t offset=0; offset<size; ){
+                std::size_t len = std::min<std::uint64_t>(WIPE_BUFFER,size-offset);
+                if(direct) len = (len+WIPE_ALIGN-1)/WIPE_ALIGN*WIPE_ALIGN;
+                ssize_t put = pwrite(fd,buf,len,offset);
+                if(put<=0) return false;
+                offset += put; written += put;
+            }
+            if(fdatasync(fd)!=0) return false;
+        }
+        // O_DIRECT writes whole blocks; give the file its old length back before discarding
+        if(direct&&size%WIPE_ALIGN!=0&&ftruncate(fd,size)!=0) return false;
+        if(size>0&&fallocate(fd,FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE,0,size)!=0
+            &&errno!=EOPNOTSUPP&&errno!=ENOSYS) return false;
+        return ftruncate(fd,0)==0;
+    }
+    enum class Wipe_Result{Wiped,Linked,Failed};
+    // Wipe one file addressed relative to dir_fd (AT_FDCWD for absolute paths); the file is not unlinked here
+    inline Wipe_Result Wipe_File_At(const int dir_fd,const char* name,const File_Wipe_Option& option,std::uint64_t& written){
+        bool direct = option.direct_io;
+        int fd = openat(dir_fd,name,O_WRONLY|O_NOFOLLOW|O_CLOEXEC|(direct ? O_DIRECT : 0));
+        if(fd<0&&direct&&errno==EINVAL){
+            direct = false;
+            fd = openat(dir_fd,name,O_WRONLY|O_NOFOLLOW|O_CLOEXEC);
+        }
+        if(fd<0) return Wipe_Result::Failed;
+        struct stat st{};
+        Wipe_Result result = Wipe_Result::Failed;
+        if(fstat(fd,&st)==0&&S_ISREG(st.st_mode))
+            result = st.st_nlink>1 ? Wipe_Result::Linked : Wipe_Fd(fd,st.st_size,option,direct,written) ? Wipe_Result::Wiped : Wipe_Result::Failed;
+        close(fd);
+        return result;
+    }
+
+    struct Wipe_Task{
+        std::string path;
+        bool folder = false;
+    };
+    class Wipe_Engine{
+        Parallel_Work_Queue<Wipe_Task> queue;
+        const File_Wipe_Option& option;
+        const File_Wipe_Report& report;
+        std::atomic<std::uint64_t> files = 0;
+        std::atomic<std::uint64_t> bytes = 0;
+        std::atomic<std::uint64_t> failed = 0;
+        std::atomic<std::uint64_t> linked = 0;
+        std::mutex report_mtx;
+        std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+        void Progress_Report(){
+            if(!report) return;
+            std::unique_lock lock(report_mtx,std::try_to_lock);
+            if(!lock.owns_lock()) return;
+            auto now = std::chrono::steady_clock::now();
+            if(now-last_report<PROGRESS_INTERVAL) return;
+            last_report = now;
+            report(files,bytes);
+        }
+        void Result_Count(const Wipe_Result result){
+            if(result==Wipe_Result::Wiped) files++;
+            else if(result==Wipe_Result::Linked) linked++;
+            else failed++;
+        }
+        // Sub-folders become tasks; each regular file is wiped by the worker that found it
+        void Folder_Wipe(const std::string& folder){
+            int dir_fd = open(folder.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+            if(dir_fd<0){ failed++; return; }
+            std::vector<std::pair<std::string,unsigned char>> entries;
+            if(!Dirent_Read_All(dir_fd,[&entries](std::uint64_t,unsigned char d_type,std::string_view name){
+                entries.emplace_back(std::string(name),d_type);
+            })) failed++;
+            for(auto& [name,d_type]: entries){
+                if(d_type==DT_UNKNOWN){
+                    struct stat st{};
+                    if(fstatat(dir_fd,name.c_str(),&st,AT_SYMLINK_NOFOLLOW)==0)
+                        d_type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+                }
+                if(d_type==DT_DIR) queue.Push(Wipe_Task{folder+"/"+name,true});
+                else if(d_type==DT_REG){
+                    std::uint64_t written = 0;
+                    Result_Count(Wipe_File_At(dir_fd,name.c_str(),option,written));
+                    bytes += written;
+                    Progress_Report();
+                }
+            }
+            close(dir_fd);
+        }
+        void File_Wipe(const std::string& file){
+            std::uint64_t written = 0;
+            Result_Count(Wipe_File_At(AT_FDCWD,file.c_str(),option,written));
+            bytes += written;
+            Progress_Report();
+        }
+    public:
+        Wipe_Engine(const File_Wipe_Option& _option,const File_Wipe_Report& _report): option(_option), report(_report) {}
+
+        // Roots are folder trees or single files; a selection of files spreads over the workers like one folder does
+        File_Wipe_Stats Run(const std::vector<Wipe_Task>& roots){
+            for(const auto& root: roots) queue.Push(root);
+            queue.Run(Parallel_Worker_Count(option.workers),[this](Wipe_Task& task){
+                if(task.folder) Folder_Wipe(task.path);
+                else File_Wipe(task.path);
+            });
+            if(report) report(files,bytes);
+            return File_Wipe_Stats{files,bytes,failed,linked,0};
+        }
+    };
+};
+
+// Wipe a file or a whole folder tree, then remove it; stats carry throughput for the caller to report
+inline File_Wipe_Stats File_Wipe_Parallel(const std::filesystem::path target_path,const File_Wipe_Option option = {},const File_Wipe_Report& report = nullptr){
+    auto begin = std::chrono::steady_clock::now();
+    File_Wipe_Stats stats;
+    struct stat st{};
+    if(lstat(target_path.c_str(),&st)!=0){
+        stats.failed = 1;
+        return stats;
+    }
+    if(S_ISDIR(st.st_mode)){
+        File_Wipe_Impl::Wipe_Engine engine(option,report);
+        stats = engine.Run({File_Wipe_Impl::Wipe_Task{target_path.string(),true}});
+    }else if(S_ISREG(st.st_mode)){
+        switch(File_Wipe_Impl::Wipe_File_At(AT_FDCWD,target_path.c_str(),option,stats.bytes)){
+            case File_Wipe_Impl::Wipe_Result::Wiped: stats.files = 1; break;
+            case File_Wipe_Impl::Wipe_Result::Linked: stats.linked = 1; break;
+            default: stats.failed = 1; break;
+        }
+        if(report) report(stats.files,stats.bytes);
+    }
+    if(!File_Remove_Parallel(target_path)) stats.failed++;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
+// Several targets (a marked selection) wiped on one worker pool, then removed together
+inline File_Wipe_Stats File_Wipe_Parallel(const std::vector<std::filesystem::path>& target_paths,const File_Wipe_Option option = {},const File_Wipe_Report& report = nullptr){
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<File_Wipe_Impl::Wipe_Task> roots;
+    std::vector<std::filesystem::path> wiped;
+    std::uint64_t failed = 0;
+    for(const auto& target_path: target_paths){
+        struct stat st{};
+        if(lstat(target_path.c_str(),&st)!=0){ failed++; continue; }
+        if(S_ISDIR(st.st_mode)||S_ISREG(st.st_mode)) roots.push_back(File_Wipe_Impl::Wipe_Task{target_path.string(),S_ISDIR(st.st_mode)});
+        wiped.push_back(target_path);
+    }
+    File_Wipe_Impl::Wipe_Engine engine(option,report);
+    File_Wipe_Stats stats = engine.Run(roots);
+    stats.failed += failed;
+    if(!File_Remove_Parallel(wiped,nullptr,option.workers)) stats.failed++;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return stats;
+}
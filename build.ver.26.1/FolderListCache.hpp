@@ -0,0 +1,160 @@
+#pragma once
+#include "GeneralFileOper.hpp"
+#include "FileEntryTable.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <cstdint>
+#include <algorithm>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// ===== Folder Listing Cache =====
+// One cached File_Entry_Table per folder; inotify marks a listing stale when the folder changes, while a write that
+// ends on an entry (IN_CLOSE_WRITE) only makes that entry's size and mtime be stat'ed again
+// Listings are read again only when stale, so cursor movement never touches the filesystem
+// Big folders stream in (File_Entry_Table::Load_Start): every request merges what was read since the last one,
+// and a listing still loading (or cancelled with Escape) is kept even when the folder changes meanwhile,
+// so the load is not restarted behind the user's back
+// Without inotify (init failure / watch limit) a folder is simply read in full on every request
+// Keys naming one folder (a path through a symlink and its real path) share a watch descriptor: the watch is
+// removed only when the last of them leaves the cache
+class Folder_List_Cache{
+    struct Cache_Entry{
+        std::shared_ptr<File_Entry_Table> entries;
+        int watch = -1;
+        bool stale = false;
+        std::uint64_t last_use = 0;
+    };
+    static constexpr std::size_t CACHE_MAX = 64;
+    static constexpr std::uint32_t WATCH_MASK = IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ATTRIB|IN_CLOSE_WRITE
+        |IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR;
+
+    int inotify_fd = -1;
+    std::uint64_t use_tick = 0;
+    std::unordered_map<std::string,Cache_Entry> cache;
+    std::unordered_map<int,std::vector<std::string>> watch_map;
+
+    Folder_List_Cache(){
+        inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    }
+    // Consume pending inotify events and mark the affected listings stale (or their written entries unstat'ed)
+    void Event_Drain(){
+        if(inotify_fd<0) return;
+        alignas(inotify_event) char buf[16*1024];
+        std::unordered_map<std::string,std::vector<std::string>> written;
+        while(true){
+            ssize_t len = read(inotify_fd,buf,sizeof(buf));
+            if(len<=0) break;
+            for(char* ptr=buf; ptr<buf+len; ){
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event)+event->len;
+                if(event->mask&IN_Q_OVERFLOW){
+                    for(auto& [key,entry]: cache) entry.stale = true;
+                    continue;
+                }
+                auto it = watch_map.find(event->wd);
+                if(it==watch_map.end()) continue;
+                if(event->mask==IN_CLOSE_WRITE&&event->len>0){
+                    for(const auto& key: it->second) written[key].emplace_back(event->name);
+                    continue;
+                }
+                for(const auto& key: it->second){
+                    auto cached = cache.find(key);
+                    if(cached==cache.end()) continue;
+                    cached->second.stale = true;
+                    if(event->mask&IN_IGNORED) cached->second.watch = -1;
+                }
+                if(event->mask&IN_IGNORED) watch_map.erase(it);
+            }
+        }
+        // A stale listing is read again anyway
+        for(const auto& [key,names]: written){
+            auto cached = cache.find(key);
+            if(cached==cache.end()||cached->second.stale) continue;
+            cached->second.entries->Entry_Stat_Forget(std::unordered_set<std::string_view>(names.begin(),names.end()));
+        }
+    }
+    // Drop key from its watch; the watch itself goes once no other key uses it
+    void Watch_Release(const int watch,const std::string& key){
+        auto it = watch_map.find(watch);
+        if(it==watch_map.end()) return;
+        std::erase(it->second,key);
+        if(!it->second.empty()) return;
+        inotify_rm_watch(inotify_fd,watch);
+        watch_map.erase(it);
+    }
+    void Entry_Erase(const std::unordered_map<std::string,Cache_Entry>::iterator it){
+        if(it->second.watch>=0) Watch_Release(it->second.watch,it->first);
+        cache.erase(it);
+    }
+    void Entry_Evict_Oldest(){
+        auto oldest = cache.begin();
+        for(auto it=cache.begin(); it!=cache.end(); ++it)
+            if(it->second.last_use<oldest->second.last_use) oldest = it;
+        if(oldest==cache.end()) return;
+        Entry_Erase(oldest);
+    }
+public:
+    Folder_List_Cache(const Folder_List_Cache&) = delete;
+    Folder_List_Cache& operator=(const Folder_List_Cache&) = delete;
+    ~Folder_List_Cache(){ if(inotify_fd>=0) close(inotify_fd); }
+
+    static Folder_List_Cache& instance(){
+        static Folder_List_Cache folder_cache;
+        return folder_cache;
+    }
+
+    // Listing of source_path, read from disk only when missing or stale
+    std::shared_ptr<File_Entry_Table> Folder_List(const std::filesystem::path source_path){
+        Event_Drain();
+        std::string key = source_path.string();
+        if(auto it = cache.find(key); it!=cache.end()&&it->second.watch>=0
+            &&(!it->second.stale||!it->second.entries->Load_Done()||it->second.entries->Load_Cancelled())){
+            it->second.last_use = ++use_tick;
+            it->second.entries->Load_Merge();
+            return it->second.entries;
+        }
+
+        // Watch before reading, so a change racing with the read still marks the listing stale
+        // (inotify hands back the existing descriptor when another key already watches this folder)
+        int watch = inotify_fd<0 ? -1 : inotify_add_watch(inotify_fd,key.c_str(),WATCH_MASK);
+        auto entries = std::make_shared<File_Entry_Table>();
+        if(!entries->Load_Start(source_path)&&watch>=0){
+            if(!watch_map.contains(watch)) inotify_rm_watch(inotify_fd,watch);
+            watch = -1;
+        }
+        if(watch<0){
+            entries->Load_Wait();
+            return entries;
+        }
+
+        // Claim the watch first, so evicting another key of the same folder leaves it in place
+        std::vector<std::string>& keys = watch_map[watch];
+        if(std::find(keys.begin(),keys.end(),key)==keys.end()) keys.push_back(key);
+        if(auto it = cache.find(key); it!=cache.end()){
+            if(it->second.watch>=0&&it->second.watch!=watch) Watch_Release(it->second.watch,key);
+        }else if(cache.size()>=CACHE_MAX) Entry_Evict_Oldest();
+        cache[key] = Cache_Entry{entries,watch,false,++use_tick};
+        return entries;
+    }
+    // A listing whose load was cancelled is read again the next time the folder is entered
+    void Folder_Load_Retry(const std::filesystem::path source_path){
+        if(auto it = cache.find(source_path.string()); it!=cache.end()&&it->second.entries->Load_Cancelled()) Entry_Erase(it);
+    }
+    // Drop a listing after our own mutation (inotify would catch it too; this avoids relying on event order)
+    // A partial listing (still loading or cancelled) is dropped so the folder is read again from the start
+    void Folder_Invalidate(const std::filesystem::path source_path){
+        auto it = cache.find(source_path.string());
+        if(it==cache.end()) return;
+        if(!it->second.entries->Load_Done()||it->second.entries->Load_Cancelled()) Entry_Erase(it);
+        else it->second.stale = true;
+    }
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include "FileEntryTable.hpp"
+#include "FileUsage.hpp"
+
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stop_token>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+// ===== Background Folder Sizes =====
+// One worker thread fills the usage column of listings the file manager shows, so drawing never waits
+// The newest request preempts the running one, which goes back to the queue with its remaining folders
+// Sizes live in the listing itself: when Folder_List_Cache reloads a changed folder they are computed again
+// Generation() changes whenever a size lands, and Parallel_Progress_Event wakes the event loop to redraw
+class Folder_Usage_Cache{
+    std::mutex mtx;
+    std::condition_variable_any cv;
+    std::deque<std::weak_ptr<File_Entry_Table>> pending;
+    const File_Entry_Table* running = nullptr;
+    std::stop_source job_stop;
+    std::atomic<std::uint64_t> generation = 0;
+    std::jthread worker;
+
+    Folder_Usage_Cache(): worker([this](std::stop_token thread_stop){ Worker_Loop(thread_stop); }) {}
+
+    // Size every sub-folder still pending; false when preempted
+    bool Table_Fill(File_Entry_Table& table,const std::stop_token job){
+        for(std::size_t idx=0; idx<table.size(); idx++){
+            if(table.Entry_DType(idx)!=DT_DIR||table.Entry_Usage(idx)) continue;
+            File_Usage_Stats stats = File_Usage_Parallel(table.Entry_Path(idx),0,job);
+            if(stats.cancelled) return false;
+            table.Entry_Usage_Store(idx,stats.apparent);
+            generation++;
+            Parallel_Progress_Event::instance().Notify();
+        }
+        return true;
+    }
+    void Worker_Loop(const std::stop_token thread_stop){
+        std::stop_callback forward_stop(thread_stop,[this]{
+            std::lock_guard lock(mtx);
+            job_stop.request_stop();
+        });
+        while(true){
+            std::shared_ptr<File_Entry_Table> table;
+            std::stop_token job;
+            {
+                std::unique_lock lock(mtx);
+                if(!cv.wait(lock,thread_stop,[this]{ return !pending.empty(); })) return;
+                table = pending.back().lock(); pending.pop_back();
+                if(!table) continue;
+                job_stop = std::stop_source();
+                job = job_stop.get_token();
+                running = table.get();
+            }
+            bool SFBoolState = Table_Fill(*table,job);
+            std::lock_guard lock(mtx);
+            running = nullptr;
+            if(thread_stop.stop_requested()) return;
+            if(!SFBoolState) pending.push_front(table);
+        }
+    }
+public:
+    Folder_Usage_Cache(const Folder_Usage_Cache&) = delete;
+    Folder_Usage_Cache& operator=(const Folder_Usage_Cache&) = delete;
+
+    static Folder_Usage_Cache& instance(){
+        static Folder_Usage_Cache usage_cache;
+        return usage_cache;
+    }
+
+    // Queue a listing for sizing (or bring a queued one to the front); cheap enough to call on every draw
+    void Request(const std::shared_ptr<File_Entry_Table>& table){
+        {
+            std::lock_guard lock(mtx);
+            if(running==table.get()) return;
+            if(!table->Usage_Request()){
+                auto it = std::find_if(pending.begin(),pending.end(),[&table](const auto& queued){ return queued.lock()==table; });
+                if(it==pending.end()||it+1==pending.end()) return;
+                pending.erase(it);
+            }
+            pending.push_back(table);
+            job_stop.request_stop();
+        }
+        cv.notify_one();
+    }
+    std::uint64_t Generation() const { return generation; }
+};
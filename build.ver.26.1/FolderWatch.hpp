@@ -0,0 +1,238 @@
+#pragma once
+#include "DirentReader.hpp"
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+// ===== Watched Folders =====
+// inotify on every folder below the roots; a file is picked up once closed after writing (IN_CLOSE_WRITE)
+// or moved in (IN_MOVED_TO), and files already there when watching starts are picked up as well
+// Names starting with '.' are skipped (temporaries of editors and downloaders)
+// Events coalesce into one batch until the folders stay quiet for settle or batch_max files are pending;
+// a file modified within the last settle period waits for the next batch (it may still be written)
+// Batches go to a single consumer thread through a queue of queue_max: while it is full the watcher stops
+// reading events, the kernel keeps queueing them and an overflow triggers a rescan, so nothing is lost
+// A file stays in flight from its batch until the consumer is done with it: events and rescans meanwhile leave it
+// pending and it is only handed over again if it still exists afterwards (written again), never twice at once
+struct Folder_Watch_Item{
+    std::filesystem::path root;
+    std::filesystem::path file;
+};
+using Folder_Watch_Batch = std::vector<Folder_Watch_Item>;
+using Folder_Watch_Consumer = std::function<void(const Folder_Watch_Batch&)>;
+struct Folder_Watch_Config{
+    std::chrono::milliseconds settle{500};
+    std::size_t batch_max = 4096;
+    std::size_t queue_max = 2;
+};
+struct Folder_Watch_Stats{
+    std::uint64_t batches = 0;
+    std::uint64_t files = 0;
+    std::uint64_t rescans = 0;
+};
+
+class Folder_Watch{
+    static constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE|IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR;
+
+    int inotify_fd = -1;
+    Folder_Watch_Config config;
+    std::vector<std::filesystem::path> roots;
+    std::unordered_map<int,std::pair<std::size_t,std::filesystem::path>> watches;
+    Folder_Watch_Batch pending;
+    std::unordered_set<std::string> pending_set;
+    Folder_Watch_Stats stats;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Folder_Watch_Batch> queue;
+    std::unordered_set<std::string> in_flight;
+    bool consumer_busy = false;
+
+    static bool Name_Skipped(const std::string_view name){ return name.empty()||name[0]=='.'; }
+
+    void Pending_Add(const std::size_t root_idx,std::filesystem::path file){
+        if(!pending_set.insert(file.native()).second) return;
+        pending.push_back(Folder_Watch_Item{roots[root_idx],std::move(file)});
+    }
+    // Watch folder and everything below it; files found on the way become pending
+    void Folder_Add_Recursive(const std::size_t root_idx,const std::filesystem::path folder){
+        int watch = inotify_add_watch(inotify_fd,folder.c_str(),WATCH_MASK);
+        if(watch<0) return;
+        watches[watch] = {root_idx,folder};
+        int dir_fd = open(folder.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC);
+        if(dir_fd<0) return;
+        std::vector<std::filesystem::path> sub_folders;
+        Dirent_Read_All(dir_fd,[&](std::uint64_t,unsigned char d_type,std::string_view name){
+            if(Name_Skipped(name)) return;
+            if(d_type==DT_UNKNOWN){
+                struct stat st{};
+                std::string name_str(name);
+                if(fstatat(dir_fd,name_str.c_str(),&st,AT_SYMLINK_NOFOLLOW)==0)
+                    d_type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            if(d_type==DT_DIR) sub_folders.push_back(folder/name);
+            else if(d_type==DT_REG) Pending_Add(root_idx,folder/name);
+        });
+        close(dir_fd);
+        for(const auto& sub_folder: sub_folders) Folder_Add_Recursive(root_idx,sub_folder);
+    }
+    void Rescan(){
+        for(const auto& [watch,target]: watches) inotify_rm_watch(inotify_fd,watch);
+        watches.clear();
+        for(std::size_t idx=0; idx<roots.size(); idx++) Folder_Add_Recursive(idx,roots[idx]);
+        stats.rescans++;
+    }
+    void Event_Drain(){
+        alignas(inotify_event) char buf[64*1024];
+        while(true){
+            ssize_t len = read(inotify_fd,buf,sizeof(buf));
+            if(len<=0) break;
+            bool overflow = false;
+            for(char* ptr=buf; ptr<buf+len; ){
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event)+event->len;
+                if(event->mask&IN_Q_OVERFLOW){ overflow = true; continue; }
+                auto it = watches.find(event->wd);
+                if(it==watches.end()) continue;
+                if(event->mask&IN_IGNORED){ watches.erase(it); continue; }
+                if(event->len==0||Name_Skipped(event->name)) continue;
+                auto [root_idx,folder] = it->second;
+                if(event->mask&IN_ISDIR){
+                    if(event->mask&(IN_CREATE|IN_MOVED_TO)) Folder_Add_Recursive(root_idx,folder/event->name);
+                }else if(event->mask&(IN_CLOSE_WRITE|IN_MOVED_TO)) Pending_Add(root_idx,folder/event->name);
+            }
+            if(overflow) Rescan();
+        }
+    }
+    // Move the pending files that are settled into the consumer queue (waits while it is full); false if none were
+    bool Batch_Submit(){
+        const auto settle_time = std::filesystem::file_time_type::clock::now()-config.settle;
+        Folder_Watch_Batch batch, still_pending;
+        std::unique_lock lock(mtx);
+        for(auto& item: pending){
+            std::error_code ec;
+            if(!std::filesystem::is_regular_file(std::filesystem::symlink_status(item.file,ec))){
+                pending_set.erase(item.file.native());
+                continue;
+            }
+            auto mtime = std::filesystem::last_write_time(item.file,ec);
+            if(ec){
+                pending_set.erase(item.file.native());
+                continue;
+            }
+            if(mtime>settle_time||batch.size()>=config.batch_max||in_flight.contains(item.file.native())){
+                still_pending.push_back(std::move(item));
+                continue;
+            }
+            pending_set.erase(item.file.native());
+            in_flight.insert(item.file.native());
+            batch.push_back(std::move(item));
+        }
+        pending = std::move(still_pending);
+        if(batch.empty()) return false;
+        stats.batches++;
+        stats.files += batch.size();
+        cv.wait(lock,[this]{ return queue.size()<config.queue_max; });
+        queue.push_back(std::move(batch));
+        cv.notify_all();
+        return true;
+    }
+    void Consumer_Loop(const std::stop_token stop,const Folder_Watch_Consumer& consumer){
+        while(true){
+            Folder_Watch_Batch batch;
+            {
+                std::unique_lock lock(mtx);
+                cv.wait(lock,[this,&stop]{ return !queue.empty()||stop.stop_requested(); });
+                if(queue.empty()) return;
+                batch = std::move(queue.front()); queue.pop_front();
+                consumer_busy = true;
+            }
+            cv.notify_all();
+            consumer(batch);
+            {
+                std::lock_guard lock(mtx);
+                for(const auto& item: batch) in_flight.erase(item.file.native());
+                consumer_busy = false;
+            }
+            cv.notify_all();
+        }
+    }
+public:
+    Folder_Watch(std::vector<std::filesystem::path> _roots,const Folder_Watch_Config _config = {})
+        : config(_config), roots(std::move(_roots)) {
+        inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    }
+    Folder_Watch(const Folder_Watch&) = delete;
+    Folder_Watch& operator=(const Folder_Watch&) = delete;
+    ~Folder_Watch(){ if(inotify_fd>=0) close(inotify_fd); }
+
+    bool Valid() const { return inotify_fd>=0; }
+
+    // Watch until stop_fd becomes readable (the line waiting there is consumed), then hand over what is left
+    // and wait for the consumer to finish; consumer runs on its own thread, one batch at a time
+    Folder_Watch_Stats Run(const int stop_fd,const Folder_Watch_Consumer& consumer){
+        if(inotify_fd<0) return stats;
+        std::jthread consumer_thread([this,&consumer](std::stop_token stop){ Consumer_Loop(stop,consumer); });
+        for(std::size_t idx=0; idx<roots.size(); idx++) Folder_Add_Recursive(idx,roots[idx]);
+        auto last_event = std::chrono::steady_clock::now()-config.settle;
+        while(!watches.empty()){
+            int timeout = -1;
+            if(!pending.empty()){
+                auto wait = config.settle-(std::chrono::steady_clock::now()-last_event);
+                timeout = std::max<long long>(0,std::chrono::duration_cast<std::chrono::milliseconds>(wait).count());
+            }
+            pollfd fds[2] = {{inotify_fd,POLLIN,0},{stop_fd,POLLIN,0}};
+            int ready = poll(fds,stop_fd>=0 ? 2 : 1,timeout);
+            if(ready<0&&errno!=EINTR) break;
+            if(stop_fd>=0&&(fds[1].revents&(POLLIN|POLLHUP))){
+                char discard[256];
+                [[maybe_unused]] ssize_t got = read(stop_fd,discard,sizeof(discard));
+                break;
+            }
+            if(fds[0].revents&POLLIN){
+                Event_Drain();
+                last_event = std::chrono::steady_clock::now();
+            }
+            // Quiet long enough, or a burst big enough for a batch of its own
+            bool quiet = std::chrono::steady_clock::now()-last_event>=config.settle;
+            if(!pending.empty()&&(quiet||pending.size()>=config.batch_max)){
+                bool SFBoolState = Batch_Submit();
+                // Only files still being written are left: look again after another settle period
+                if(quiet&&!SFBoolState) last_event = std::chrono::steady_clock::now();
+            }
+        }
+        // Files still being written stay where they are; the next run picks them up when it scans
+        // (a second round hands over files that were in flight during the first)
+        for(int round=0; round<2; round++){
+            while(Batch_Submit()){}
+            std::unique_lock lock(mtx);
+            cv.wait(lock,[this]{ return queue.empty()&&!consumer_busy; });
+        }
+        {
+            std::lock_guard lock(mtx);
+            consumer_thread.request_stop();
+        }
+        cv.notify_all();
+        return stats;
+    }
+};
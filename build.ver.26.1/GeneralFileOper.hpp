@@ -1,16 +1,48 @@
 #pragma once
+#include "FileRemove.hpp"
+#include "Utf8Width.hpp"
 #include <filesystem>
 #include <fstream>
 #include <vector>
 #include <string>
 #include <optional>
+#include <cstdio>
+#include <csignal>
+#include <ctime>
+
+#include <pthread.h>
 
 const std::filesystem::path EncStore = std::filesystem::current_path()/"Admin"/"EncStore";
 const std::filesystem::path DecStore = std::filesystem::current_path()/"Admin"/"DecStore";
 
+// ===== Broken Pipes =====
+// While alive, writing to a pipe whose reader is gone (less quit early, tar exited) fails with EPIPE instead of
+// killing the program: SIGPIPE is blocked for the calling thread, and one raised meanwhile is consumed on exit
+class Pipe_Signal_Guard{
+    sigset_t pipe_set;
+    sigset_t previous;
+public:
+    Pipe_Signal_Guard(){
+        sigemptyset(&pipe_set);
+        sigaddset(&pipe_set,SIGPIPE);
+        pthread_sigmask(SIG_BLOCK,&pipe_set,&previous);
+    }
+    Pipe_Signal_Guard(const Pipe_Signal_Guard&) = delete;
+    Pipe_Signal_Guard& operator=(const Pipe_Signal_Guard&) = delete;
+    ~Pipe_Signal_Guard(){
+        sigset_t pending;
+        if(!sigismember(&previous,SIGPIPE)&&sigpending(&pending)==0&&sigismember(&pending,SIGPIPE)){
+            timespec zero{0,0};
+            sigtimedwait(&pipe_set,nullptr,&zero);
+        }
+        pthread_sigmask(SIG_SETMASK,&previous,nullptr);
+    }
+};
+
 // ===== Text Editors =====
 // Edit file with GNU nano
 // Edit file with Vim
+// View lines in less (read-only)
 inline void File_GUN_TextCompiler(const std::filesystem::path target_file) {
     if (!std::filesystem::is_regular_file(target_file)) return;
     std::string cmd = "nano " + target_file.string();
@@ -21,6 +53,16 @@ inline void File_Vim_TextCompiler(const std::filesystem::path target_file) {
     std::string cmd = "vim -n "+target_file.string();
     system(cmd.data());
 }
+inline void File_Less_TextViewer(const std::vector<std::string>& lines) {
+    Pipe_Signal_Guard guard;
+    FILE* pipe = popen("less","w");
+    if(pipe==nullptr) return;
+    // Quitting less before the end closes the pipe: stop at the first failed write
+    for(const auto& line: lines){
+        if(fputs(line.c_str(),pipe)==EOF||fputc('\n',pipe)==EOF) break;
+    }
+    pclose(pipe);
+}
 inline bool File_Create_SFBoolStatus(const std::filesystem::path target_path){
     if(!std::filesystem::exists(target_path)) return false;
     return true;
@@ -40,7 +82,7 @@ inline void File_StoreFolder_Create(const std::filesystem::path target_folder){
 
 // ===== File/Folder Cleaning =====
 // Check if folder is empty
-// Delete folder and all contents
+// Delete folder and all contents (parallel dirfd-relative engine, see FileRemove.hpp)
 // Delete file or folder (auto-detect type)
 // Recursively delete empty parent folders
 inline bool File_Folder_CheckEmpty(const std::filesystem::path target_folder) {
@@ -49,13 +91,13 @@ inline bool File_Folder_CheckEmpty(const std::filesystem::path target_folder) {
 inline void File_TargetFolder_Clean(std::filesystem::path target_folder){
     if(!std::filesystem::exists(target_folder)) return;
     if (!std::filesystem::is_directory(target_folder)) return;
-    std::filesystem::remove_all(target_folder);
+    File_Remove_Parallel(target_folder);
 }
 inline void File_TargetGeneral_Clean(const std::filesystem::path target_file) {
     if (!std::filesystem::exists(target_file)) return;
     else if (std::filesystem::is_regular_file(target_file))
         std::filesystem::remove(target_file);
-    else std::filesystem::remove_all(target_file);
+    else File_Remove_Parallel(target_file);
 }
 inline void File_EmptyFolder_CleanParent_Recursive(const std::filesystem::path target_folder){
     if(!std::filesystem::exists(target_folder)) return;
@@ -105,15 +147,20 @@ inline std::pair<std::filesystem::path,std::error_code> Input_Path_Check_Abs(con
 
 // ===== Non-Repeating Names =====
 // File/folder type enumeration
+// First free name in target_folder (name, name_1, name_2 ...), nothing is created
 // Create file/folder with auto-increment suffix if name exists
 enum class File_Type{File,Folder,};
-inline std::filesystem::path File_Non_Repeating_Create(const File_Type file_type,const std::filesystem::path target_folder,const std::wstring filenamee) {
+inline std::filesystem::path File_Non_Repeating_Path(const std::filesystem::path target_folder,const std::wstring filenamee) {
     std::filesystem::path init_path = target_folder/filenamee;
     std::filesystem::path stem = init_path.stem();
     std::filesystem::path ext = init_path.extension();
     std::filesystem::path target_path = init_path;
-    for (int i=1; std::filesystem::exists(target_path); i++)
+    for (int i=1; std::filesystem::exists(std::filesystem::symlink_status(target_path)); i++)
         target_path = target_folder/(stem.wstring()+L"_"+std::to_wstring(i)+ext.wstring());
+    return target_path;
+}
+inline std::filesystem::path File_Non_Repeating_Create(const File_Type file_type,const std::filesystem::path target_folder,const std::wstring filenamee) {
+    std::filesystem::path target_path = File_Non_Repeating_Path(target_folder,filenamee);
     
     switch (file_type) {
         case File_Type::File: File_SingleFile_Create(target_path);break;
@@ -180,15 +227,36 @@ inline bool File_Input_FileName_Char_Check(const int key_code) {
 }
 
 // ===== String Conversion =====
-// Convert UTF-8 to wide string
+// Convert UTF-8 to wide string (invalid bytes become U+FFFD, see Utf8Width.hpp) and back
 // Count display width of wide string in terminal
-inline std::wstring String_UTF8_TO_WString(const std::string raw_str){
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> conv;
-    return conv.from_bytes(raw_str);
-}
-inline int WString_Cols_Count(std::wstring wstr){
-    int width = 0;
-    for(const auto& wc: wstr)
-        width+=wcwidth(wc);
-    return width;
+inline std::wstring String_UTF8_TO_WString(const std::string_view raw_str){
+    std::wstring wstr;
+    Utf8_Decode_Append(raw_str,wstr);
+    return wstr;
+}
+inline std::string String_WString_TO_UTF8(const std::wstring_view wstr){
+    std::string str;
+    str.reserve(wstr.size());
+    for(const wchar_t wc: wstr){
+        char32_t cp = static_cast<char32_t>(wc);
+        if(cp>0x10FFFF||(cp>=0xD800&&cp<=0xDFFF)) cp = 0xFFFD;
+        if(cp<0x80) str.push_back(static_cast<char>(cp));
+        else if(cp<0x800){
+            str.push_back(static_cast<char>(0xC0|cp>>6));
+            str.push_back(static_cast<char>(0x80|(cp&0x3F)));
+        }else if(cp<0x10000){
+            str.push_back(static_cast<char>(0xE0|cp>>12));
+            str.push_back(static_cast<char>(0x80|(cp>>6&0x3F)));
+            str.push_back(static_cast<char>(0x80|(cp&0x3F)));
+        }else{
+            str.push_back(static_cast<char>(0xF0|cp>>18));
+            str.push_back(static_cast<char>(0x80|(cp>>12&0x3F)));
+            str.push_back(static_cast<char>(0x80|(cp>>6&0x3F)));
+            str.push_back(static_cast<char>(0x80|(cp&0x3F)));
+        }
+    }
+    return str;
+}
+inline int WString_Cols_Count(const std::wstring_view wstr){
+    return WString_View_Cols_Count(wstr);
 };
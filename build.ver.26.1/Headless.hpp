@@ -0,0 +1,281 @@
+#pragma once
+#include "Shell.hpp"
+#include "FileListing.hpp"
+#include "FileManifest.hpp"
+#include "ParallelTask.hpp"
+#include "Core.hpp"
+#include "Compress.hpp"
+#include <sodium.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// ===== Headless Commands =====
+// security_tool <command> [options] <path>... runs one job without curses or locale setup and exits:
+// enc, dec, tarenc, tardec (password needed), compress, extract, verify <path> <manifest>
+// Results are JSON lines on stdout (one per path, then a summary); the exit code follows Shell_Status_Exit_Code
+struct Headless_Options{
+    std::string command;
+    std::vector<std::filesystem::path> paths;
+    unsigned workers = 0;
+    int password_fd = -1;
+    std::string password_file;
+    std::string paths_from;
+    bool dict = false;
+};
+
+inline bool Headless_Command_Known(const std::string_view name){
+    for(const std::string_view command: {"enc","dec","tarenc","tardec","compress","extract","verify"})
+        if(name==command) return true;
+    return false;
+}
+
+namespace Headless_Impl{
+    inline constexpr std::string_view USAGE =
+        "Usage: security_tool enc|dec|tarenc|tardec [-j N] [--password-fd N|--password-file PATH] [--paths-from FILE|-] <path>...\n"
+        "       security_tool compress [--dict] [-j N] [--paths-from FILE|-] <path>...\n"
+        "       security_tool extract [-j N] [--paths-from FILE|-] <archive>...\n"
+        "       security_tool verify <path> <manifest>\n"
+        "-j N runs N workers (1-32, default: all hardware threads up to 32)\n"
+        "The password defaults to the file named by SECURITY_TOOL_PASSWORD_FILE, then to a prompt on a terminal\n";
+
+    inline bool Needs_Password(const std::string_view command){
+        return command=="enc"||command=="dec"||command=="tarenc"||command=="tardec";
+    }
+
+    // JSON string: quotes, backslashes and control bytes escaped; other bytes (a non UTF-8 name) pass through
+    inline void Json_String(File_Output_Buffer& out,const std::string_view text){
+        out.Append('"');
+        for(const char ch: text){
+            if(ch=='"'||ch=='\\'){ out.Append('\\'); out.Append(ch); }
+            else if(ch=='\n') out.Append("\\n");
+            else if(ch=='\t') out.Append("\\t");
+            else if(static_cast<unsigned char>(ch)<0x20) out.Append(fmt_lib::format("\\u{:04x}",static_cast<int>(ch)));
+            else out.Append(ch);
+        }
+        out.Append('"');
+    }
+    inline void Path_Record(File_Output_Buffer& out,const std::string_view command,const std::filesystem::path& path,
+                            const bool ok,const std::string_view error = {}){
+        out.Append("{\"command\":");
+        Json_String(out,command);
+        out.Append(",\"path\":");
+        Json_String(out,path.string());
+        out.Append(ok ? ",\"ok\":true" : ",\"ok\":false");
+        if(!error.empty()){
+            out.Append(",\"error\":");
+            Json_String(out,error);
+        }
+        out.Append("}\n");
+    }
+
+    // Whole content of fd up to end of file, without one trailing newline
+    inline std::string Password_Fd_Read(const int fd){
+        std::string password;
+        password.reserve(4096);
+        char buf[256];
+        while(true){
+            ssize_t got = read(fd,buf,sizeof(buf));
+            if(got<0&&errno==EINTR) continue;
+            if(got<=0) break;
+            password.append(buf,got);
+        }
+        sodium_memzero(buf,sizeof(buf));
+        if(password.ends_with('\n')) password.pop_back();
+        if(password.ends_with('\r')) password.pop_back();
+        return password;
+    }
+    // --password-fd, then --password-file, then $SECURITY_TOOL_PASSWORD_FILE, then a prompt (twice for
+    // enc/tarenc) when stdin is a terminal; empty when none gave a password
+    inline std::string Password_Get(const Headless_Options& options){
+        if(options.password_fd>=0) return Password_Fd_Read(options.password_fd);
+        std::string file = options.password_file;
+        if(const char* env = std::getenv("SECURITY_TOOL_PASSWORD_FILE"); file.empty()&&env!=nullptr) file = env;
+        if(!file.empty()){
+            int fd = open(file.c_str(),O_RDONLY|O_CLOEXEC);
+            if(fd<0) return std::string();
+            std::string password = Password_Fd_Read(fd);
+            close(fd);
+            return password;
+        }
+        if(!isatty(STDIN_FILENO)) return std::string();
+        std::string password = Shell_Password_Read("Password: ",std::cerr);
+        if(!password.empty()&&(options.command=="enc"||options.command=="tarenc")){
+            std::string again = Shell_Password_Read("Confirm password: ",std::cerr);
+            if(again!=password){
+                sodium_memzero(password.data(),password.size());
+                password.clear();
+            }
+            sodium_memzero(again.data(),again.size());
+        }
+        return password;
+    }
+
+    // Options and paths; false (usage error) on an unknown option, a bad count or no path at all
+    inline bool Options_Parse(const std::vector<std::string>& args,Headless_Options& options){
+        options = Headless_Options{};
+        options.command = args[0];
+        bool flags_done = false;
+        std::vector<std::string> words;
+        for(std::size_t idx=1; idx<args.size(); idx++){
+            const std::string& arg = args[idx];
+            auto Value = [&](std::string& value){
+                if(idx+1>=args.size()) return false;
+                value = args[++idx];
+                return true;
+            };
+            if(flags_done||!arg.starts_with("-")){ words.push_back(arg); continue; }
+            std::string value;
+            if(arg=="--") flags_done = true;
+            else if(arg.starts_with("-j")){
+                value = arg.size()>2 ? arg.substr(2) : idx+1<args.size() ? args[++idx] : "";
+                int workers = std::atoi(value.c_str());
+                if(workers<1||workers>static_cast<int>(PARALLEL_WORKERS_MAX)) return false;
+                options.workers = workers;
+            }else if(arg=="--password-fd"&&Needs_Password(options.command)&&Value(value)){
+                char* end = nullptr;
+                long fd = std::strtol(value.c_str(),&end,10);
+                if(value.empty()||*end!='\0'||fd<0||fd>INT_MAX) return false;
+                options.password_fd = static_cast<int>(fd);
+            }else if(arg=="--password-file"&&Needs_Password(options.command)&&Value(options.password_file)){}
+            else if(arg=="--paths-from"&&options.command!="verify"&&Value(options.paths_from)){}
+            else if(arg=="--dict"&&options.command=="compress") options.dict = true;
+            else return false;
+        }
+        if(options.paths_from=="-"&&options.password_fd==STDIN_FILENO) return false;
+        if(!options.paths_from.empty()){
+            // One path per line; "-" reads them from stdin (then the password cannot come from a prompt)
+            std::ifstream file;
+            if(options.paths_from!="-"){
+                file.open(options.paths_from);
+                if(!file.is_open()) return false;
+            }
+            std::istream& input = options.paths_from=="-" ? std::cin : file;
+            for(std::string line; std::getline(input,line); ) if(!line.empty()) words.push_back(line);
+        }
+        if(options.command=="verify"&&words.size()!=2) return false;
+        for(const auto& word: words) options.paths.push_back(std::filesystem::absolute(word).lexically_normal());
+        return !options.paths.empty();
+    }
+
+    inline int Verify_Run(const Headless_Options& options,File_Output_Buffer& out){
+        const std::filesystem::path& root = options.paths[0];
+        const std::filesystem::path& manifest_path = options.paths[1];
+        File_Manifest expected, actual;
+        ShellStatus status = ShellStatus::Success;
+        std::error_code ec;
+        if(!std::filesystem::exists(root,ec)) status = ShellStatus::FileNotFound;
+        else if(!File_Manifest_Load(manifest_path,expected)) status = ShellStatus::FileOpenFailed;
+        if(status!=ShellStatus::Success){
+            out.Append("{\"command\":\"verify\",\"path\":");
+            Json_String(out,(status==ShellStatus::FileNotFound ? root : manifest_path).string());
+            out.Append(fmt_lib::format(",\"ok\":false,\"error\":\"{}\",\"exit\":{}}}\n",
+                status==ShellStatus::FileNotFound ? "not found" : "manifest unreadable",Shell_Status_Exit_Code(status)));
+            return Shell_Status_Exit_Code(status);
+        }
+        File_Manifest_Stats stats = File_Manifest_Create(root,actual,options.workers);
+        File_Manifest_Erase(actual,manifest_path.lexically_relative(root).string());
+        File_Manifest_Diff diff = File_Manifest_Compare(expected,actual);
+        auto Records = [&](const auto& paths,const std::string_view state){
+            for(const auto& path: paths){
+                out.Append("{\"command\":\"verify\",\"path\":");
+                Json_String(out,path);
+                out.Append(fmt_lib::format(",\"state\":\"{}\"}}\n",state));
+            }
+        };
+        Records(diff.changed,"changed");
+        Records(diff.missing,"missing");
+        Records(diff.added,"new");
+        if(!diff.Clean()) status = ShellStatus::VerifyFailed;
+        else if(stats.failed!=0) status = ShellStatus::PermissionDenied;
+        out.Append(fmt_lib::format("{{\"command\":\"verify\",\"files\":{},\"changed\":{},\"missing\":{},\"new\":{},\"unreadable\":{},\"seconds\":{:.3f},\"exit\":{}}}\n",
+            stats.files,diff.changed.size(),diff.missing.size(),diff.added.size(),stats.failed,stats.seconds,Shell_Status_Exit_Code(status)));
+        return Shell_Status_Exit_Code(status);
+    }
+}
+
+// Entry point for argv[1] naming a headless command (args[0] is the command)
+inline int Headless_Main(const std::vector<std::string>& args){
+    Headless_Options options;
+    if(!Headless_Impl::Options_Parse(args,options)){
+        std::cerr<<Headless_Impl::USAGE;
+        return Shell_Status_Exit_Code(ShellStatus::WrongArguments);
+    }
+    File_Output_Buffer out;
+    if(options.command=="verify") return Headless_Impl::Verify_Run(options,out);
+
+    auto begin = std::chrono::steady_clock::now();
+    // Missing paths are reported and skipped; the rest still run
+    std::vector<std::filesystem::path> targets;
+    std::uint64_t missing = 0;
+    for(const auto& path: options.paths){
+        std::error_code ec;
+        if(std::filesystem::symlink_status(path,ec).type()==std::filesystem::file_type::not_found||ec){
+            Headless_Impl::Path_Record(out,options.command,path,false,"not found");
+            missing++;
+        }else targets.push_back(path);
+    }
+    std::sort(targets.begin(),targets.end());
+    targets.erase(std::unique(targets.begin(),targets.end()),targets.end());
+
+    std::string password;
+    if(Headless_Impl::Needs_Password(options.command)&&!targets.empty()){
+        password = Headless_Impl::Password_Get(options);
+        if(password.empty()){
+            ShellStatus status = ShellStatus::PasswordMismatch;
+            out.Append(fmt_lib::format("{{\"command\":\"{}\",\"ok\":false,\"error\":\"no password\",\"exit\":{}}}\n",
+                options.command,Shell_Status_Exit_Code(status)));
+            return Shell_Status_Exit_Code(status);
+        }
+    }
+
+    // enc/dec/compress share one pool over every file (and one key derivation); the others run a path per worker,
+    // paths of one name in turn
+    std::vector<bool> target_failed(targets.size(),false);
+    if(options.command=="enc"||options.command=="dec"||(options.command=="compress"&&!options.dict)){
+        File_Batch_Action action = options.command=="enc" ? File_Batch_Action::Encrypt
+            : options.command=="dec" ? File_Batch_Action::Decrypt : File_Batch_Action::Compress;
+        target_failed = File_Batch_Run(action,targets,password,options.workers).target_failed;
+    }else{
+        // Targets of one name share their staging archive or extracted tree: those run one after another
+        std::vector<char> failed(targets.size(),0);
+        Parallel_Keyed_Run(targets.size(),options.workers,
+            [&](const std::size_t idx){ return Compress_Store_Name(targets[idx]); },
+            [&](const std::size_t idx){
+                const std::filesystem::path& target = targets[idx];
+                bool SFBoolState;
+                if(options.command=="tarenc") SFBoolState = Crypto_TUI_Interface("TarEnc",target,password);
+                else if(options.command=="tardec") SFBoolState = Crypto_TUI_Interface("TarDec",target,password);
+                else if(options.command=="compress") SFBoolState = Compress_Interface("DictCompress",target);
+                else SFBoolState = Compress_Interface(target.extension()==".zpack" ? "DictDecompress" : "Decompress",target);
+                failed[idx] = !SFBoolState;
+            });
+        for(std::size_t idx=0; idx<targets.size(); idx++) target_failed[idx] = failed[idx];
+    }
+    sodium_memzero(password.data(),password.size());
+
+    std::uint64_t done = 0, failed = 0;
+    for(std::size_t idx=0; idx<targets.size(); idx++){
+        Headless_Impl::Path_Record(out,options.command,targets[idx],!target_failed[idx]);
+        if(target_failed[idx]) failed++;
+        else done++;
+    }
+    ShellStatus status = ShellStatus::Success;
+    if(failed!=0) status = Headless_Impl::Needs_Password(options.command) ? ShellStatus::CryptoFailed : ShellStatus::FileCreateFailed;
+    else if(missing!=0) status = ShellStatus::FileNotFound;
+    out.Append(fmt_lib::format("{{\"command\":\"{}\",\"done\":{},\"failed\":{},\"missing\":{},\"seconds\":{:.3f},\"exit\":{}}}\n",
+        options.command,done,failed,missing,std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count(),
+        Shell_Status_Exit_Code(status)));
+    return Shell_Status_Exit_Code(status);
+}
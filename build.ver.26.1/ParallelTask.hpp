@@ -0,0 +1,139 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// ===== Worker Count =====
+// Upper bound for any worker pool; -j rejects larger values instead of clamping them
+inline constexpr unsigned PARALLEL_WORKERS_MAX = 32;
+
+// Requested count, or the hardware thread count when 0 (at least 1, at most PARALLEL_WORKERS_MAX)
+inline unsigned Parallel_Worker_Count(const unsigned requested = 0){
+    unsigned count = requested!=0 ? requested : std::thread::hardware_concurrency();
+    return std::clamp(count,1u,PARALLEL_WORKERS_MAX);
+}
+
+// ===== Parallel Work Queue =====
+// Shared task queue for tree walks: a task may push more tasks while it runs
+// Run() blocks until the queue is empty and every worker is idle (or Cancel() was called)
+template<typename Task>
+class Parallel_Work_Queue{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Task> tasks;
+    std::size_t busy = 0;
+    std::atomic<bool> cancelled = false;
+public:
+    void Push(Task task){
+        {
+            std::lock_guard lock(mtx);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+    void Cancel(){
+        cancelled = true;
+        cv.notify_all();
+    }
+    bool Cancelled() const { return cancelled; }
+    // Tasks waiting for a worker (a snapshot: workers may take or push meanwhile)
+    std::size_t Queued(){
+        std::lock_guard lock(mtx);
+        return tasks.size();
+    }
+
+    // worker_fn(Task&) runs on `workers` threads (the calling thread is one of them)
+    template<typename Fn>
+    void Run(const unsigned workers, Fn&& worker_fn){
+        auto Worker_Loop = [this,&worker_fn]{
+            while(true){
+                Task task;
+                {
+                    std::unique_lock lock(mtx);
+                    cv.wait(lock,[this]{return cancelled||!tasks.empty()||busy==0;});
+                    if(cancelled||tasks.empty()) break;
+                    task = std::move(tasks.front()); tasks.pop_front();
+                    busy++;
+                }
+                worker_fn(task);
+                {
+                    std::lock_guard lock(mtx);
+                    busy--;
+                }
+                cv.notify_all();
+            }
+            cv.notify_all();
+        };
+        std::vector<std::jthread> threads;
+        for(unsigned i=1; i<workers; i++) threads.emplace_back(Worker_Loop);
+        Worker_Loop();
+    }
+};
+
+// ===== Keyed Groups =====
+// Item indices grouped by key, groups in first-seen order: items whose work lands on the same paths (a staging
+// archive or output named after the input) share a key and go to one worker, one after another
+inline std::vector<std::vector<std::size_t>> Parallel_Key_Groups(const std::vector<std::string>& keys){
+    std::vector<std::vector<std::size_t>> groups;
+    std::unordered_map<std::string,std::size_t> group_of;
+    for(std::size_t idx=0; idx<keys.size(); idx++){
+        auto [it,inserted] = group_of.try_emplace(keys[idx],groups.size());
+        if(inserted) groups.emplace_back();
+        groups[it->second].push_back(idx);
+    }
+    return groups;
+}
+
+// Runs work(idx) for every idx below count on up to workers threads (0: all); indices whose key_of(idx) match
+// form one group that a single worker runs in index order
+template<typename KeyOf,typename Work>
+inline void Parallel_Keyed_Run(const std::size_t count,const unsigned workers,KeyOf&& key_of,Work&& work){
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for(std::size_t idx=0; idx<count; idx++) keys.push_back(key_of(idx));
+    Parallel_Work_Queue<std::vector<std::size_t>> queue;
+    for(auto& group: Parallel_Key_Groups(keys)) queue.Push(std::move(group));
+    queue.Run(Parallel_Worker_Count(workers),[&](std::vector<std::size_t>& group){
+        for(const std::size_t idx: group) work(idx);
+    });
+}
+
+// ===== Progress Wakeup =====
+// Background work whose result shows on screen (a size landing, a listing chunk) rings one process-wide eventfd,
+// so an event loop sleeping in poll() wakes only when there is something new to draw
+class Parallel_Progress_Event{
+    int event_fd = -1;
+    Parallel_Progress_Event(){ event_fd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC); }
+public:
+    Parallel_Progress_Event(const Parallel_Progress_Event&) = delete;
+    Parallel_Progress_Event& operator=(const Parallel_Progress_Event&) = delete;
+    ~Parallel_Progress_Event(){ if(event_fd>=0) close(event_fd); }
+
+    static Parallel_Progress_Event& instance(){
+        static Parallel_Progress_Event progress_event;
+        return progress_event;
+    }
+    // Safe from any thread; rings while nobody waits coalesce into one wakeup
+    void Notify() const {
+        if(event_fd<0) return;
+        std::uint64_t one = 1;
+        [[maybe_unused]] ssize_t put = write(event_fd,&one,sizeof(one));
+    }
+    // Readable while rings are pending; -1 when eventfd is unavailable
+    int Fd() const { return event_fd; }
+    void Drain() const {
+        if(event_fd<0) return;
+        std::uint64_t count;
+        [[maybe_unused]] ssize_t got = read(event_fd,&count,sizeof(count));
+    }
+};
@@ -0,0 +1,110 @@
+#pragma once
+#include "FolderListCache.hpp"
+#include "FileEntryView.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+// ===== Path Completion =====
+// Names of a folder that start with a prefix, taken from the cached listing (Folder_List_Cache, invalidated
+// through inotify) sorted once into a byte-order view. A lookup is two binary searches plus the matches it
+// returns, so Tab costs the same in a folder of ten entries or of hundreds of thousands; the view is only
+// re-sorted when the cache hands out a new or grown listing
+// Names starting with '.' are offered only when the prefix starts with '.'
+struct Path_Completion_Result{
+    std::string common;
+    std::vector<std::string> candidates;
+    std::size_t total = 0;
+    bool folder = false;
+};
+
+class Path_Completion_Index{
+    static constexpr std::size_t VIEW_MAX = 16;
+    std::unordered_map<std::string,std::unique_ptr<File_Entry_View>> views;
+
+    Path_Completion_Index() = default;
+
+    // Rows [first,last) whose name starts with prefix (rows are in byte order)
+    static std::pair<std::size_t,std::size_t> Prefix_Range(const File_Entry_View& view,const std::string_view prefix){
+        File_Entry_Table& table = view.Table();
+        auto Partition = [&](std::size_t first,std::size_t last,auto&& before){
+            while(first<last){
+                std::size_t mid = first+(last-first)/2;
+                if(before(table.Entry_Name(view.Entry(mid)))) first = mid+1;
+                else last = mid;
+            }
+            return first;
+        };
+        std::size_t first = Partition(0,view.size(),[&](std::string_view name){ return name<prefix; });
+        std::size_t last = Partition(first,view.size(),[&](std::string_view name){ return name.starts_with(prefix); });
+        return {first,last};
+    }
+public:
+    Path_Completion_Index(const Path_Completion_Index&) = delete;
+    Path_Completion_Index& operator=(const Path_Completion_Index&) = delete;
+
+    static Path_Completion_Index& instance(){
+        static Path_Completion_Index completion_index;
+        return completion_index;
+    }
+
+    // Complete word (a path as typed, relative to pwd or absolute); common is the whole word completed as far
+    // as every match agrees, ending in '/' when the only match is a folder; at most limit candidate names
+    Path_Completion_Result Complete(const std::filesystem::path& pwd,const std::string_view word,const std::size_t limit = 0){
+        Path_Completion_Result result;
+        std::size_t slash = word.rfind('/');
+        std::string_view folder_text = slash==std::string_view::npos ? std::string_view() : word.substr(0,slash+1);
+        std::string_view prefix = word.substr(folder_text.size());
+        std::filesystem::path folder = folder_text.empty() ? pwd : std::filesystem::path(folder_text).is_absolute()
+            ? std::filesystem::path(folder_text) : pwd/folder_text;
+        folder = folder.lexically_normal();
+        if(folder.has_relative_path()&&!folder.has_filename()) folder = folder.parent_path();
+
+        std::shared_ptr<File_Entry_Table> table = Folder_List_Cache::instance().Folder_List(folder);
+        table->Load_Wait();
+        std::string key = folder.string();
+        if(views.size()>=VIEW_MAX&&!views.contains(key)) views.clear();
+        std::unique_ptr<File_Entry_View>& view = views[key];
+        if(!view) view = std::make_unique<File_Entry_View>();
+        view->Refresh(table,File_Sort_Mode::Name);
+
+        // Matching rows, without the block of hidden names unless asked for
+        auto [first,last] = Prefix_Range(*view,prefix);
+        std::vector<std::pair<std::size_t,std::size_t>> ranges{{first,last}};
+        if(!prefix.starts_with('.')){
+            auto [hidden_first,hidden_last] = Prefix_Range(*view,".");
+            hidden_first = std::clamp(hidden_first,first,last); hidden_last = std::clamp(hidden_last,first,last);
+            ranges = {{first,hidden_first},{hidden_last,last}};
+        }
+        std::size_t front = SIZE_MAX, back = 0;
+        for(const auto& [begin,end]: ranges){
+            if(begin==end) continue;
+            result.total += end-begin;
+            front = std::min(front,begin);
+            back = end-1;
+            for(std::size_t row=begin; row<end&&result.candidates.size()<limit; row++){
+                std::size_t idx = view->Entry(row);
+                result.candidates.emplace_back(table->Entry_Name(idx));
+                if(table->Entry_Is_Directory(idx)) result.candidates.back().push_back('/');
+            }
+        }
+        if(result.total==0) return result;
+
+        // Sorted: what the first and the last match share, every match shares
+        std::string_view lhs = table->Entry_Name(view->Entry(front)), rhs = table->Entry_Name(view->Entry(back));
+        std::size_t shared = std::mismatch(lhs.begin(),lhs.end(),rhs.begin(),rhs.end()).first-lhs.begin();
+        result.common = std::string(folder_text)+std::string(lhs.substr(0,shared));
+        if(result.total==1&&table->Entry_Is_Directory(view->Entry(front))){
+            result.folder = true;
+            result.common.push_back('/');
+        }
+        return result;
+    }
+};
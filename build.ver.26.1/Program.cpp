@@ -1,7 +1,16 @@
 #include "TUI.hpp"
+#include "Headless.hpp"
 
+#include <string_view>
 
-int main(){
+
+int main(int argc, char* argv[]){
+    // Non-interactive shell: run a command file (or stdin) and exit with its status
+    if(argc>1&&std::string_view(argv[1])=="--batch")
+        return Shell_Batch_Interface(std::vector<std::string>(argv+2,argv+argc));
+    // Headless job (enc, dec, tarenc, tardec, compress, extract, verify): no curses or locale setup
+    if(argc>1&&Headless_Command_Known(argv[1]))
+        return Headless_Main(std::vector<std::string>(argv+1,argv+argc));
     TUI_Main_Event_Cycle();
     return 0;
-}
\ No newline at end of file
+}
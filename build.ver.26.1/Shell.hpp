@@ -8,11 +8,22 @@
     #include <fmt/core.h>
     #include <fmt/xchar.h>
     #include <unistd.h>
+    #include <termios.h>
     namespace fmt_lib = fmt;
 #endif
 
 
 #include "GeneralFileOper.hpp"
+#include "ShellPathCache.hpp"
+#include "FileWipe.hpp"
+#include "FileCopy.hpp"
+#include "FileFind.hpp"
+#include "FileUsage.hpp"
+#include "FileListing.hpp"
+#include "PathCompletion.hpp"
+#include "FileManifest.hpp"
+#include "FolderWatch.hpp"
+#include "Core.hpp"
 #include "typelib.hpp"
 
 #include <iostream>
@@ -22,13 +33,31 @@
 #include <filesystem>
 #include <functional>
 #include <cstdlib>
+#include <optional>
+#include <fstream>
+#include <string_view>
+#include <chrono>
+
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <variant>
+#include <charconv>
+
+#include <sys/resource.h>
+#include <glob.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 
 
 
 // ===== Feather Shell Core =====
-// cd(do) ls(do) pwd(do) mkdir(do) rm(do) rmdir(do) cp(do) mv(do) touch(do) nano(do) vim(do) man(do) exit(do)
+// cd(do) ls(do) pwd(do) mkdir(do) rm(do) rmdir(do) cp(do) mv(do) touch(do) nano(do) vim(do) man(do) exit(do) wipe(do) find(do) du(do) hash(do) verify(do) watch(do) source(do)
+// jobs(do) fg(do) wait(do)
 // echo kid_shell
-// do // enc dec temp compressenc decompressdec tartemp
+// enc(do) dec(do) tmp(do) tarenc(do) tardec(do) tartmp(do)
 
 // ===== Error Handling =====
 enum class ShellStatus{
@@ -44,6 +73,13 @@ enum class ShellStatus{
     ParaParseNULL,
     FileCreateFailed,
     FileOpenFailed,
+    VerifyFailed,
+    PasswordMismatch,
+    ScriptFailed,
+    CryptoFailed,
+    ForegroundOnly,
+    NoSuchJob,
+    JobFailed,
     UnknownError,
 };
 struct StatusMessage {
@@ -65,54 +101,331 @@ const StatusMessage StatusMessage_Map[]={
     {ShellStatus::UnknownError,"An unknown error occurred.","Please try again or contact support."},
     {ShellStatus::FileCreateFailed,"Failed to create file or folder.","Check permissions and available disk space."},
     {ShellStatus::FileOpenFailed,"Failed to open file.","Ensure the file exists and you have read permissions."},
+    {ShellStatus::PasswordMismatch,"Passwords do not match.","Type the same non-empty password twice."},
+    {ShellStatus::VerifyFailed,"Verification failed.","The tree differs from the manifest; see the entries listed above."},
+    {ShellStatus::ScriptFailed,"Script failed.","See the error reported above for the failing line."},
+    {ShellStatus::CryptoFailed,"Encryption or decryption failed for some paths.","Check the password; paths that failed were left in place."},
+    {ShellStatus::ForegroundOnly,"This command cannot run in the background.","Run it without '&'; it needs the terminal or the shell itself."},
+    {ShellStatus::NoSuchJob,"No such job.","Type 'jobs' to list the background jobs and their numbers."},
+    {ShellStatus::JobFailed,"A background job failed.","See the error shown with its Failed line above."},
 };
+// Process exit code of a batch run (0 for the statuses that are not failures)
+inline int Shell_Status_Exit_Code(const ShellStatus status){
+    switch(status){
+        case ShellStatus::StatusNULL: case ShellStatus::ExitCode: case ShellStatus::Success: return 0;
+        case ShellStatus::WrongArguments: case ShellStatus::ParaParseNULL: case ShellStatus::ForegroundOnly: case ShellStatus::NoSuchJob: return 2;
+        case ShellStatus::PathExists: return 3;
+        case ShellStatus::InvalidPath: return 4;
+        case ShellStatus::FileNotFound: return 5;
+        case ShellStatus::FileCreateFailed: return 6;
+        case ShellStatus::FileOpenFailed: return 7;
+        case ShellStatus::VerifyFailed: return 8;
+        case ShellStatus::PasswordMismatch: return 9;
+        case ShellStatus::ScriptFailed: return 10;
+        case ShellStatus::CryptoFailed: return 11;
+        case ShellStatus::PermissionDenied: return 13;
+        case ShellStatus::InvalidCommand: return 127;
+        default: return 1;
+    }
+}
+inline bool Shell_Status_Failed(const ShellStatus status){ return Shell_Status_Exit_Code(status)!=0; }
 
 using Result = Type::Result<ShellStatus,void>;
 
+// ===== Command Output =====
+// Where a run writes: the terminal, or for a background job a buffer the shell prints between prompts
+// Write may come from worker threads (find reports matches from its pool); a buffer holds at most BUFFER_MAX
+// bytes and counts what it had to drop, and rings wake_fd whenever a line is complete
+class Shell_Output{
+    static constexpr std::size_t BUFFER_MAX = 8*1024*1024;
+
+    mutable std::mutex mtx;
+    bool buffered;
+    int wake_fd;
+    std::string pending;
+    std::uint64_t dropped = 0;
+public:
+    explicit Shell_Output(const bool _buffered,const int _wake_fd = -1): buffered(_buffered), wake_fd(_wake_fd) {}
+    Shell_Output(const Shell_Output&) = delete;
+    Shell_Output& operator=(const Shell_Output&) = delete;
+
+    static Shell_Output& Terminal(){
+        static Shell_Output terminal(false);
+        return terminal;
+    }
+    bool Buffered() const {
+        std::lock_guard lock(mtx);
+        return buffered;
+    }
+    void Write(const std::string_view text){
+        std::lock_guard lock(mtx);
+        if(!buffered){ std::cout<<text; return; }
+        if(pending.size()+text.size()>BUFFER_MAX){ dropped += text.size(); return; }
+        pending.append(text);
+        if(wake_fd>=0&&text.find('\n')!=std::string_view::npos){
+            std::uint64_t one = 1;
+            [[maybe_unused]] ssize_t wrote = write(wake_fd,&one,sizeof(one));
+        }
+    }
+    // Buffered text up to its last complete line (all of it when all is set); lost receives the bytes dropped
+    std::string Take(const bool all,std::uint64_t& lost){
+        std::lock_guard lock(mtx);
+        // npos+1 wraps to 0: no complete line yet
+        std::size_t end = all ? pending.size() : pending.rfind('\n')+1;
+        std::string text = pending.substr(0,end);
+        pending.erase(0,end);
+        lost = dropped;
+        dropped = 0;
+        return text;
+    }
+    // Straight to the terminal from now on (fg), after what was buffered so far
+    void Passthrough(){
+        std::lock_guard lock(mtx);
+        std::cout<<pending;
+        if(dropped!=0) std::cout<<fmt_lib::format("({} bytes of output dropped)\n",dropped);
+        std::cout.flush();
+        pending.clear();
+        dropped = 0;
+        buffered = false;
+    }
+};
+
+// ===== Invocation Context =====
+// What one run of a command owns: its working directory (cd changes it), where it writes, whether it runs as a
+// background job, and the paths it changed (the shell drops cached resolutions at or below them afterwards)
+struct Shell_Context{
+    std::filesystem::path pwd;
+    Shell_Output* out = &Shell_Output::Terminal();
+    bool background = false;
+    std::vector<std::filesystem::path> mutated = {};
+};
+
 class MessageHandler{
-    static void show(const std::string err_msg, const std::string hint_msg){
-        std::cout<<fmt_lib::format("\033[31mError: {}\033[0m\n\033[36mHint: {}\033[0m\n",err_msg,hint_msg);
+    static void show(const std::string err_msg, const std::string hint_msg, Shell_Output& out){
+        out.Write(fmt_lib::format("\033[31mError: {}\033[0m\n\033[36mHint: {}\033[0m\n",err_msg,hint_msg));
     }
 public:
-    static void print_status(const ShellStatus status) {
+    static void print_status(const ShellStatus status, Shell_Output& out = Shell_Output::Terminal()) {
         if (status == ShellStatus::Success || status == ShellStatus::StatusNULL || status == ShellStatus::ExitCode) return;
         for (const auto& entry : StatusMessage_Map) {
             if (status == entry.status) {
-                show(entry.message, entry.hint);
+                show(entry.message, entry.hint, out);
                 break;
             }
         }
     }
-    static void print_suggestion(const std::string suggest_msg){
-        std::cout<<fmt_lib::format("\033[96mSuggest: {}\033[0m\n",suggest_msg);
+    static void print_suggestion(const std::string suggest_msg, Shell_Output& out = Shell_Output::Terminal()){
+        out.Write(fmt_lib::format("\033[96mSuggest: {}\033[0m\n",suggest_msg));
     }
-    static void print_normal_message(const std::string msg){
-        std::cout<<fmt_lib::format("{}\n",msg);
+    static void print_normal_message(const std::string msg, Shell_Output& out = Shell_Output::Terminal()){
+        out.Write(fmt_lib::format("{}\n",msg));
     }
-    static void print_path_message(const std::filesystem::path& p) {
-        std::wcout<<fmt_lib::format(L"{}\n",p.wstring());
+    static void print_path_message(const std::filesystem::path& p, Shell_Output& out = Shell_Output::Terminal()) {
+        // Narrow like every other message: once stdout turns wide-oriented, narrow writes are dropped
+        out.Write(fmt_lib::format("{}\n",p.string()));
     }
 };
 
+// ===== Password Prompt =====
+// Read one line with terminal echo off (a plain line read when stdin is not a terminal)
+// The prompt goes to out (stderr when stdout carries results)
+inline std::string Shell_Password_Read(const std::string prompt,std::ostream& out = std::cout){
+    out<<prompt;
+    out.flush();
+    termios old_term{};
+    bool is_tty = isatty(STDIN_FILENO)&&tcgetattr(STDIN_FILENO,&old_term)==0;
+    if(is_tty){
+        termios no_echo = old_term;
+        no_echo.c_lflag &= ~ECHO;
+        tcsetattr(STDIN_FILENO,TCSADRAIN,&no_echo);
+    }
+    std::string password;
+    std::getline(std::cin,password);
+    if(is_tty){
+        tcsetattr(STDIN_FILENO,TCSADRAIN,&old_term);
+        out<<"\n";
+    }
+    return password;
+}
+
+// ===== Command Line Tokenizer =====
+// POSIX-like words: blanks separate, '...' is literal, "..." keeps blanks (\ escapes " and \ inside),
+// a backslash outside quotes escapes the next character and '#' starting a word comments out the rest
+// Incomplete when a quote is still open or the line ends in a backslash: append the next line and tokenize again
+// (tokens then end with the unfinished word); word_begin, when given, receives where the word the line ends in
+// starts, line.size() when the line ends between words
+// An unquoted '&' with nothing but blanks or a comment after it ends the line and sets background
+enum class Shell_Token_Status{Complete,Incomplete};
+inline Shell_Token_Status Shell_Line_Tokenize(const std::string_view line,std::vector<std::string>& tokens,std::size_t* word_begin = nullptr,
+                                              bool* background = nullptr){
+    tokens.clear();
+    if(background!=nullptr) *background = false;
+    std::string word;
+    bool in_word = false;
+    char quote = 0;
+    std::size_t begin = 0;
+    auto Word_Start = [&](const std::size_t idx){ if(!in_word){ in_word = true; begin = idx; } };
+    auto Rest_Blank = [&](const std::size_t idx){
+        std::size_t rest = line.find_first_not_of(" \t\r\n",idx);
+        return rest==std::string_view::npos||line[rest]=='#';
+    };
+    for(std::size_t idx=0; idx<line.size(); idx++){
+        char ch = line[idx];
+        if(quote=='\''){
+            if(ch=='\'') quote = 0;
+            else word.push_back(ch);
+        }else if(quote=='"'){
+            if(ch=='"') quote = 0;
+            else if(ch=='\\'&&idx+1<line.size()&&(line[idx+1]=='"'||line[idx+1]=='\\')) word.push_back(line[++idx]);
+            else if(ch=='\\'&&idx+1<line.size()&&line[idx+1]=='\n') idx++;
+            else word.push_back(ch);
+        }else if(ch=='\\'){
+            if(idx+1==line.size()){
+                Word_Start(idx);
+                quote = ch;
+                break;
+            }
+            if(line[++idx]!='\n'){ Word_Start(idx-1); word.push_back(line[idx]); }
+        }else if(ch=='\''||ch=='"'){
+            Word_Start(idx);
+            quote = ch;
+        }else if(ch==' '||ch=='\t'||ch=='\r'||ch=='\n'){
+            if(in_word) tokens.push_back(std::move(word));
+            word.clear();
+            in_word = false;
+        }else if(ch=='&'&&Rest_Blank(idx+1)){
+            if(in_word) tokens.push_back(std::move(word));
+            word.clear();
+            in_word = false;
+            if(background!=nullptr) *background = true;
+            break;
+        }else if(ch=='#'&&!in_word){
+            // The rest may hold an unbalanced quote; it is dropped, not parsed
+            std::size_t end = line.find('\n',idx);
+            if(end==std::string_view::npos) break;
+            idx = end-1;
+        }else{
+            Word_Start(idx);
+            word.push_back(ch);
+        }
+    }
+    if(word_begin!=nullptr) *word_begin = in_word ? begin : line.size();
+    if(in_word) tokens.push_back(std::move(word));
+    return quote!=0 ? Shell_Token_Status::Incomplete : Shell_Token_Status::Complete;
+}
+// A word written so that Shell_Line_Tokenize reads it back unchanged: specials are backslash-escaped,
+// a word holding a newline (where a backslash would continue the line) is single-quoted instead
+inline std::string Shell_Word_Escape(const std::string_view word){
+    std::string text;
+    if(word.find('\n')!=std::string_view::npos){
+        text.push_back('\'');
+        for(const char ch: word){
+            if(ch=='\'') text += "'\\''";
+            else text.push_back(ch);
+        }
+        text.push_back('\'');
+        return text;
+    }
+    for(const char ch: word){
+        if(std::string_view(" \t\r'\"\\#").find(ch)!=std::string_view::npos) text.push_back('\\');
+        text.push_back(ch);
+    }
+    return text;
+}
+
+// ===== Globbing =====
+// Paths named by one argument: a pattern with * ? [ expands (sorted; a leading '.' must be matched explicitly)
+// relative to the shell's folder, anything else stands for itself; empty when a pattern matches nothing
+inline std::vector<std::string> Shell_Glob_Expand(const std::filesystem::path& pwd,const std::string& arg){
+    if(arg.find_first_of("*?[")==std::string::npos) return {arg};
+    std::filesystem::path pattern = std::filesystem::path(arg).is_absolute() ? std::filesystem::path(arg) : pwd/arg;
+    glob_t matches{};
+    std::vector<std::string> paths;
+    if(glob(pattern.c_str(),0,nullptr,&matches)==0)
+        for(std::size_t idx=0; idx<matches.gl_pathc; idx++) paths.emplace_back(matches.gl_pathv[idx]);
+    globfree(&matches);
+    return paths;
+}
+
+// ===== Command Interface =====
+// A command object is shared by every run, so nothing is kept in it between validate_args and core: what a run
+// resolves goes into a State of its own. validate_args and prompt run in the foreground (path lookups go through
+// the shell's cache, prompts read the terminal); core may run on a background job's thread
+struct Shell_Prepared{
+    ShellStatus status = ShellStatus::WrongArguments;
+    std::function<Result(Shell_Context&)> job = {};
+};
 
 class ShellCommand {
-    virtual Result core(std::filesystem::path& pwd,const std::vector<std::string>& args) = 0;
-    virtual bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) = 0;
+    Shell_Path_Cache* path_resolver = nullptr;
+protected:
+    // Resolved argument plus file type in one lookup (through the owning ShellEnv's cache when attached)
+    Shell_Path_Info path_resolve(const std::filesystem::path& pwd, const std::string& arg) const {
+        if(path_resolver!=nullptr) return path_resolver->Resolve(pwd,arg);
+        return Shell_Path_Resolve_Uncached(pwd,arg);
+    }
+    // The entry the argument names, not followed when it is a symlink (only the folders above it are resolved):
+    // for commands acting on the entry itself, like renaming a link
+    Shell_Path_Info path_resolve_entry(const std::filesystem::path& pwd, const std::string& arg) const {
+        std::filesystem::path lexical(arg), name = lexical.filename();
+        if(name.empty()||name=="."||name=="..") return path_resolve(pwd,arg);
+        Shell_Path_Info info = path_resolve(pwd,lexical.has_parent_path() ? lexical.parent_path().string() : ".");
+        if(info.ec) return info;
+        info.path /= name;
+        std::error_code status_ec;
+        switch(std::filesystem::symlink_status(info.path,status_ec).type()){
+            case std::filesystem::file_type::directory: info.type = Shell_Path_Type::Folder; break;
+            case std::filesystem::file_type::regular: info.type = Shell_Path_Type::File; break;
+            case std::filesystem::file_type::not_found: info.type = Shell_Path_Type::Missing; break;
+            default: info.type = Shell_Path_Type::Other; break;
+        }
+        return info;
+    }
 public:
     virtual ~ShellCommand() = default;
-    virtual Result execute(std::filesystem::path& pwd,const std::vector<std::string>& args) final {
-        if(!validate_args(pwd, args)) return Result(ShellStatus::WrongArguments);
-        return core(pwd,args);
+    // Arguments checked and input read; the job does the rest (there is none unless status is Success)
+    virtual Shell_Prepared prepare(const Shell_Context& ctx,const std::vector<std::string>& args) const = 0;
+    Result execute(Shell_Context& ctx,const std::vector<std::string>& args) const {
+        Shell_Prepared prepared = prepare(ctx,args);
+        if(!prepared.job) return Result(prepared.status);
+        return prepared.job(ctx);
     }
     virtual std::string help_message() const = 0;
+    // Needs the terminal while it runs (an editor, a prompt) or the shell itself: never a background job
+    virtual bool foreground_only() const { return false; }
+    void path_cache_attach(Shell_Path_Cache* resolver) { path_resolver = resolver; }
+};
+
+template<class State>
+class Shell_Command: public ShellCommand {
+    virtual Result core(Shell_Context& ctx,State& state) const = 0;
+    virtual bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,State& state) const = 0;
+    // Terminal input the run needs (a password), read before it may leave the foreground
+    virtual ShellStatus prompt(const Shell_Context&,State&) const { return ShellStatus::Success; }
+public:
+    Shell_Prepared prepare(const Shell_Context& ctx,const std::vector<std::string>& args) const final {
+        auto state = std::make_shared<State>();
+        if(!validate_args(ctx,args,*state)) return Shell_Prepared{ShellStatus::WrongArguments};
+        if(ShellStatus status = prompt(ctx,*state); status!=ShellStatus::Success) return Shell_Prepared{status};
+        return Shell_Prepared{ShellStatus::Success,[this,state](Shell_Context& run){ return core(run,*state); }};
+    }
+};
+
+// States shared by several commands: one resolved path, or several
+struct Shell_Path_State{
+    std::filesystem::path path;
+    Shell_Path_Type type = Shell_Path_Type::Missing;
+};
+struct Shell_Paths_State{
+    std::vector<std::filesystem::path> paths;
 };
 
-class PwdCommand: public ShellCommand{
-    Result core(std::filesystem::path& pwd,const std::vector<std::string>& args) override {
-        MessageHandler::print_path_message(pwd);
+class PwdCommand: public Shell_Command<std::monostate>{
+    Result core(Shell_Context& ctx,std::monostate&) const override {
+        MessageHandler::print_path_message(ctx.pwd,*ctx.out);
         return Result(ShellStatus::Success);
     }
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,std::monostate&) const override {
         if(!args.empty()) return false;
         return true;
     }
@@ -121,37 +434,36 @@ public:
         return std::string("pwd - Print current working directory\nUsage: pwd\nDescription: Display the absolute path of the current directory.");
     }
 };
-class ExitCommand: public ShellCommand {
-    Result core(std::filesystem::path& pwd,const std::vector<std::string>& args) override {
-        MessageHandler::print_normal_message("log out");
+class ExitCommand: public Shell_Command<std::monostate> {
+    Result core(Shell_Context& ctx,std::monostate&) const override {
+        MessageHandler::print_normal_message("log out",*ctx.out);
         return Result(ShellStatus::ExitCode);
     }
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,std::monostate&) const override {
         if(!args.empty()) return false;
         return true;
     }
 public:
+    bool foreground_only() const override { return true; }
     std::string help_message() const override {
         return std::string("exit - Exit the shell\nUsage: exit\nDescription: Close the current shell session and log out.");
     }
 };
-class TouchCommand: public ShellCommand {
-    std::filesystem::path path_cache;
-
-    Result core(std::filesystem::path& pwd,const std::vector<std::string>& args) override {
-        if(std::filesystem::exists(path_cache)) return Result(ShellStatus::PathExists);
-        File_SingleFile_Create(path_cache);
-        if(!File_Create_SFBoolStatus(path_cache)) return Result(ShellStatus::FileCreateFailed);
+class TouchCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.mutated.push_back(state.path);
+        if(state.type!=Shell_Path_Type::Missing) return Result(ShellStatus::PathExists);
+        File_SingleFile_Create(state.path);
+        if(!File_Create_SFBoolStatus(state.path)) return Result(ShellStatus::FileCreateFailed);
         return Result(ShellStatus::Success);
     }
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
         if(auto p=std::filesystem::path(args[0]); !p.empty()){
-            if(auto [path,ec] = File_RelativePath_To_AbsPath_Weakly(pwd,p);
-                ec||(std::filesystem::exists(path)&&std::filesystem::is_directory(path))){
+            if(auto info = path_resolve(ctx.pwd,args[0]); info.ec||info.Is_Folder()){
                 return false;
             }else{
-                path_cache = path;
+                state.path = info.path; state.type = info.type;
             }
         }
         return true;
@@ -162,90 +474,87 @@ public:
     }
 };
 
-class VimCommand: public ShellCommand {
-    std::filesystem::path path_cache;
-
-    Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-        if(std::filesystem::exists(path_cache)){
-            File_Vim_TextCompiler(path_cache);
+class VimCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.mutated.push_back(state.path);
+        if(state.type!=Shell_Path_Type::Missing){
+            File_Vim_TextCompiler(state.path);
             return Result(ShellStatus::Success);
         }else{
-            File_SingleFile_Create(path_cache);
-            if(!File_Create_SFBoolStatus(path_cache)) return Result(ShellStatus::FileOpenFailed);
-            File_Vim_TextCompiler(path_cache);
+            File_SingleFile_Create(state.path);
+            if(!File_Create_SFBoolStatus(state.path)) return Result(ShellStatus::FileOpenFailed);
+            File_Vim_TextCompiler(state.path);
             return Result(ShellStatus::Success);
         }
     }
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
         if(auto p=std::filesystem::path(args[0]); !p.empty()){
-            if(auto [path,ec]=File_RelativePath_To_AbsPath_Weakly(pwd,p);
-                ec||(std::filesystem::exists(path)&&std::filesystem::is_directory(path))){
+            if(auto info = path_resolve(ctx.pwd,args[0]); info.ec||info.Is_Folder()){
                 return false;
             }else{
-                path_cache = path;
+                state.path = info.path; state.type = info.type;
             }
         }
         return true;
     }
 public:
+    bool foreground_only() const override { return true; }
     std::string help_message() const override {
         return std::string("vim - Open Vim text editor\nUsage: vim <filename>\nDescription: Open the specified file in Vim editor. Creates the file if it doesn't exist.");
     }
 };
-class NanoCommand: public ShellCommand {
-    std::filesystem::path path_cache;
-
-    Result core(std::filesystem::path& pwd,const std::vector<std::string>& args) override {
-        if(std::filesystem::exists(path_cache)){
-            File_GUN_TextCompiler(path_cache);
+class NanoCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.mutated.push_back(state.path);
+        if(state.type!=Shell_Path_Type::Missing){
+            File_GUN_TextCompiler(state.path);
             return Result(ShellStatus::Success);
         }else{
-            File_SingleFile_Create(path_cache);
-            if(!File_Create_SFBoolStatus(path_cache)) return Result(ShellStatus::FileOpenFailed);
-            File_GUN_TextCompiler(path_cache);
+            File_SingleFile_Create(state.path);
+            if(!File_Create_SFBoolStatus(state.path)) return Result(ShellStatus::FileOpenFailed);
+            File_GUN_TextCompiler(state.path);
             return Result(ShellStatus::Success);
         }
     }
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
         if(auto p=std::filesystem::path(args[0]); !p.empty()){
-            auto [path,ec]=File_RelativePath_To_AbsPath_Weakly(pwd,p);
-            if (ec||(std::filesystem::exists(path)&&std::filesystem::is_directory(path))){
+            auto info = path_resolve(ctx.pwd,args[0]);
+            if (info.ec||info.Is_Folder()){
                 return false;
             }else {
-                path_cache = path;
+                state.path = info.path; state.type = info.type;
             }
         }
         return true;
     }
 public:
+    bool foreground_only() const override { return true; }
     std::string help_message() const override {
         return std::string("nano - Open GNU nano text editor\nUsage: nano <filename>\nDescription: Open the specified file in GNU nano editor. Creates the file if it doesn't exist.");
     }
 };
 
-class CdCommand: public ShellCommand {
-    std::filesystem::path path_cache;
-
-    Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-        pwd = path_cache;
+class CdCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.pwd = state.path;
         return Result(ShellStatus::Success);
     }
 
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
         if(auto p=std::filesystem::path(args[0]);!p.empty()){
-            if(auto [path,ec] = File_RelativePath_To_AbsPath_Abs(pwd,p);
-                ec||!std::filesystem::is_directory(path)){
+            if(auto info = path_resolve(ctx.pwd,args[0]); !info.Is_Folder()){
                 return false;
             }else{
-                path_cache = path;
+                state.path = info.path;
             }
         }
         return true;
     }
 public:    
+    bool foreground_only() const override { return true; }
     std::string help_message() const override {
         return std::string("cd - Change directory\nUsage: cd <directory>\nDescription: Change the current working directory to the specified path.");
     }
@@ -253,38 +562,68 @@ public:
 
 
 
-// class ListCommand: public ShellCommand {
-//     void show_plain(const File_Entry& Entries) const {
-//     }
-//     Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//         //wait ...
-//     }
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//         return true;
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+struct ListState{
+    File_Listing_Options options;
+    std::vector<Shell_Path_Info> paths;
+    std::vector<std::string> args;
+};
+class ListCommand: public Shell_Command<ListState> {
+    Result core(Shell_Context& ctx,ListState& state) const override {
+        // Written straight to the descriptor: anything still in std::cout goes first (a job writes to its buffer)
+        std::cout.flush();
+        File_Output_Sink sink;
+        if(ctx.out->Buffered()) sink = [&ctx](std::string_view text){ ctx.out->Write(text); return true; };
+        File_Output_Buffer out(STDOUT_FILENO,std::move(sink));
+        bool SFBoolState = true;
+        bool headers = state.paths.size()>1;
+        for(std::size_t idx=0; idx<state.paths.size(); idx++){
+            const auto& info = state.paths[idx];
+            if(!info.Is_Folder()){
+                if(!File_Listing_Write_File(info.path,state.args[idx],state.options,out)) SFBoolState = false;
+                continue;
+            }
+            if(headers){
+                if(idx!=0) out.Append('\n');
+                out.Append(state.args[idx]);
+                out.Append(":\n");
+            }
+            if(!File_Listing_Write(info.path,state.options,out)) SFBoolState = false;
+        }
+        out.Flush();
+        if(!SFBoolState) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
 
-class MkdirCommand: public ShellCommand {
-    std::filesystem::path path_cache;
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,ListState& state) const override {
+        if(!File_Listing_Options_Parse(args,state.options,state.args)) return false;
+        for(const auto& arg: state.args){
+            // ls -l describes a symlink given as an argument instead of listing where it points
+            auto info = state.options.long_format ? path_resolve_entry(ctx.pwd,arg) : path_resolve(ctx.pwd,arg);
+            if(!info.Exists()) return false;
+            state.paths.push_back(info);
+        }
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("ls - List directory contents\nUsage: ls [-lahr1SvtXU] [path...]\nDescription: List each folder in columns sized to the terminal (one per line into a pipe). -l long format (mode, size, mtime), -a include names starting with '.', -h human sizes, -r reverse, -1 one per line. Sorted by name (byte order); -S size, -t modification time, -v natural, -X type, -U directory order. Huge folders are read in one pass and only -l or a size/time sort stats the entries, in parallel.");
+    }
+};
 
-    Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-        File_StoreFolder_Create(path_cache);
+class MkdirCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.mutated.push_back(state.path);
+        File_StoreFolder_Create(state.path);
         return Result(ShellStatus::Success);
     }
 
-    bool validate_args(const std::filesystem::path& pwd, const std::vector<std::string>& args)  override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
         
-        std::filesystem::path p(args[0]);
-        if(auto [path,ec] = File_RelativePath_To_AbsPath_Weakly(pwd,p);
-            ec||(std::filesystem::exists(path))){
+        if(auto info = path_resolve(ctx.pwd,args[0]); info.ec||info.Exists()){
             return false;
         }else{
-            path_cache = path;
+            state.path = info.path;
         }
         
         return true;
@@ -295,24 +634,20 @@ public:
     }
 };
 
-class RmdirCommand: public ShellCommand {
-    std::filesystem::path path_cache;
-
-    Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-        std::filesystem::remove(path_cache);
+class RmdirCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.mutated.push_back(state.path);
+        std::filesystem::remove(state.path);
         return Result(ShellStatus::Success);
     }
 
-    bool validate_args(const std::filesystem::path& pwd,const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
         
-        std::filesystem::path p(args[0]);
-        if(auto [path,ec] = File_RelativePath_To_AbsPath_Weakly(pwd,p);
-            ec||!std::filesystem::exists(path)||
-            !std::filesystem::is_directory(path)||!File_Folder_CheckEmpty(path)){
+        if(auto info = path_resolve(ctx.pwd,args[0]); !info.Is_Folder()||!File_Folder_CheckEmpty(info.path)){
             return false;
         }else{
-            path_cache = path;
+            state.path = info.path;
         }
 
         return true;
@@ -323,148 +658,304 @@ public:
     }
 };
 
-class RemoveCommand: public ShellCommand {
-    std::filesystem::path path_cache;
-
-    Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-        std::filesystem::remove_all(path_cache);
+class RemoveCommand: public Shell_Command<Shell_Path_State> {
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override {
+        ctx.mutated.push_back(state.path);
+        bool progress_shown = false;
+        bool SFBoolState = File_Remove_Parallel(state.path,[&progress_shown,&ctx](std::uint64_t removed, std::uint64_t failed){
+            if(ctx.background) return;
+            progress_shown = true;
+            std::cout<<fmt_lib::format("\r\033[36mRemoved: {} entries, failed: {}\033[0m",removed,failed);
+            std::cout.flush();
+        });
+        if(progress_shown) std::cout<<"\n";
+        if(!SFBoolState) return Result(ShellStatus::PermissionDenied);
         return Result(ShellStatus::Success);
     }
 
-    bool validate_args(const std::filesystem::path& pwd,const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
         if(args.size()!=1) return false;
-        std::filesystem::path p(args[0]);
-        if(auto [path,ec] = File_RelativePath_To_AbsPath_Weakly(pwd,p);
-            ec||!std::filesystem::exists(path)){
+        // A symlink is removed itself, never the tree it points to
+        if(auto info = path_resolve_entry(ctx.pwd,args[0]); !info.Exists()){
             return false;
         }else{
-            path_cache = path;
+            state.path = info.path;
         }
         return true;
     }
-public:    
+public:
     std::string help_message() const override {
         return std::string("rm - Remove files or directories\nUsage: rm <path>\nDescription: Remove files or directories recursively. Use with caution as this deletes all contents.");
     }
 };
 
-// class CopyCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+struct WipeState{
+    std::filesystem::path path;
+    File_Wipe_Option option;
+};
+class WipeCommand: public Shell_Command<WipeState> {
+    Result core(Shell_Context& ctx,WipeState& state) const override {
+        ctx.mutated.push_back(state.path);
+        bool progress_shown = false;
+        File_Wipe_Stats stats = File_Wipe_Parallel(state.path,state.option,[&progress_shown,&ctx](std::uint64_t files, std::uint64_t bytes){
+            if(ctx.background) return;
+            progress_shown = true;
+            std::cout<<fmt_lib::format("\r\033[36mWiped: {} files, {:.1f} MiB\033[0m",files,bytes/1048576.0);
+            std::cout.flush();
+        });
+        if(progress_shown) std::cout<<"\n";
+        MessageHandler::print_normal_message(fmt_lib::format("{} files, {:.1f} MiB in {:.2f}s ({:.1f} MiB/s), {} failed{}",
+            stats.files,stats.bytes/1048576.0,stats.seconds,stats.Throughput_MiB(),stats.failed,
+            stats.linked!=0 ? fmt_lib::format(", {} with other hard links only unlinked",stats.linked) : ""),*ctx.out);
+        if(stats.failed!=0) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
 
-// class MoveCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,WipeState& state) const override {
+        std::vector<std::string> paths;
+        for(std::size_t idx=0; idx<args.size(); idx++){
+            if(args[idx]=="--direct") state.option.direct_io = true;
+            else if(args[idx]=="--passes"&&idx+1<args.size()){
+                int passes = std::atoi(args[++idx].c_str());
+                if(passes<1||passes>8) return false;
+                state.option.passes = passes;
+            }
+            else paths.push_back(args[idx]);
+        }
+        if(paths.size()!=1) return false;
+        // A symlink is removed itself; its target is left alone
+        if(auto info = path_resolve_entry(ctx.pwd,paths[0]); !info.Exists()){
+            return false;
+        }else{
+            state.path = info.path;
+        }
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("wipe - Securely wipe files or directories\nUsage: wipe [--direct] [--passes N] <path>\nDescription: Overwrite file contents with random data, discard the blocks, then remove the path recursively. Symlinks and files with other hard links are only removed. --direct bypasses the page cache (O_DIRECT).");
+    }
+};
 
-// class EncCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+struct CopyState{
+    std::filesystem::path path;
+    std::filesystem::path target;
+};
+class CopyCommand: public Shell_Command<CopyState> {
+    Result core(Shell_Context& ctx,CopyState& state) const override {
+        ctx.mutated.push_back(state.target);
+        bool progress_shown = false;
+        File_Copy_Stats stats = File_Copy_Parallel(state.path,state.target,[&progress_shown,&ctx](std::uint64_t files, std::uint64_t bytes){
+            if(ctx.background) return;
+            progress_shown = true;
+            std::cout<<fmt_lib::format("\r\033[36mCopied: {} files, {:.1f} MiB\033[0m",files,bytes/1048576.0);
+            std::cout.flush();
+        });
+        if(progress_shown) std::cout<<"\n";
+        if(stats.files>1||stats.failed!=0)
+            MessageHandler::print_normal_message(fmt_lib::format("{} files ({} reflinked), {:.1f} MiB in {:.2f}s ({:.1f} MiB/s), {} failed",
+                stats.files,stats.cloned,stats.bytes/1048576.0,stats.seconds,stats.Throughput_MiB(),stats.failed),*ctx.out);
+        if(stats.failed!=0) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
 
-// class DecCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,CopyState& state) const override {
+        if(args.size()!=2) return false;
+        // An existing folder receives the source under its own name, anything else must not exist yet
+        auto source = path_resolve(ctx.pwd,args[0]);
+        auto target = path_resolve(ctx.pwd,args[1]);
+        if(!source.Exists()||target.ec) return false;
+        if(target.Is_Folder()) target = path_resolve(target.path,source.path.filename().string());
+        if(target.ec||target.Exists()) return false;
+        state.path = source.path; state.target = target.path;
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("cp - Copy files or directories\nUsage: cp <source> <target>\nDescription: Copy a file or a directory tree (recursively, in parallel). If target is an existing directory the source is copied into it. Uses reflinks when the filesystem supports them.");
+    }
+};
 
-// class TempCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+class MoveCommand: public Shell_Command<CopyState> {
+    Result core(Shell_Context& ctx,CopyState& state) const override {
+        ctx.mutated.push_back(state.path);
+        ctx.mutated.push_back(state.target);
+        bool progress_shown = false;
+        bool SFBoolState = File_Move_Path(state.path,state.target,[&progress_shown,&ctx](std::uint64_t files, std::uint64_t bytes){
+            if(ctx.background) return;
+            progress_shown = true;
+            std::cout<<fmt_lib::format("\r\033[36mCopied: {} files, {:.1f} MiB\033[0m",files,bytes/1048576.0);
+            std::cout.flush();
+        });
+        if(progress_shown) std::cout<<"\n";
+        if(!SFBoolState) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
 
-// class TarCEncCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,CopyState& state) const override {
+        if(args.size()!=2) return false;
+        // An existing folder receives the source under its own name, anything else must not exist yet
+        // A symlink source is renamed itself, not the file it points to
+        auto source = path_resolve_entry(ctx.pwd,args[0]);
+        auto target = path_resolve(ctx.pwd,args[1]);
+        if(!source.Exists()||target.ec) return false;
+        if(target.Is_Folder()) target = path_resolve(target.path,source.path.filename().string());
+        if(target.ec||target.Exists()) return false;
+        state.path = source.path; state.target = target.path;
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("mv - Move or rename files or directories\nUsage: mv <source> <target>\nDescription: Rename within a filesystem; across filesystems copy then remove the source. If target is an existing directory the source is moved into it.");
+    }
+};
 
-// class DecTarXCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+// ===== Crypto Commands =====
+// enc/dec/tmp/tarenc/tardec/tartmp run the modes of Crypto_TUI_Interface on every path given (glob patterns expand)
+// The password is read once without echo (twice before encrypting); -j N caps the worker threads at N (1-32, default: all up to 32)
+// enc/dec put every file of every path on one pool with one key derivation (File_Batch_Run); tarenc/tardec run
+// one path per worker; tmp/tartmp open an editor for each path, so they go one after another
+// Patterns are expanded and the password read before the run starts, so 'enc x &' asks in the foreground
+struct CryptoState{
+    std::vector<std::string> patterns;
+    std::vector<std::filesystem::path> paths;
+    unsigned workers = 0;
+    std::string password;
 
-// class TarTempCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-//
-//     }
-//
-//     bool validate_args(const std::vector<std::string>& args) const override {
-//
-//     }
-// public:
-//     std::string help_message() const override {
-//         return std::string("...");
-//     }
-// };
+    CryptoState() = default;
+    CryptoState(const CryptoState&) = delete;
+    CryptoState& operator=(const CryptoState&) = delete;
+    ~CryptoState(){ sodium_memzero(password.data(),password.size()); }
+};
+class CryptoCommand: public Shell_Command<CryptoState> {
+    std::string crypto_type;
+    std::string verb;
+    bool confirm;
+
+    Result core(Shell_Context& ctx,CryptoState& state) const override {
+        ctx.mutated.insert(ctx.mutated.end(),state.paths.begin(),state.paths.end());
+        for(const auto& store: {EncStore,DecStore,CompressStore,DecompressStore}) ctx.mutated.push_back(store);
+        auto begin = std::chrono::steady_clock::now();
+        std::atomic<std::uint64_t> done = 0, failed = 0;
+        if(crypto_type=="Enc"||crypto_type=="Dec"){
+            File_Batch_Result result = File_Batch_Run(crypto_type=="Enc" ? File_Batch_Action::Encrypt : File_Batch_Action::Decrypt,
+                state.paths,state.password,state.workers);
+            done = result.done; failed = result.failed;
+        }else if(crypto_type=="TarEnc"||crypto_type=="TarDec"){
+            // Paths of one name share their staging archive: those run one after another
+            Parallel_Keyed_Run(state.paths.size(),state.workers,
+                [&](const std::size_t idx){ return Compress_Store_Name(state.paths[idx]); },
+                [&](const std::size_t idx){
+                    if(Crypto_TUI_Interface(crypto_type,state.paths[idx],state.password)) done++;
+                    else failed++;
+                });
+        }else{
+            for(const auto& path: state.paths){
+                if(Crypto_TUI_Interface(crypto_type,path,state.password)) done++;
+                else failed++;
+            }
+        }
+        sodium_memzero(state.password.data(),state.password.size());
+        MessageHandler::print_normal_message(fmt_lib::format("\033[36m{} {} of {} path(s) in {:.2f}s{}\033[0m",verb,done.load(),state.paths.size(),
+            std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count(),failed!=0 ? fmt_lib::format(", {} failed",failed.load()) : ""),*ctx.out);
+        if(failed!=0) return Result(ShellStatus::CryptoFailed);
+        return Result(ShellStatus::Success);
+    }
 
-// class EchoCommand: public ShellCommand {
-//     Result core(const std::filesystem::path& pwd, const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,CryptoState& state) const override {
+        for(std::size_t idx=0; idx<args.size(); idx++){
+            if(args[idx].starts_with("-j")){
+                std::string count = args[idx].size()>2 ? args[idx].substr(2) : idx+1<args.size() ? args[++idx] : "";
+                int workers = std::atoi(count.c_str());
+                if(workers<1||workers>static_cast<int>(PARALLEL_WORKERS_MAX)) return false;
+                state.workers = workers;
+            }
+            else state.patterns.push_back(args[idx]);
+        }
+        return !state.patterns.empty();
+    }
+
+    ShellStatus prompt(const Shell_Context& ctx,CryptoState& state) const override {
+        for(const auto& pattern: state.patterns){
+            auto matches = Shell_Glob_Expand(ctx.pwd,pattern);
+            if(matches.empty()) return ShellStatus::FileNotFound;
+            for(const auto& match: matches){
+                auto info = path_resolve(ctx.pwd,match);
+                if(!info.Exists()) return ShellStatus::FileNotFound;
+                state.paths.push_back(info.path);
+            }
+        }
+        // A path named twice (or matched by two patterns) runs once
+        std::sort(state.paths.begin(),state.paths.end());
+        state.paths.erase(std::unique(state.paths.begin(),state.paths.end()),state.paths.end());
+
+        state.password = Shell_Password_Read("Password: ");
+        bool SFBoolState = !state.password.empty();
+        if(SFBoolState&&confirm){
+            std::string again = Shell_Password_Read("Confirm password: ");
+            SFBoolState = state.password==again;
+            sodium_memzero(again.data(),again.size());
+        }
+        if(!SFBoolState) return ShellStatus::PasswordMismatch;
+        return ShellStatus::Success;
+    }
+public:
+    CryptoCommand(std::string _crypto_type,std::string _verb,const bool _confirm)
+        : crypto_type(std::move(_crypto_type)), verb(std::move(_verb)), confirm(_confirm) {}
+
+    // tmp/tartmp hand the terminal to an editor
+    bool foreground_only() const override { return crypto_type=="Tmp"||crypto_type=="TarTmp"; }
+};
+
+class EncCommand: public CryptoCommand {
+public:
+    EncCommand(): CryptoCommand("Enc","Encrypted",true) {}
+    std::string help_message() const override {
+        return std::string("enc - Encrypt files or folders\nUsage: enc [-j N] <path|pattern>...\nDescription: Encrypt every path into EncStore (<name>.vlt, folders keep their tree) and remove the plaintext. The password is asked twice and derived once for the whole run; files are encrypted on N threads (1-32, default: all up to 32).");
+    }
+};
+class DecCommand: public CryptoCommand {
+public:
+    DecCommand(): CryptoCommand("Dec","Decrypted",false) {}
+    std::string help_message() const override {
+        return std::string("dec - Decrypt files or folders\nUsage: dec [-j N] <path|pattern>...\nDescription: Decrypt every path into DecStore and remove the ciphertext once it decrypted completely. Files encrypted together share one key derivation; files are decrypted on N threads (1-32, default: all up to 32).");
+    }
+};
+class TempCommand: public CryptoCommand {
+public:
+    TempCommand(): CryptoCommand("Tmp","Edited",false) {}
+    std::string help_message() const override {
+        return std::string("tmp - Edit encrypted files in place\nUsage: tmp <path|pattern>...\nDescription: Decrypt each path, open it (vim for a file, the file manager for a folder), then encrypt it back into EncStore. Unchanged files keep their ciphertext. Paths are edited one after another.");
+    }
+};
+class TarCEncCommand: public CryptoCommand {
+public:
+    TarCEncCommand(): CryptoCommand("TarEnc","Archived and encrypted",true) {}
+    std::string help_message() const override {
+        return std::string("tarenc - Compress and encrypt\nUsage: tarenc [-j N] <path|pattern>...\nDescription: Pack each path into a .tar.gz and encrypt it into EncStore (<name>.tar.gz.vlt). The password is asked twice; N paths are processed at once (1-32, default: all threads up to 32).");
+    }
+};
+class DecTarXCommand: public CryptoCommand {
+public:
+    DecTarXCommand(): CryptoCommand("TarDec","Decrypted and extracted",false) {}
+    std::string help_message() const override {
+        return std::string("tardec - Decrypt and extract\nUsage: tardec [-j N] <path|pattern>...\nDescription: Decrypt each .tar.gz.vlt and extract it into DecompressStore; N archives are processed at once (1-32, default: all threads up to 32).");
+    }
+};
+class TarTempCommand: public CryptoCommand {
+public:
+    TarTempCommand(): CryptoCommand("TarTmp","Edited",false) {}
+    std::string help_message() const override {
+        return std::string("tartmp - Edit an encrypted archive\nUsage: tartmp <path|pattern>...\nDescription: Decrypt and extract each .tar.gz.vlt, open the contents, then pack and encrypt them back into EncStore. Archives are edited one after another.");
+    }
+};
+
+// class EchoCommand: public Shell_Command<std::monostate> {
+//     Result core(Shell_Context& ctx,std::monostate& state) const override {
 //
 //     }
 //
-//     bool validate_args(const std::vector<std::string>& args) const override {
+//     bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,std::monostate& state) const override {
 //
 //     }
 // public:
@@ -473,19 +964,236 @@ public:
 //     }
 // };
 
-class ManualCommand: public ShellCommand {
+struct FindState{
+    std::filesystem::path path;
+    // The root as typed: matches are printed under it, as find(1) does
+    std::string shown;
+    File_Find_Filter filter;
+};
+class FindCommand: public Shell_Command<FindState> {
+    Result core(Shell_Context& ctx,FindState& state) const override {
+        File_Find_Stats stats = File_Find_Parallel(state.path,state.filter,[&ctx](const std::string& match){
+            ctx.out->Write(match+'\n');
+            return true;
+        },0,state.shown);
+        std::cout.flush();
+        MessageHandler::print_normal_message(fmt_lib::format("\033[36m{} matches, {} entries scanned in {:.2f}s{}\033[0m",
+            stats.matched,stats.scanned,stats.seconds,stats.failed!=0 ? fmt_lib::format(", {} folders unreadable",stats.failed) : ""),*ctx.out);
+        return Result(ShellStatus::Success);
+    }
+
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,FindState& state) const override {
+        std::string root;
+        if(!File_Find_Filter_Parse(args,root,state.filter)) return false;
+        if(auto info = path_resolve(ctx.pwd,root); !info.Is_Folder()){
+            return false;
+        }else{
+            state.path = info.path;
+            state.shown = root;
+        }
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("find - Search a directory tree\nUsage: find [path] [-name|-iname GLOB] [-regex RE] [-type f|d|l] [-size [+-]N[c|k|M|G]] [-mtime [+-]N]\nDescription: Walk the tree in parallel and print matches as they are found. +N means more than N, -N less than N. Symlinks are not followed.");
+    }
+};
+
+class DiskUsageCommand: public Shell_Command<Shell_Paths_State> {
+    Result core(Shell_Context& ctx,Shell_Paths_State& state) const override {
+        bool SFBoolState = true;
+        MessageHandler::print_normal_message(fmt_lib::format("{:>9} {:>9} {:>9}  {}","allocated","apparent","files","path"),*ctx.out);
+        for(const auto& path: state.paths){
+            File_Usage_Stats stats = File_Usage_Parallel(path);
+            if(stats.failed!=0) SFBoolState = false;
+            MessageHandler::print_normal_message(fmt_lib::format("{:>9} {:>9} {:>9}  {}",
+                File_Size_Human(stats.allocated),File_Size_Human(stats.apparent),stats.files,path.string()),*ctx.out);
+        }
+        if(!SFBoolState) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
+
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Paths_State& state) const override {
+        for(const auto& arg: args.empty() ? std::vector<std::string>{"."} : args){
+            auto info = path_resolve(ctx.pwd,arg);
+            if(!info.Exists()) return false;
+            state.paths.push_back(info.path);
+        }
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("du - Show disk usage\nUsage: du [path...]\nDescription: Sum the size of each path recursively (in parallel). Shows allocated bytes (blocks on disk) and apparent bytes (file lengths); hard-linked files are counted once and symlinks are not followed.");
+    }
+};
+
+struct ManifestState{
+    std::filesystem::path path;
+    std::filesystem::path manifest;
+};
+class HashCommand: public Shell_Command<ManifestState> {
+    Result core(Shell_Context& ctx,ManifestState& state) const override {
+        if(!state.manifest.empty()) ctx.mutated.push_back(state.manifest);
+        File_Manifest manifest;
+        File_Manifest_Stats stats = File_Manifest_Create(state.path,manifest);
+        // A manifest written into the tree it describes does not list itself
+        if(!state.manifest.empty())
+            File_Manifest_Erase(manifest,state.manifest.lexically_relative(state.path).string());
+        if(state.manifest.empty()){
+            std::string lines;
+            for(const auto& entry: manifest){
+                lines += File_Manifest_Line(entry);
+                lines.push_back('\n');
+            }
+            ctx.out->Write(lines);
+            std::cout.flush();
+        }else if(!File_Manifest_Store(manifest,state.manifest)) return Result(ShellStatus::FileCreateFailed);
+        MessageHandler::print_normal_message(fmt_lib::format("\033[36m{} files, {:.1f} MiB hashed in {:.2f}s ({:.1f} MiB/s){}\033[0m",
+            stats.files,stats.bytes/1048576.0,stats.seconds,stats.Throughput_MiB(),
+            stats.failed!=0 ? fmt_lib::format(", {} unreadable",stats.failed) : ""),*ctx.out);
+        if(stats.failed!=0) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
+
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,ManifestState& state) const override {
+        if(args.empty()||args.size()>2) return false;
+        auto info = path_resolve(ctx.pwd,args[0]);
+        if(!info.Exists()) return false;
+        state.path = info.path;
+        if(args.size()==2){
+            auto manifest = path_resolve(ctx.pwd,args[1]);
+            if(manifest.ec||manifest.Is_Folder()) return false;
+            state.manifest = manifest.path;
+        }
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("hash - Create a BLAKE2b integrity manifest\nUsage: hash <path> [manifest]\nDescription: Hash every regular file below path in parallel and print a sorted manifest, or write it to the manifest file. The format is the one of b2sum, so 'b2sum -c' accepts it from inside path. Symlinks are not followed.");
+    }
+};
+
+class VerifyCommand: public Shell_Command<ManifestState> {
+    Result core(Shell_Context& ctx,ManifestState& state) const override {
+        File_Manifest expected, actual;
+        if(!File_Manifest_Load(state.manifest,expected)) return Result(ShellStatus::FileOpenFailed);
+        File_Manifest_Stats stats = File_Manifest_Create(state.path,actual);
+        File_Manifest_Erase(actual,state.manifest.lexically_relative(state.path).string());
+        File_Manifest_Diff diff = File_Manifest_Compare(expected,actual);
+        for(const auto& path: diff.changed) MessageHandler::print_normal_message(fmt_lib::format("\033[31mFAILED\033[0m  {}",path),*ctx.out);
+        for(const auto& path: diff.missing) MessageHandler::print_normal_message(fmt_lib::format("\033[31mMISSING\033[0m {}",path),*ctx.out);
+        for(const auto& path: diff.added) MessageHandler::print_normal_message(fmt_lib::format("\033[33mNEW\033[0m     {}",path),*ctx.out);
+        MessageHandler::print_normal_message(fmt_lib::format("\033[36m{} files checked in {:.2f}s ({:.1f} MiB/s): {} changed, {} missing, {} new\033[0m",
+            stats.files,stats.seconds,stats.Throughput_MiB(),diff.changed.size(),diff.missing.size(),diff.added.size()),*ctx.out);
+        if(!diff.Clean()) return Result(ShellStatus::VerifyFailed);
+        if(stats.failed!=0) return Result(ShellStatus::PermissionDenied);
+        return Result(ShellStatus::Success);
+    }
+
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,ManifestState& state) const override {
+        if(args.size()!=2) return false;
+        auto info = path_resolve(ctx.pwd,args[0]);
+        auto manifest = path_resolve(ctx.pwd,args[1]);
+        if(!info.Exists()||manifest.type!=Shell_Path_Type::File||manifest.ec) return false;
+        state.path = info.path; state.manifest = manifest.path;
+        return true;
+    }
+public:
+    std::string help_message() const override {
+        return std::string("verify - Check a tree against a BLAKE2b manifest\nUsage: verify <path> <manifest>\nDescription: Hash path again (in parallel) and list files that changed (FAILED), disappeared (MISSING) or were added (NEW) since the manifest was made by 'hash' or b2sum.");
+    }
+};
+
+struct WatchState{
+    std::vector<std::filesystem::path> paths;
+    std::string password;
+
+    WatchState() = default;
+    WatchState(const WatchState&) = delete;
+    WatchState& operator=(const WatchState&) = delete;
+    ~WatchState(){ sodium_memzero(password.data(),password.size()); }
+};
+class WatchCommand: public Shell_Command<WatchState> {
+    Result core(Shell_Context& ctx,WatchState& state) const override {
+        ctx.mutated.insert(ctx.mutated.end(),state.paths.begin(),state.paths.end());
+        ctx.mutated.push_back(EncStore);
+        Folder_Watch watcher(state.paths);
+        if(!watcher.Valid()) return Result(ShellStatus::PermissionDenied);
+        MessageHandler::print_normal_message(fmt_lib::format("\033[36mWatching {} folder(s); new files are encrypted into EncStore. Press Enter to stop.\033[0m",state.paths.size()),*ctx.out);
+        Folder_Watch_Stats stats = watcher.Run(STDIN_FILENO,[&state,&ctx](const Folder_Watch_Batch& batch){
+            Crypto_Batch_Stats batch_stats = Crypto_Batch_Encrypt(batch,state.password);
+            MessageHandler::print_normal_message(fmt_lib::format("\033[36mEncrypted {} files in {:.2f}s{}\033[0m",batch_stats.files,batch_stats.seconds,
+                batch_stats.failed!=0 ? fmt_lib::format(", {} failed",batch_stats.failed) : ""),*ctx.out);
+        });
+        sodium_memzero(state.password.data(),state.password.size());
+        MessageHandler::print_normal_message(fmt_lib::format("{} files in {} batches{}",stats.files,stats.batches,
+            stats.rescans!=0 ? fmt_lib::format(", {} rescans after event overflow",stats.rescans) : ""),*ctx.out);
+        return Result(ShellStatus::Success);
+    }
+
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,WatchState& state) const override {
+        // Without arguments: the folders configured in SECURITY_TOOL_WATCH (colon-separated)
+        std::vector<std::string> folders = args;
+        if(folders.empty()){
+            const char* env = std::getenv("SECURITY_TOOL_WATCH");
+            if(env==nullptr) return false;
+            std::string list(env);
+            for(std::size_t begin=0; begin<=list.size(); ){
+                std::size_t end = std::min(list.find(':',begin),list.size());
+                if(end>begin) folders.push_back(list.substr(begin,end-begin));
+                begin = end+1;
+            }
+        }
+        // A folder overlapping the stores would feed its own output back in
+        auto Path_Overlap = [](const std::filesystem::path& lhs,const std::filesystem::path& rhs){
+            auto Below = [](const std::filesystem::path& child,const std::filesystem::path& parent){
+                auto relative = child.lexically_relative(parent);
+                return !relative.empty()&&*relative.begin()!="..";
+            };
+            return Below(lhs,rhs)||Below(rhs,lhs);
+        };
+        for(const auto& folder: folders){
+            auto info = path_resolve(ctx.pwd,folder);
+            if(!info.Is_Folder()) return false;
+            if(Path_Overlap(info.path,EncStore)||Path_Overlap(info.path,DecStore)) return false;
+            state.paths.push_back(info.path);
+        }
+        return !state.paths.empty();
+    }
+
+    ShellStatus prompt(const Shell_Context&,WatchState& state) const override {
+        state.password = Shell_Password_Read("Password: ");
+        std::string confirm = Shell_Password_Read("Confirm password: ");
+        bool SFBoolState = !state.password.empty()&&state.password==confirm;
+        sodium_memzero(confirm.data(),confirm.size());
+        if(!SFBoolState) return ShellStatus::PasswordMismatch;
+        return ShellStatus::Success;
+    }
+public:
+    // Stopped by Enter on the terminal
+    bool foreground_only() const override { return true; }
+    std::string help_message() const override {
+        return std::string("watch - Encrypt files dropped into folders\nUsage: watch [folder...]\nDescription: Watch the folders (default: SECURITY_TOOL_WATCH, colon-separated) and encrypt every file once it is closed after writing or moved in, including files already there. Bursts are encrypted in batches with one key derivation per batch; results go to EncStore/<folder name>/ and the plaintext is removed. Names starting with '.' are ignored. Press Enter to stop.");
+    }
+};
+
+struct ManualState{
+    const ShellCommand* cmd = nullptr;
+};
+class ManualCommand: public Shell_Command<ManualState> {
     const std::unordered_map<std::string,std::unique_ptr<ShellCommand>>* cmdRegeditPtr;
 
-    Result core(std::filesystem::path& pwd, const std::vector<std::string>& args) override {
-        auto it = cmdRegeditPtr->find(args[0]);
-        auto cmd_info = it->second->help_message();
-        MessageHandler::print_normal_message(cmd_info);
+    Result core(Shell_Context& ctx,ManualState& state) const override {
+        auto cmd_info = state.cmd->help_message();
+        MessageHandler::print_normal_message(cmd_info,*ctx.out);
         return Result(ShellStatus::Success);
     }
 
-    bool validate_args(const std::filesystem::path& pwd,const std::vector<std::string>& args) override {
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,ManualState& state) const override {
         if(args.size()!=1) return false;
-        if(cmdRegeditPtr->find(args[0]) == cmdRegeditPtr->end()) return false;
+        auto it = cmdRegeditPtr->find(args[0]);
+        if(it == cmdRegeditPtr->end()) return false;
+        state.cmd = it->second.get();
         return true;
     }
 public:
@@ -496,18 +1204,373 @@ public:
         return std::string("man - Display manual for commands\nUsage: man <command>\nDescription: Show detailed help information for the specified command.");
     }
 };
+class ShellEnv;
+class SourceCommand: public Shell_Command<Shell_Path_State> {
+    ShellEnv* env;
+
+    Result core(Shell_Context& ctx,Shell_Path_State& state) const override;
+    bool validate_args(const Shell_Context& ctx,const std::vector<std::string>& args,Shell_Path_State& state) const override {
+        if(args.size()!=1) return false;
+        auto info = path_resolve(ctx.pwd,args[0]);
+        if(info.ec||info.type!=Shell_Path_Type::File) return false;
+        state.path = info.path;
+        return true;
+    }
+public:
+    explicit SourceCommand(ShellEnv* _env): env(_env) {}
+
+    // Runs its lines in this shell (cd carries over)
+    bool foreground_only() const override { return true; }
+    std::string help_message() const override {
+        return std::string("source - Run commands from a file\nUsage: source <file>\nDescription: Run the file line by line in this shell (cd carries over). Quoting works as in sh: '...', \"...\", backslash escapes, # comments, a trailing backslash continues the line. Stops at the first failing line unless the shell runs in batch mode with -k.");
+    }
+};
+
+// ===== Background Jobs =====
+// 'cmd &' runs the prepared command on a thread of its own, writing into a Shell_Output buffer; the shell prints
+// complete lines prefixed "[id] " between prompts (and while the line editor waits for a key). Every job rings one
+// eventfd for output and ending. As in sh, a job that ended keeps its status in the table until wait, fg or jobs
+// takes it; wait prints "[id] Done|Failed (seconds) cmd" then. Jobs cannot be interrupted: fg waits for one in the
+// foreground, wait for some or all, and the shell waits for the rest on exit
+struct Shell_Job_Report{
+    std::vector<std::filesystem::path> mutated;
+    std::vector<std::pair<int,ShellStatus>> finished;
+};
+
+class Shell_Job_Table{
+    struct Job{
+        int id = 0;
+        std::string text;
+        Shell_Context ctx;
+        std::unique_ptr<Shell_Output> out;
+        std::chrono::steady_clock::time_point begin, end;
+        std::atomic<bool> done = false;
+        // Thread joined and its changed paths reported
+        bool reaped = false;
+        ShellStatus status = ShellStatus::Success;
+        std::jthread thread;
+
+        double Seconds() const {
+            return std::chrono::duration<double>((reaped ? end : std::chrono::steady_clock::now())-begin).count();
+        }
+    };
+    int wake_fd = -1;
+    int last_id = 0;
+    std::vector<std::unique_ptr<Job>> jobs;
+
+    void Wake() const {
+        std::uint64_t one = 1;
+        [[maybe_unused]] ssize_t wrote = write(wake_fd,&one,sizeof(one));
+    }
+    // Buffered lines of job on the terminal (the unfinished last line too once it ended)
+    static void Output_Print(Job& job,const bool all){
+        std::uint64_t lost = 0;
+        std::string text = job.out->Take(all,lost);
+        if(!text.empty()&&text.back()!='\n') text.push_back('\n');
+        std::string prefixed;
+        for(std::size_t begin=0; begin<text.size(); ){
+            std::size_t end = text.find('\n',begin)+1;
+            prefixed += fmt_lib::format("[{}] ",job.id);
+            prefixed.append(text,begin,end-begin);
+            begin = end;
+        }
+        if(lost!=0) prefixed += fmt_lib::format("[{}] ({} bytes of output dropped)\n",job.id,lost);
+        std::cout<<prefixed;
+    }
+    static void Reap(Job& job,Shell_Job_Report& report){
+        job.thread.join();
+        job.reaped = true;
+        report.mutated.insert(report.mutated.end(),job.ctx.mutated.begin(),job.ctx.mutated.end());
+    }
+    // Hand the status of a reaped job over and drop it from the table
+    std::vector<std::unique_ptr<Job>>::iterator Take(std::vector<std::unique_ptr<Job>>::iterator it,Shell_Job_Report& report,const bool announce){
+        Job& job = **it;
+        if(announce){
+            bool failed = Shell_Status_Failed(job.status);
+            std::cout<<fmt_lib::format("\033[{}m[{}] {} ({:.2f}s) {}\033[0m\n",failed ? 31 : 36,job.id,failed ? "Failed" : "Done",job.Seconds(),job.text);
+            MessageHandler::print_status(job.status);
+        }
+        report.finished.emplace_back(job.id,job.status);
+        return jobs.erase(it);
+    }
+public:
+    Shell_Job_Table(): wake_fd(eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC)) {}
+    Shell_Job_Table(const Shell_Job_Table&) = delete;
+    Shell_Job_Table& operator=(const Shell_Job_Table&) = delete;
+    ~Shell_Job_Table(){
+        jobs.clear();
+        if(wake_fd>=0) close(wake_fd);
+    }
+
+    // Readable while a job has output or ended that Report has not shown yet
+    int Fd() const { return wake_fd; }
+    bool Running() const {
+        return std::any_of(jobs.begin(),jobs.end(),[](const auto& job){ return !job->reaped; });
+    }
+
+    int Start(std::string text,Shell_Context ctx,std::function<Result(Shell_Context&)> task){
+        auto job = std::make_unique<Job>();
+        job->id = ++last_id;
+        job->text = std::move(text);
+        job->out = std::make_unique<Shell_Output>(true,wake_fd);
+        job->ctx = std::move(ctx);
+        job->ctx.out = job->out.get();
+        job->ctx.background = true;
+        job->begin = std::chrono::steady_clock::now();
+        Job& running = *job;
+        jobs.push_back(std::move(job));
+        running.thread = std::jthread([this,&running,task = std::move(task)]{
+            ShellStatus status = ShellStatus::UnknownError;
+            try{
+                Result result = task(running.ctx);
+                if(result.is_ok()) status = result.unwrap();
+            }catch(const std::exception& e){
+                running.out->Write(fmt_lib::format("\033[31m{}\033[0m\n",e.what()));
+            }
+            running.status = status;
+            running.end = std::chrono::steady_clock::now();
+            running.done.store(true,std::memory_order_release);
+            Wake();
+        });
+        return running.id;
+    }
+
+    // Print what the jobs wrote so far and reap the ones that ended (they stay in the table, see Take)
+    Shell_Job_Report Report(){
+        std::uint64_t count;
+        [[maybe_unused]] ssize_t got = read(wake_fd,&count,sizeof(count));
+        Shell_Job_Report report;
+        for(const auto& job: jobs){
+            if(job->reaped) continue;
+            bool done = job->done.load(std::memory_order_acquire);
+            Output_Print(*job,done);
+            if(done) Reap(*job,report);
+        }
+        std::cout.flush();
+        return report;
+    }
+
+    // Job id (the latest when id is 0) finished in the foreground: its output goes straight to the terminal
+    std::optional<Shell_Job_Report> Foreground(const int id){
+        auto it = id==0 ? (jobs.empty() ? jobs.end() : jobs.end()-1)
+            : std::find_if(jobs.begin(),jobs.end(),[id](const auto& job){ return job->id==id; });
+        if(it==jobs.end()) return std::nullopt;
+        Job& job = **it;
+        std::cout<<job.text<<'\n';
+        Shell_Job_Report report;
+        if(!job.reaped){
+            job.out->Passthrough();
+            Reap(job,report);
+        }
+        Take(it,report,false);
+        return report;
+    }
+
+    // Block until the jobs in ids (all of them when empty) ended, reporting everything meanwhile
+    Shell_Job_Report Wait(std::vector<int> ids){
+        if(ids.empty()) for(const auto& job: jobs) ids.push_back(job->id);
+        auto waiting = [&ids](const auto& job){ return std::find(ids.begin(),ids.end(),job->id)!=ids.end(); };
+        Shell_Job_Report waited;
+        while(true){
+            Shell_Job_Report report = Report();
+            waited.mutated.insert(waited.mutated.end(),report.mutated.begin(),report.mutated.end());
+            bool pending = std::any_of(jobs.begin(),jobs.end(),[&waiting](const auto& job){ return waiting(job)&&!job->reaped; });
+            if(!pending) break;
+            pollfd fds{wake_fd,POLLIN,0};
+            if(poll(&fds,1,-1)<0&&errno!=EINTR) break;
+        }
+        for(auto it=jobs.begin(); it!=jobs.end(); ){
+            if(waiting(*it)&&(*it)->reaped) it = Take(it,waited,true);
+            else ++it;
+        }
+        return waited;
+    }
+
+    bool Contains(const int id) const {
+        return std::any_of(jobs.begin(),jobs.end(),[id](const auto& job){ return job->id==id; });
+    }
+    // Every job with its state; the ended ones are taken (shown once, as sh does)
+    Shell_Job_Report List(Shell_Output& out){
+        Shell_Job_Report report = Report();
+        for(auto it=jobs.begin(); it!=jobs.end(); ){
+            const Job& job = **it;
+            std::string_view state = !job.reaped ? "Running" : Shell_Status_Failed(job.status) ? "Failed" : "Done";
+            out.Write(fmt_lib::format("[{}] {} ({:.2f}s) {}\n",job.id,state,job.Seconds(),job.text));
+            if(job.reaped) it = Take(it,report,false);
+            else ++it;
+        }
+        return report;
+    }
+};
+
+// "%N" or "N" as a job id
+inline bool Shell_Job_Id_Parse(std::string_view arg,int& id){
+    if(arg.starts_with('%')) arg.remove_prefix(1);
+    auto [end,ec] = std::from_chars(arg.data(),arg.data()+arg.size(),id);
+    return ec==std::errc()&&end==arg.data()+arg.size()&&id>0;
+}
+
+class JobsCommand: public Shell_Command<std::monostate> {
+    Shell_Job_Table* jobs;
+
+    Result core(Shell_Context& ctx,std::monostate&) const override {
+        Shell_Job_Report report = jobs->List(*ctx.out);
+        ctx.mutated.insert(ctx.mutated.end(),report.mutated.begin(),report.mutated.end());
+        return Result(ShellStatus::Success);
+    }
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,std::monostate&) const override {
+        return args.empty();
+    }
+public:
+    explicit JobsCommand(Shell_Job_Table* _jobs): jobs(_jobs) {}
+
+    bool foreground_only() const override { return true; }
+    std::string help_message() const override {
+        return std::string("jobs - List background jobs\nUsage: jobs\nDescription: Show every job started with '&' that wait or fg did not take yet, with its id, state and run time. A job that ended is listed as Done or Failed once, then dropped.");
+    }
+};
+
+struct JobState{
+    std::vector<int> ids;
+};
+class ForegroundCommand: public Shell_Command<JobState> {
+    Shell_Job_Table* jobs;
+
+    Result core(Shell_Context& ctx,JobState& state) const override {
+        auto report = jobs->Foreground(state.ids.empty() ? 0 : state.ids[0]);
+        if(!report) return Result(ShellStatus::NoSuchJob);
+        ctx.mutated.insert(ctx.mutated.end(),report->mutated.begin(),report->mutated.end());
+        return Result(report->finished.front().second);
+    }
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,JobState& state) const override {
+        if(args.size()>1) return false;
+        for(const auto& arg: args){
+            int id = 0;
+            if(!Shell_Job_Id_Parse(arg,id)) return false;
+            state.ids.push_back(id);
+        }
+        return true;
+    }
+public:
+    explicit ForegroundCommand(Shell_Job_Table* _jobs): jobs(_jobs) {}
+
+    bool foreground_only() const override { return true; }
+    std::string help_message() const override {
+        return std::string("fg - Wait for a job in the foreground\nUsage: fg [%N]\nDescription: Print what job N (default: the latest) wrote so far and let the rest of its output go straight to the terminal until it ends; its status becomes the status of fg. Jobs cannot be interrupted.");
+    }
+};
+
+class WaitCommand: public Shell_Command<JobState> {
+    Shell_Job_Table* jobs;
+
+    Result core(Shell_Context& ctx,JobState& state) const override {
+        for(const int id: state.ids) if(!jobs->Contains(id)) return Result(ShellStatus::NoSuchJob);
+        Shell_Job_Report report = jobs->Wait(state.ids);
+        ctx.mutated.insert(ctx.mutated.end(),report.mutated.begin(),report.mutated.end());
+        for(const auto& [id,status]: report.finished) if(Shell_Status_Failed(status)) return Result(ShellStatus::JobFailed);
+        return Result(ShellStatus::Success);
+    }
+    bool validate_args(const Shell_Context&,const std::vector<std::string>& args,JobState& state) const override {
+        for(const auto& arg: args){
+            int id = 0;
+            if(!Shell_Job_Id_Parse(arg,id)) return false;
+            state.ids.push_back(id);
+        }
+        return true;
+    }
+public:
+    explicit WaitCommand(Shell_Job_Table* _jobs): jobs(_jobs) {}
+
+    bool foreground_only() const override { return true; }
+    std::string help_message() const override {
+        return std::string("wait - Wait for background jobs\nUsage: wait [%N...]\nDescription: Block until the given jobs (default: all) ended, printing their output as it arrives. Fails when one of them failed (its error was shown when it ended).");
+    }
+};
+
+// ===== Batch Options =====
+// keep_going: run on after a failing line (the batch still ends with the last failure's exit code)
+// timing: per-command wall/CPU time and rusage on stderr (a single command can also be prefixed with 'time')
+// echo: every command on stderr before it runs, prefixed with '+'
+struct Shell_Batch_Options{
+    bool keep_going = false;
+    bool timing = false;
+    bool echo = false;
+};
+// Resource usage of this process and its waited-for children (editors), summed
+struct Shell_Usage_Sample{
+    std::chrono::steady_clock::time_point wall;
+    rusage self{};
+    rusage children{};
+
+    static Shell_Usage_Sample Take(){
+        Shell_Usage_Sample sample;
+        sample.wall = std::chrono::steady_clock::now();
+        getrusage(RUSAGE_SELF,&sample.self);
+        getrusage(RUSAGE_CHILDREN,&sample.children);
+        return sample;
+    }
+};
+// "[time] <command>: wall ... user ... sys ..." from two samples (maxrss is the peak so far, not a delta)
+inline std::string Shell_Usage_Format(const std::string& command,const Shell_Usage_Sample& begin,const Shell_Usage_Sample& end){
+    auto Seconds = [](const timeval& tv){ return tv.tv_sec+tv.tv_usec/1e6; };
+    auto Delta = [&](auto field){ return (end.self.*field-begin.self.*field)+(end.children.*field-begin.children.*field); };
+    double wall = std::chrono::duration<double>(end.wall-begin.wall).count();
+    double user = Seconds(end.self.ru_utime)-Seconds(begin.self.ru_utime)+Seconds(end.children.ru_utime)-Seconds(begin.children.ru_utime);
+    double sys = Seconds(end.self.ru_stime)-Seconds(begin.self.ru_stime)+Seconds(end.children.ru_stime)-Seconds(begin.children.ru_stime);
+    return fmt_lib::format("[time] {}: wall {:.3f}s user {:.3f}s sys {:.3f}s cpu {:.0f}% maxrss {:.1f}MiB minflt {} majflt {} inblock {} oublock {} ctxsw {}/{}",
+        command,wall,user,sys,wall>0 ? (user+sys)/wall*100 : 0.0,end.self.ru_maxrss/1024.0,
+        Delta(&rusage::ru_minflt),Delta(&rusage::ru_majflt),Delta(&rusage::ru_inblock),Delta(&rusage::ru_oublock),
+        Delta(&rusage::ru_nvcsw),Delta(&rusage::ru_nivcsw));
+}
+
 // ===== Shell Core Class =====
 
 
 
+// ===== Completion =====
+// line replaces the text before the cursor; candidates (at most COMPLETION_LIST_MAX of total) are listed
+// when a second Tab makes no progress
+struct Shell_Completion{
+    static constexpr std::size_t COMPLETION_LIST_MAX = 256;
+    std::string line;
+    std::vector<std::string> candidates = {};
+    std::size_t total = 0;
+};
+
 class ShellEnv{
+    static constexpr int SOURCE_DEPTH_MAX = 16;
+
     std::filesystem::path curPath;
+    Shell_Path_Cache pathCache;
     std::unordered_map<std::string,std::unique_ptr<ShellCommand>> cmdRegedit;
+    // After cmdRegedit: running jobs call into the commands, so they are joined first
+    Shell_Job_Table jobTable;
+    Shell_Batch_Options batchOptions;
+    int sourceDepth = 0;
+    // Status of the line a nested script failed on (reported there already)
+    ShellStatus scriptStatus = ShellStatus::Success;
+
+    // Tokens joined back into a line that tokenizes the same way (words with blanks or quotes are single-quoted)
+    static std::string Command_Text(const std::vector<std::string>& tokens){
+        std::string text;
+        for(const auto& token: tokens){
+            if(!text.empty()) text.push_back(' ');
+            if(!token.empty()&&token.find_first_of(" \t\r\n'\"\\#")==std::string::npos){ text += token; continue; }
+            text.push_back('\'');
+            for(char ch: token){
+                if(ch=='\'') text += "'\\''";
+                else text.push_back(ch);
+            }
+            text.push_back('\'');
+        }
+        return text;
+    }
 public:
     virtual ~ShellEnv() = default;
     explicit ShellEnv(const std::filesystem::path _p): curPath(_p) {
         register_command("pwd", std::make_unique<PwdCommand>());
         register_command("cd", std::make_unique<CdCommand>());
+        register_command("ls", std::make_unique<ListCommand>());
         register_command("touch", std::make_unique<TouchCommand>());
         register_command("vim", std::make_unique<VimCommand>());
         register_command("nano", std::make_unique<NanoCommand>());
@@ -515,42 +1578,97 @@ public:
         register_command("mkdir", std::make_unique<MkdirCommand>());
         register_command("rmdir", std::make_unique<RmdirCommand>());
         register_command("rm", std::make_unique<RemoveCommand>());
+        register_command("wipe", std::make_unique<WipeCommand>());
+        register_command("cp", std::make_unique<CopyCommand>());
+        register_command("mv", std::make_unique<MoveCommand>());
+        register_command("find", std::make_unique<FindCommand>());
+        register_command("du", std::make_unique<DiskUsageCommand>());
+        register_command("hash", std::make_unique<HashCommand>());
+        register_command("verify", std::make_unique<VerifyCommand>());
+        register_command("watch", std::make_unique<WatchCommand>());
+        register_command("enc", std::make_unique<EncCommand>());
+        register_command("dec", std::make_unique<DecCommand>());
+        register_command("tmp", std::make_unique<TempCommand>());
+        register_command("tarenc", std::make_unique<TarCEncCommand>());
+        register_command("tardec", std::make_unique<DecTarXCommand>());
+        register_command("tartmp", std::make_unique<TarTempCommand>());
+        register_command("source", std::make_unique<SourceCommand>(this));
         register_command("man", std::make_unique<ManualCommand>(&cmdRegedit));
+        register_command("jobs", std::make_unique<JobsCommand>(&jobTable));
+        register_command("fg", std::make_unique<ForegroundCommand>(&jobTable));
+        register_command("wait", std::make_unique<WaitCommand>(&jobTable));
     }
 
-    void SystInfo() const {
+    // user@host path$ (colored)
+    std::string Prompt() const {
+        std::string prompt;
         //WIN32 wait test
 #ifdef _WIN32
         char username[256];
         DWORD size = sizeof(username);
         if (GetUserNameA(username, &size)) {
-            std::cout<<fmt_lib::format("\033[032m{}\033[0m@", username);
+            prompt += fmt_lib::format("\033[032m{}\033[0m@", username);
         }
         char computername[256];
         size = sizeof(computername);
         if (GetComputerNameA(computername, &size)) {
-            std::cout<<fmt_lib::format("\033[033m{}\033[0m", computername);
+            prompt += fmt_lib::format("\033[033m{}\033[0m", computername);
         }
 #else
         const char* username = std::getenv("USER");
         if (username) {
-            std::cout<<fmt_lib::format("\033[032m{}\033[0m@", username);
+            prompt += fmt_lib::format("\033[032m{}\033[0m@", username);
         }
         char hostname[256];
         if (gethostname(hostname, sizeof(hostname)) == 0) {
-            std::cout<<fmt_lib::format("\033[033m{}\033[0m", hostname);
+            prompt += fmt_lib::format("\033[033m{}\033[0m", hostname);
         }
 #endif
-        std::cout << " ";
-        std::cout.flush();
+        prompt += fmt_lib::format(" \033[035m{}\033[0m\033[033m$\033[0m ",curPath.string());
+        return prompt;
     }
 
-    void PathInfo() const {
-        std::wcout<<fmt_lib::format(L"\033[035m{}\033[0m\033[033m$\033[0m ",curPath.wstring());
-        std::cout.flush();
+    // Complete the word before the cursor: a command name first (also after 'time'), a path relative to the
+    // current directory after that (Path_Completion_Index); a unique match is closed with a space, or a '/'
+    // for a folder. Line is before unchanged when the word cannot grow
+    Shell_Completion Complete(const std::string_view before) const {
+        Shell_Completion completion{std::string(before)};
+        std::vector<std::string> tokens;
+        std::size_t word_begin = 0;
+        Shell_Line_Tokenize(before,tokens,&word_begin);
+        bool in_word = word_begin<before.size();
+        std::string word = in_word ? tokens.back() : std::string();
+        std::size_t word_index = tokens.size()-(in_word ? 1 : 0);
+        bool unique_file = false;
+        std::string common;
+        if(word_index==0||(word_index==1&&tokens[0]=="time")){
+            std::vector<std::string> names;
+            for(const auto& [name,cmd]: cmdRegedit) if(name.starts_with(word)) names.push_back(name);
+            if(word_index==0&&std::string_view("time").starts_with(word)) names.push_back("time");
+            std::sort(names.begin(),names.end());
+            if(names.empty()) return completion;
+            common = names.front();
+            for(const auto& name: names) common.resize(std::mismatch(common.begin(),common.end(),name.begin(),name.end()).first-common.begin());
+            completion.total = names.size();
+            if(names.size()>Shell_Completion::COMPLETION_LIST_MAX) names.resize(Shell_Completion::COMPLETION_LIST_MAX);
+            completion.candidates = std::move(names);
+            unique_file = completion.total==1;
+        }else{
+            Path_Completion_Result result = Path_Completion_Index::instance().Complete(curPath,word,Shell_Completion::COMPLETION_LIST_MAX);
+            if(result.total==0) return completion;
+            common = std::move(result.common);
+            completion.total = result.total;
+            completion.candidates = std::move(result.candidates);
+            unique_file = result.total==1&&!result.folder;
+        }
+        if(common.size()<=word.size()&&!unique_file) return completion;
+        completion.line = std::string(before.substr(0,word_begin))+Shell_Word_Escape(common);
+        if(unique_file) completion.line.push_back(' ');
+        return completion;
     }
 
     void register_command(const std::string cmd,std::unique_ptr<ShellCommand> _cmd){
+        _cmd->path_cache_attach(&pathCache);
         cmdRegedit[cmd] = std::move(_cmd);
     }
 
@@ -561,11 +1679,470 @@ public:
     Result execute(const std::string cmd,const std::vector<std::string>& args) {
         if(!check_cmd(cmd)) return Result(ShellStatus::InvalidCommand);
         auto it = cmdRegedit.find(cmd);
-        return it->second->execute(curPath,args);
+        Shell_Context ctx{curPath};
+        Result result = it->second->execute(ctx,args);
+        curPath = ctx.pwd;
+        for(const auto& changed: ctx.mutated) pathCache.Invalidate(changed);
+        return result;
+    }
+
+    // Output and endings of background jobs since the last call (see Shell_Job_Table::Report)
+    void Jobs_Report(){
+        for(const auto& changed: jobTable.Report().mutated) pathCache.Invalidate(changed);
+    }
+    int Jobs_Fd() const { return jobTable.Fd(); }
+    bool Jobs_Running() const { return jobTable.Running(); }
+    // Failure status of the first job that failed meanwhile, Success if none did
+    ShellStatus Jobs_Wait_All(){
+        Shell_Job_Report report = jobTable.Wait({});
+        for(const auto& changed: report.mutated) pathCache.Invalidate(changed);
+        for(const auto& [id,status]: report.finished) if(Shell_Status_Failed(status)) return status;
+        return ShellStatus::Success;
+    }
+    const std::filesystem::path& Pwd() const { return curPath; }
+
+    const Shell_Batch_Options& Batch_Options() const { return batchOptions; }
+    void Batch_Options_Set(const Shell_Batch_Options options) { batchOptions = options; }
+    ShellStatus Script_Status() const { return scriptStatus; }
+
+    // One tokenized command line; a leading 'time' reports its usage even when timing is off
+    // In the background the command is prepared here (arguments, password prompt) and started as a job;
+    // timing does not apply to it
+    ShellStatus Run_Line(std::vector<std::string> tokens,const bool background = false){
+        bool timing = batchOptions.timing;
+        if(!tokens.empty()&&tokens[0]=="time"){
+            timing = true;
+            tokens.erase(tokens.begin());
+        }
+        if(tokens.empty()) return ShellStatus::WrongArguments;
+        std::string text = Command_Text(tokens);
+        if(batchOptions.echo) std::cerr<<"+ "<<text<<(background ? " &\n" : "\n");
+        if(background){
+            auto it = cmdRegedit.find(tokens[0]);
+            if(it==cmdRegedit.end()) return ShellStatus::InvalidCommand;
+            if(it->second->foreground_only()) return ShellStatus::ForegroundOnly;
+            Shell_Context ctx{curPath};
+            Shell_Prepared prepared = it->second->prepare(ctx,std::vector(tokens.begin()+1,tokens.end()));
+            if(!prepared.job) return prepared.status;
+            int id = jobTable.Start(text,std::move(ctx),std::move(prepared.job));
+            MessageHandler::print_normal_message(fmt_lib::format("[{}] {}",id,text));
+            std::cout.flush();
+            return ShellStatus::Success;
+        }
+        Shell_Usage_Sample begin = Shell_Usage_Sample::Take();
+        Result result = execute(tokens[0],std::vector(tokens.begin()+1,tokens.end()));
+        std::cout.flush();
+        if(timing) std::cerr<<Shell_Usage_Format(text,begin,Shell_Usage_Sample::Take())<<std::endl;
+        if(!result.is_ok()) return ShellStatus::UnknownError;
+        return result.unwrap();
+    }
+
+    // Run a script line by line; failures are reported as "<origin>:<line>: <command>" before the status message
+    // Returns ExitCode when 'exit' ran, otherwise the status of the last failing line (Success if none failed)
+    ShellStatus Run_Script(std::istream& input,const std::string& origin){
+        if(sourceDepth>=SOURCE_DEPTH_MAX){
+            MessageHandler::print_normal_message(fmt_lib::format("\033[31m{}: source nested more than {} deep\033[0m",origin,SOURCE_DEPTH_MAX));
+            scriptStatus = ShellStatus::ScriptFailed;
+            return ShellStatus::ScriptFailed;
+        }
+        sourceDepth++;
+        ShellStatus failure = ShellStatus::Success;
+        std::string line, pending;
+        std::vector<std::string> tokens;
+        bool background = false;
+        std::size_t line_no = 0, first_line = 0;
+        while(std::getline(input,line)){
+            line_no++;
+            if(pending.empty()) first_line = line_no;
+            else pending.push_back('\n');
+            pending += line;
+            if(Shell_Line_Tokenize(pending,tokens,nullptr,&background)==Shell_Token_Status::Incomplete) continue;
+            pending.clear();
+            if(tokens.empty()) continue;
+            ShellStatus status = Run_Line(tokens,background);
+            Jobs_Report();
+            if(status==ShellStatus::ExitCode){ failure = status; break; }
+            if(!Shell_Status_Failed(status)) continue;
+            if(status==ShellStatus::ScriptFailed&&Shell_Status_Failed(scriptStatus)) status = scriptStatus;
+            else{
+                MessageHandler::print_normal_message(fmt_lib::format("\033[31m{}:{}: {}{}\033[0m",origin,first_line,Command_Text(tokens),
+                    background ? " &" : ""));
+                MessageHandler::print_status(status);
+            }
+            failure = status;
+            if(!batchOptions.keep_going) break;
+        }
+        if(!pending.empty()&&failure==ShellStatus::Success){
+            MessageHandler::print_normal_message(fmt_lib::format("\033[31m{}:{}: unterminated quote or line continuation\033[0m",origin,first_line));
+            MessageHandler::print_status(ShellStatus::ParaParseNULL);
+            failure = ShellStatus::ParaParseNULL;
+        }
+        sourceDepth--;
+        scriptStatus = failure;
+        return failure;
+    }
+};
+
+inline Result SourceCommand::core(Shell_Context& ctx,Shell_Path_State& state) const {
+    std::ifstream ifs(state.path);
+    if(!ifs.is_open()) return Result(ShellStatus::FileOpenFailed);
+    ShellStatus status = env->Run_Script(ifs,state.path.string());
+    // The script's cd lines moved the shell; this run's own directory follows
+    ctx.pwd = env->Pwd();
+    if(status==ShellStatus::ExitCode) return Result(ShellStatus::ExitCode);
+    if(Shell_Status_Failed(status)) return Result(ShellStatus::ScriptFailed);
+    return Result(ShellStatus::Success);
+}
+
+// ===== Line Editor =====
+// Reads the interactive command line with the terminal in raw mode: cursor movement and kills (Left/Right,
+// Home/End, Ctrl-A/E/B/F/U/K/W), history (Up/Down), Tab completion through ShellEnv::Complete (a second Tab
+// lists the candidates), Ctrl-L clears the screen, Ctrl-C drops the line and Ctrl-D on an empty line ends input
+// A line longer than the terminal wraps and is redrawn in place; without a terminal it falls back to getline
+// While it waits for a key, a readable notify fd (background job output) clears the line, runs notify and redraws
+enum class Shell_Input_Status{Line,Cancel,End};
+
+class Shell_Line_Editor{
+    static constexpr std::size_t HISTORY_MAX = 1000;
+
+    const ShellEnv& shell;
+    std::vector<std::string> history;
+    std::string buf;
+    std::size_t cursor = 0;
+    std::string_view prompt;
+    int cursor_row = 0;
+    int notify_fd = -1;
+    std::function<void()> notify;
+
+    // Columns text takes on screen: escape sequences take none, UTF-8 goes through Char_Display_Width
+    static int Text_Cols(const std::string_view text){
+        std::string plain;
+        for(std::size_t idx=0; idx<text.size(); idx++){
+            if(text[idx]!='\033'){ plain.push_back(text[idx]); continue; }
+            if(idx+1<text.size()&&text[idx+1]=='[') idx++;
+            while(idx+1<text.size()&&!(text[idx+1]>='@'&&text[idx+1]<='~')) idx++;
+            idx++;
+        }
+        return WString_View_Cols_Count(String_UTF8_TO_WString(plain));
+    }
+    static int Terminal_Cols(){
+#ifndef _WIN32
+        struct winsize ws{};
+        if(ioctl(STDOUT_FILENO,TIOCGWINSZ,&ws)==0&&ws.ws_col>0) return ws.ws_col;
+#endif
+        return 80;
+    }
+    static void Output(const std::string_view text){
+        for(std::size_t done=0; done<text.size(); ){
+            ssize_t wrote = write(STDOUT_FILENO,text.data()+done,text.size()-done);
+            if(wrote<0&&errno==EINTR) continue;
+            if(wrote<=0) return;
+            done += wrote;
+        }
+    }
+    static bool Byte_Read(char& ch){
+        while(true){
+            ssize_t got = read(STDIN_FILENO,&ch,1);
+            if(got==1) return true;
+            if(got<0&&errno==EINTR) continue;
+            return false;
+        }
     }
 
+    // Redraw prompt and line from the row the prompt starts on, then put the cursor back
+    void Render(){
+        int cols = Terminal_Cols();
+        std::string out;
+        if(cursor_row>0) out += fmt_lib::format("\033[{}A",cursor_row);
+        out += '\r';
+        out += prompt;
+        out += buf;
+        out += "\033[J";
+        int prompt_cols = Text_Cols(prompt);
+        int end = prompt_cols+Text_Cols(buf);
+        // At the right margin the terminal holds the cursor on the last column; move it to the next row
+        if(end>0&&end%cols==0) out += "\r\n";
+        int target = prompt_cols+Text_Cols(std::string_view(buf).substr(0,cursor));
+        if(int up = end/cols-target/cols; up>0) out += fmt_lib::format("\033[{}A",up);
+        out += '\r';
+        if(target%cols>0) out += fmt_lib::format("\033[{}C",target%cols);
+        cursor_row = target/cols;
+        Output(out);
+    }
+    // Cursor below the line, ready for output that is not part of it
+    void Leave_Line(){
+        cursor = buf.size();
+        Render();
+        Output("\r\n");
+        cursor_row = 0;
+    }
+    void Candidates_Show(const Shell_Completion& completion){
+        Leave_Line();
+        int cols = Terminal_Cols(), width = 0;
+        for(const auto& name: completion.candidates) width = std::max(width,Text_Cols(name));
+        width += 2;
+        int per_row = std::max(1,cols/width);
+        std::string out;
+        for(std::size_t idx=0; idx<completion.candidates.size(); idx++){
+            const std::string& name = completion.candidates[idx];
+            out += name;
+            if((idx+1)%per_row==0||idx+1==completion.candidates.size()) out += "\r\n";
+            else out.append(width-Text_Cols(name),' ');
+        }
+        if(completion.total>completion.candidates.size())
+            out += fmt_lib::format("... {} more\r\n",completion.total-completion.candidates.size());
+        Output(out);
+    }
+
+    std::size_t Char_Prev(const std::size_t pos) const {
+        std::size_t idx = pos;
+        while(idx>0&&(static_cast<unsigned char>(buf[--idx])&0xC0)==0x80){}
+        return idx;
+    }
+    std::size_t Char_Next(const std::size_t pos) const {
+        std::size_t idx = pos;
+        if(idx<buf.size()) idx++;
+        while(idx<buf.size()&&(static_cast<unsigned char>(buf[idx])&0xC0)==0x80) idx++;
+        return idx;
+    }
+    // Escape sequence after ESC: the final byte, with a numeric parameter for "ESC [ n ~"
+    static char Escape_Read(int& param){
+        param = 0;
+        char ch;
+        if(!Byte_Read(ch)||(ch!='['&&ch!='O')) return 0;
+        while(Byte_Read(ch)){
+            if(ch>='0'&&ch<='9') param = param*10+(ch-'0');
+            else if(ch!=';') return ch;
+        }
+        return 0;
+    }
+
+    // False when stdin has nothing more to give
+    bool Key_Wait(){
+        while(notify_fd>=0){
+            pollfd fds[2] = {{STDIN_FILENO,POLLIN,0},{notify_fd,POLLIN,0}};
+            if(poll(fds,2,-1)<0){
+                if(errno==EINTR) continue;
+                return false;
+            }
+            if(fds[0].revents!=0) return true;
+            if(!(fds[1].revents&POLLIN)) continue;
+            Output(cursor_row>0 ? fmt_lib::format("\033[{}A\r\033[J",cursor_row) : std::string("\r\033[J"));
+            cursor_row = 0;
+            notify();
+            std::cout.flush();
+            Render();
+        }
+        return true;
+    }
+
+    Shell_Input_Status Line_Fallback(std::string& line){
+        std::cout<<prompt;
+        std::cout.flush();
+        if(std::getline(std::cin,line)) return Shell_Input_Status::Line;
+        std::cout<<"\n";
+        return Shell_Input_Status::End;
+    }
+public:
+    explicit Shell_Line_Editor(const ShellEnv& _shell): shell(_shell) {}
+    Shell_Line_Editor(const Shell_Line_Editor&) = delete;
+    Shell_Line_Editor& operator=(const Shell_Line_Editor&) = delete;
+
+    void Notify_Set(const int fd,std::function<void()> _notify){
+        notify_fd = fd;
+        notify = std::move(_notify);
+    }
+
+    void History_Add(const std::string& line){
+        if(line.empty()||(!history.empty()&&history.back()==line)) return;
+        if(history.size()>=HISTORY_MAX) history.erase(history.begin());
+        history.push_back(line);
+    }
+
+    // One line after _prompt; context is what earlier continued lines hold (completion tokenizes it too)
+    Shell_Input_Status Read_Line(const std::string_view _prompt,const std::string_view context,std::string& line){
+        prompt = _prompt;
+        std::cout.flush();
+#ifdef _WIN32
+        return Line_Fallback(line);
+#else
+        termios saved{};
+        if(!isatty(STDIN_FILENO)||!isatty(STDOUT_FILENO)||tcgetattr(STDIN_FILENO,&saved)!=0) return Line_Fallback(line);
+        termios raw = saved;
+        raw.c_iflag &= ~(ICRNL|IXON|ISTRIP|INPCK|BRKINT);
+        raw.c_lflag &= ~(ICANON|ECHO|ISIG|IEXTEN);
+        raw.c_cc[VMIN] = 1; raw.c_cc[VTIME] = 0;
+        if(tcsetattr(STDIN_FILENO,TCSADRAIN,&raw)!=0) return Line_Fallback(line);
+        struct Mode_Restore{
+            const termios& mode;
+            ~Mode_Restore(){ tcsetattr(STDIN_FILENO,TCSADRAIN,&mode); }
+        } restore{saved};
+
+        buf.clear();
+        cursor = 0;
+        cursor_row = 0;
+        std::size_t history_pos = history.size();
+        std::string edited;
+        bool tab_last = false;
+        Render();
+        char ch;
+        while(Key_Wait()&&Byte_Read(ch)){
+            bool tab = false;
+            switch(ch){
+                case '\r': case '\n':
+                    Leave_Line();
+                    line = std::move(buf);
+                    return Shell_Input_Status::Line;
+                case 0x03:
+                    buf += "^C";
+                    Leave_Line();
+                    return Shell_Input_Status::Cancel;
+                case 0x04:
+                    if(buf.empty()){ Output("\r\n"); return Shell_Input_Status::End; }
+                    buf.erase(cursor,Char_Next(cursor)-cursor);
+                    break;
+                case '\t':{
+                    tab = true;
+                    Shell_Completion completion = shell.Complete(context.empty() ? buf.substr(0,cursor)
+                        : std::string(context)+buf.substr(0,cursor));
+                    if(!completion.line.starts_with(context)) break;
+                    std::string_view completed = std::string_view(completion.line).substr(context.size());
+                    if(completed!=std::string_view(buf).substr(0,cursor)){
+                        buf = std::string(completed)+buf.substr(cursor);
+                        cursor = completed.size();
+                        tab = completion.total>1;
+                    }else if(completion.total>1&&tab_last) Candidates_Show(completion);
+                    else Output("\a");
+                    break;
+                }
+                case 0x7F: case 0x08:
+                    if(cursor>0){
+                        std::size_t prev = Char_Prev(cursor);
+                        buf.erase(prev,cursor-prev);
+                        cursor = prev;
+                    }
+                    break;
+                case 0x01: cursor = 0; break;
+                case 0x05: cursor = buf.size(); break;
+                case 0x02: cursor = Char_Prev(cursor); break;
+                case 0x06: cursor = Char_Next(cursor); break;
+                case 0x15: buf.erase(0,cursor); cursor = 0; break;
+                case 0x0B: buf.erase(cursor); break;
+                case 0x17:{
+                    std::size_t start = cursor;
+                    while(start>0&&buf[start-1]==' ') start--;
+                    while(start>0&&buf[start-1]!=' ') start--;
+                    buf.erase(start,cursor-start);
+                    cursor = start;
+                    break;
+                }
+                case 0x0C:
+                    Output("\033[H\033[2J");
+                    cursor_row = 0;
+                    break;
+                case 0x1B:{
+                    int param = 0;
+                    char key = Escape_Read(param);
+                    if(key=='D') cursor = Char_Prev(cursor);
+                    else if(key=='C') cursor = Char_Next(cursor);
+                    else if(key=='H'||(key=='~'&&(param==1||param==7))) cursor = 0;
+                    else if(key=='F'||(key=='~'&&(param==4||param==8))) cursor = buf.size();
+                    else if(key=='~'&&param==3) buf.erase(cursor,Char_Next(cursor)-cursor);
+                    else if((key=='A'&&history_pos>0)||(key=='B'&&history_pos<history.size())){
+                        if(history_pos==history.size()) edited = buf;
+                        history_pos += key=='A' ? -1 : 1;
+                        buf = history_pos==history.size() ? edited : history[history_pos];
+                        cursor = buf.size();
+                    }
+                    break;
+                }
+                default:{
+                    if(static_cast<unsigned char>(ch)<0x20) break;
+                    // The rest of a UTF-8 sequence arrives with its lead byte; insert it whole
+                    std::string bytes(1,ch);
+                    unsigned char lead = ch;
+                    int more = lead>=0xF0 ? 3 : lead>=0xE0 ? 2 : lead>=0xC0 ? 1 : 0;
+                    for(char next; more>0&&Byte_Read(next); more--) bytes.push_back(next);
+                    buf.insert(cursor,bytes);
+                    cursor += bytes.size();
+                }
+            }
+            tab_last = tab;
+            Render();
+        }
+        Output("\r\n");
+        return Shell_Input_Status::End;
+#endif
+    }
 };
 
+// ===== Feather Shell Interface =====
+// Interactive loop: prompt, read (a "> " prompt continues an open quote), run, report; ends on exit or end of input
+// Background jobs report above the prompt as their lines arrive; the shell waits for those still running on exit
+inline void Terminal_Shell_Interface(std::filesystem::path target_path) {
+    ShellEnv shell(target_path);
+    Shell_Line_Editor editor(shell);
+    editor.Notify_Set(shell.Jobs_Fd(),[&shell]{ shell.Jobs_Report(); });
+    std::string line, pending;
+    std::vector<std::string> tokens;
+    bool background = false;
+    while(true){
+        if(pending.empty()) shell.Jobs_Report();
+        Shell_Input_Status input = editor.Read_Line(pending.empty() ? shell.Prompt() : std::string("> "),
+            pending.empty() ? pending : pending+'\n',line);
+        if(input==Shell_Input_Status::End) break;
+        if(input==Shell_Input_Status::Cancel){ pending.clear(); continue; }
+        if(!pending.empty()) pending.push_back('\n');
+        pending += line;
+        if(Shell_Line_Tokenize(pending,tokens,nullptr,&background)==Shell_Token_Status::Incomplete) continue;
+        editor.History_Add(pending);
+        pending.clear();
+        if(tokens.empty()) continue;
+        ShellStatus status = shell.Run_Line(tokens,background);
+        if(status==ShellStatus::ExitCode) break;
+        MessageHandler::print_status(status);
+        std::cout.flush();
+    }
+    if(shell.Jobs_Running()){
+        MessageHandler::print_normal_message("\033[36mWaiting for background jobs to finish...\033[0m");
+        shell.Jobs_Wait_All();
+    }
+    std::cin.clear();
+}
+
+// Batch mode: security_tool --batch [-k] [-t] [-x] [script|-]; the script defaults to stdin
+// Exit code follows the failing ShellStatus (see Shell_Status_Exit_Code), 0 when every line succeeded
+inline int Shell_Batch_Interface(const std::vector<std::string>& args) {
+    Shell_Batch_Options options;
+    std::string script = "-";
+    for(const auto& arg: args){
+        if(arg=="-k"||arg=="--keep-going") options.keep_going = true;
+        else if(arg=="-t"||arg=="--time") options.timing = true;
+        else if(arg=="-x"||arg=="--echo") options.echo = true;
+        else if(script=="-"&&(arg=="-"||!arg.starts_with("-"))) script = arg;
+        else{
+            std::cerr<<"Usage: --batch [-k|--keep-going] [-t|--time] [-x|--echo] [script|-]\n";
+            return Shell_Status_Exit_Code(ShellStatus::WrongArguments);
+        }
+    }
+    ShellEnv shell(std::filesystem::current_path());
+    shell.Batch_Options_Set(options);
+    ShellStatus status;
+    if(script=="-") status = shell.Run_Script(std::cin,"<stdin>");
+    else{
+        std::ifstream ifs(script);
+        if(!ifs.is_open()){
+            MessageHandler::print_status(ShellStatus::FileOpenFailed);
+            return Shell_Status_Exit_Code(ShellStatus::FileOpenFailed);
+        }
+        status = shell.Run_Script(ifs,script);
+    }
+    // Jobs still running when the script ended count like its last lines
+    if(ShellStatus jobs = shell.Jobs_Wait_All(); !Shell_Status_Failed(status)&&status!=ShellStatus::ExitCode) status = jobs;
+    std::cout.flush();
+    return Shell_Status_Exit_Code(status);
+}
+
 
 // ===== System Shell Interface =====
 inline void System_Shell_Interface(std::filesystem::path target_path) {
@@ -574,6 +2151,3 @@ inline void System_Shell_Interface(std::filesystem::path target_path) {
     system(cmd.data());
 }
 
-// int main(){
-//     Terminal_Shell_Interface(std::filesystem::current_path());
-// }
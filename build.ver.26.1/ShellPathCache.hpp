@@ -0,0 +1,140 @@
+#pragma once
+#include "GeneralFileOper.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <system_error>
+#include <cstdint>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// ===== Shell Path Resolution =====
+// A command argument resolved against the working directory, with the file type from the same lookup
+enum class Shell_Path_Type{Missing,File,Folder,Other};
+struct Shell_Path_Info{
+    std::filesystem::path path;
+    Shell_Path_Type type = Shell_Path_Type::Missing;
+    std::error_code ec;
+
+    bool Exists() const { return !ec&&type!=Shell_Path_Type::Missing; }
+    bool Is_Folder() const { return !ec&&type==Shell_Path_Type::Folder; }
+};
+// weakly_canonical + one status (symlinks followed; a dangling link counts as Other)
+inline Shell_Path_Info Shell_Path_Resolve_Uncached(const std::filesystem::path& cwd,const std::string& arg){
+    Shell_Path_Info info;
+    auto [path,ec] = File_RelativePath_To_AbsPath_Weakly(cwd,arg);
+    info.path = std::move(path); info.ec = ec;
+    if(ec) return info;
+    std::error_code status_ec;
+    switch(std::filesystem::status(info.path,status_ec).type()){
+        case std::filesystem::file_type::directory: info.type = Shell_Path_Type::Folder; break;
+        case std::filesystem::file_type::regular: info.type = Shell_Path_Type::File; break;
+        case std::filesystem::file_type::not_found:
+            info.type = std::filesystem::is_symlink(std::filesystem::symlink_status(info.path,status_ec))
+                ? Shell_Path_Type::Other : Shell_Path_Type::Missing;
+            break;
+        default: info.type = Shell_Path_Type::Other; break;
+    }
+    return info;
+}
+
+// ===== Shell Path Resolution Cache =====
+// Keyed by (cwd, argument); each result depends on the folder holding the resolved entry, which is watched with inotify
+// The shell drops results under the paths a command changed (Invalidate), inotify catches everybody else
+// Renames above that folder are not seen; without inotify nothing is cached
+class Shell_Path_Cache{
+    static constexpr std::size_t CACHE_MAX = 4096;
+    static constexpr std::size_t WATCH_MAX = 256;
+    static constexpr std::uint32_t WATCH_MASK = IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ATTRIB
+        |IN_DELETE_SELF|IN_MOVE_SELF|IN_ONLYDIR;
+
+    int inotify_fd = -1;
+    std::unordered_map<std::string,Shell_Path_Info> cache;
+    std::unordered_map<std::string,int> watched;
+    std::unordered_map<int,std::vector<std::string>> dependents;
+
+    static std::string Cache_Key(const std::filesystem::path& cwd,const std::string& arg){
+        std::string key = cwd.native();
+        key.push_back('\0');
+        key.append(arg);
+        return key;
+    }
+    void Dependents_Drop(const int watch){
+        auto it = dependents.find(watch);
+        if(it==dependents.end()) return;
+        for(const auto& key: it->second) cache.erase(key);
+        it->second.clear();
+    }
+    void Event_Drain(){
+        if(inotify_fd<0) return;
+        alignas(inotify_event) char buf[16*1024];
+        while(true){
+            ssize_t len = read(inotify_fd,buf,sizeof(buf));
+            if(len<=0) break;
+            for(char* ptr=buf; ptr<buf+len; ){
+                const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                ptr += sizeof(inotify_event)+event->len;
+                if(event->mask&IN_Q_OVERFLOW){ Clear(); continue; }
+                Dependents_Drop(event->wd);
+                if(event->mask&IN_IGNORED){
+                    dependents.erase(event->wd);
+                    std::erase_if(watched,[event](const auto& item){ return item.second==event->wd; });
+                }
+            }
+        }
+    }
+    // Watch descriptor of folder, -1 when it cannot be watched; created tells whether the watch is new
+    int Folder_Watch(const std::filesystem::path& folder,bool& created){
+        created = false;
+        if(inotify_fd<0) return -1;
+        if(auto it = watched.find(folder.native()); it!=watched.end()) return it->second;
+        if(watched.size()>=WATCH_MAX) Watch_Reset();
+        int watch = inotify_add_watch(inotify_fd,folder.c_str(),WATCH_MASK);
+        if(watch>=0){ watched[folder.native()] = watch; created = true; }
+        return watch;
+    }
+    void Watch_Reset(){
+        for(const auto& [folder,watch]: watched) inotify_rm_watch(inotify_fd,watch);
+        watched.clear();
+        dependents.clear();
+        cache.clear();
+    }
+public:
+    Shell_Path_Cache(){ inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC); }
+    Shell_Path_Cache(const Shell_Path_Cache&) = delete;
+    Shell_Path_Cache& operator=(const Shell_Path_Cache&) = delete;
+    ~Shell_Path_Cache(){ if(inotify_fd>=0) close(inotify_fd); }
+
+    Shell_Path_Info Resolve(const std::filesystem::path& cwd,const std::string& arg){
+        Event_Drain();
+        std::string key = Cache_Key(cwd,arg);
+        if(auto it = cache.find(key); it!=cache.end()) return it->second;
+
+        Shell_Path_Info info = Shell_Path_Resolve_Uncached(cwd,arg);
+        if(info.ec) return info;
+        bool created;
+        int watch = Folder_Watch(info.path.parent_path(),created);
+        if(watch<0) return info;
+        // A change between the lookup and a brand-new watch would go unseen: look up once more under the watch
+        if(created) info = Shell_Path_Resolve_Uncached(cwd,arg);
+        if(cache.size()>=CACHE_MAX){ cache.clear(); for(auto& [wd,keys]: dependents) keys.clear(); }
+        dependents[watch].push_back(key);
+        cache[key] = info;
+        return info;
+    }
+    // Forget results at or below target (called after the shell itself changed it)
+    void Invalidate(const std::filesystem::path& target){
+        const std::string& prefix = target.native();
+        std::erase_if(cache,[&prefix](const auto& item){
+            const std::string& path = item.second.path.native();
+            return path.starts_with(prefix)&&(path.size()==prefix.size()||path[prefix.size()]=='/');
+        });
+    }
+    void Clear(){
+        cache.clear();
+        for(auto& [watch,keys]: dependents) keys.clear();
+    }
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cwchar>
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+// ===== UTF-8 Decoding =====
+// Decode UTF-8 into wchar_t (UTF-32 on Linux), appending to out; one allocation for the whole string
+// Runs of 16 ASCII bytes are widened with SSE2 in one step; invalid sequences become U+FFFD
+inline void Utf8_Decode_Append(const std::string_view in, std::wstring& out){
+    constexpr wchar_t REPLACEMENT = 0xFFFD;
+    const auto* src = reinterpret_cast<const unsigned char*>(in.data());
+    const auto* end = src+in.size();
+    std::size_t base = out.size();
+    out.resize(base+in.size());
+    wchar_t* dst = out.data()+base;
+
+    while(src<end){
+#if defined(__SSE2__)
+        static_assert(sizeof(wchar_t)==4);
+        while(end-src>=16){
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            if(_mm_movemask_epi8(chunk)!=0) break;
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_unpacklo_epi8(chunk,zero), hi = _mm_unpackhi_epi8(chunk,zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),_mm_unpacklo_epi16(lo,zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+4),_mm_unpackhi_epi16(lo,zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+8),_mm_unpacklo_epi16(hi,zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+12),_mm_unpackhi_epi16(hi,zero));
+            src += 16; dst += 16;
+        }
+        if(src>=end) break;
+#endif
+        unsigned char lead = *src;
+        if(lead<0x80){ *dst++ = lead; src++; continue; }
+
+        int len = lead>=0xF5 ? 0 : lead>=0xF0 ? 4 : lead>=0xE0 ? 3 : lead>=0xC2 ? 2 : 0;
+        if(len==0||end-src<len){ *dst++ = REPLACEMENT; src++; continue; }
+        char32_t cp = lead&(0x7F>>len);
+        bool valid = true;
+        for(int idx=1; idx<len; idx++){
+            if((src[idx]&0xC0)!=0x80){ valid = false; break; }
+            cp = (cp<<6)|(src[idx]&0x3F);
+        }
+        // Overlong forms, UTF-16 surrogates and values past U+10FFFF are rejected
+        if(valid&&((len==3&&cp<0x800)||(len==4&&cp<0x10000)||(cp>=0xD800&&cp<=0xDFFF)||cp>0x10FFFF)) valid = false;
+        if(!valid){ *dst++ = REPLACEMENT; src++; continue; }
+        *dst++ = static_cast<wchar_t>(cp);
+        src += len;
+    }
+    out.resize(dst-out.data());
+}
+
+// ===== Display Width =====
+// Columns a character takes in the terminal: printable ASCII is 1 without a lookup,
+// the BMP goes through a table filled from wcwidth on first use of each code point
+// (so it follows the locale set by the TUI, like ncurses itself); control characters count 0
+inline int Char_Display_Width(const char32_t cp){
+    if(cp>=0x20&&cp<0x7F) return 1;
+    if(cp>=0x10000){
+        int width = wcwidth(static_cast<wchar_t>(cp));
+        return width<0 ? 0 : width;
+    }
+    // Stored as width+1, 0 = not looked up yet
+    static std::array<std::atomic<std::uint8_t>,0x10000> width_table{};
+    std::uint8_t cached = width_table[cp].load(std::memory_order_relaxed);
+    if(cached!=0) return cached-1;
+    int width = wcwidth(static_cast<wchar_t>(cp));
+    if(width<0) width = 0;
+    width_table[cp].store(width+1,std::memory_order_relaxed);
+    return width;
+}
+inline int WString_View_Cols_Count(const std::wstring_view wstr){
+    int width = 0;
+    for(const wchar_t wc: wstr) width += Char_Display_Width(wc);
+    return width;
+}
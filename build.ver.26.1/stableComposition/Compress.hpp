@@ -1,28 +1,1029 @@
 #pragma once
 #include "GeneralFileOper.hpp"
+#include "ParallelTask.hpp"
+#include <zlib.h>
+#include <zstd.h>
+#include <zdict.h>
+
 #include <filesystem>
+#include <fstream>
 #include <string>
+#include <sstream>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <chrono>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <iterator>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <spawn.h>
 // #include <iostream>
 
 const std::filesystem::path CompressStore = std::filesystem::current_path()/"Admin"/"CompressStore";
 const std::filesystem::path DecompressStore = std::filesystem::current_path()/"Admin"/"DecompressStore";
 
+// ===== Archive Index =====
+// Member record: name, tar type flag, data size and raw byte range inside its frame (link: target of a hard link)
+// Frame record: compressed byte range inside the .tar.gz (one independent gzip member)
+// Index sidecar path (<archive>.idx)
+struct Compress_Archive_Member{
+    std::string name;
+    char type;
+    std::uint64_t size;
+    std::size_t frame;
+    std::uint64_t frame_offset;
+    std::uint64_t raw_length;
+    std::string link;
+};
+struct Compress_Archive_Frame{
+    std::uint64_t offset;
+    std::uint64_t length;
+};
+struct Compress_Archive_Index{
+    std::vector<Compress_Archive_Frame> frames;
+    std::vector<Compress_Archive_Member> members;
+};
+inline std::filesystem::path Compress_Archive_Index_Path(const std::filesystem::path archive_path){
+    return std::filesystem::path(archive_path.string()+".idx");
+}
+// The name a path's archives and extracted tree get in the stores: x, x.tar.gz, x.zpack and x.tar.gz.vlt all
+// stage as CompressStore/x.* and extract to DecompressStore/x, so runs on paths of one name must not overlap
+inline std::string Compress_Store_Name(const std::filesystem::path path){
+    std::filesystem::path name = path.filename();
+    while(name.has_extension()&&(name.extension()==".vlt"||name.extension()==".gz"||name.extension()==".tar"||name.extension()==".zpack"))
+        name = name.stem();
+    return name.string();
+}
+
+namespace Compress_Impl{
+    constexpr std::size_t TAR_BLOCK = 512;
+    constexpr std::size_t IO_CHUNK = 64*1024;
+    // Members are grouped until a frame holds this many raw bytes, so tiny files still share a deflate window
+    constexpr std::uint64_t FRAME_THRESHOLD = 1024*1024;
+
+    // ===== Tar Header Parsing =====
+    // Read size field (octal or GNU base-256)
+    // Check for end-of-archive zero block
+    // Read member name (ustar prefix aware)
+    // Read a record (path=, linkpath=) from a pax extended header
+    inline std::uint64_t Tar_Header_Size(const unsigned char* header){
+        const unsigned char* field = header+124;
+        std::uint64_t value = 0;
+        if(field[0]&0x80){
+            for(int i=1;i<12;i++) value = (value<<8)|field[i];
+            return value;
+        }
+        for(int i=0;i<12&&field[i]!='\0';i++)
+            if(field[i]>='0'&&field[i]<='7') value = value*8+(field[i]-'0');
+        return value;
+    }
+    inline bool Tar_Block_Zero(const unsigned char* block){
+        return std::all_of(block,block+TAR_BLOCK,[](unsigned char c){return c==0;});
+    }
+    inline std::string Tar_Header_Name(const unsigned char* header){
+        std::string name(reinterpret_cast<const char*>(header),strnlen(reinterpret_cast<const char*>(header),100));
+        if(std::memcmp(header+257,"ustar\0",6)==0&&header[345]!='\0'){
+            std::string prefix(reinterpret_cast<const char*>(header+345),strnlen(reinterpret_cast<const char*>(header+345),155));
+            name = prefix+"/"+name;
+        }
+        return name;
+    }
+    inline std::optional<std::string> Tar_Pax_Record(const std::string& records,const std::string_view key){
+        std::size_t pos = 0;
+        while(pos<records.size()){
+            std::size_t space = records.find(' ',pos);
+            if(space==std::string::npos) break;
+            std::size_t len = std::strtoull(records.data()+pos,nullptr,10);
+            if(len==0||pos+len>records.size()) break;
+            std::string record = records.substr(space+1,pos+len-space-2);
+            if(record.size()>key.size()&&record.starts_with(key)&&record[key.size()]=='=') return record.substr(key.size()+1);
+            pos += len;
+        }
+        return std::nullopt;
+    }
+
+    // ===== Frame Writer =====
+    // Deflate tar bytes into independent gzip members; each finished frame is recorded in the index
+    class Compress_Frame_Writer{
+        std::ofstream target_ofs;
+        z_stream zs{};
+        std::vector<Compress_Archive_Frame>& frames;
+        std::uint64_t frame_start = 0;
+        std::uint64_t written = 0;
+        std::uint64_t frame_in = 0;
+        unsigned char out_buf[IO_CHUNK];
+
+        bool deflate_flush(int flush){
+            int state;
+            do{
+                zs.next_out = out_buf; zs.avail_out = sizeof(out_buf);
+                state = deflate(&zs,flush);
+                if(state==Z_STREAM_ERROR) return false;
+                std::size_t have = sizeof(out_buf)-zs.avail_out;
+                target_ofs.write(reinterpret_cast<char*>(out_buf),have);
+                written += have;
+            }while(zs.avail_out==0||(flush==Z_FINISH&&state!=Z_STREAM_END));
+            return target_ofs.good();
+        }
+    public:
+        explicit Compress_Frame_Writer(std::vector<Compress_Archive_Frame>& _frames): frames(_frames) {}
+        ~Compress_Frame_Writer(){ deflateEnd(&zs); }
+
+        bool open(const std::filesystem::path archive_path){
+            target_ofs.open(archive_path,std::ios::binary|std::ios::trunc);
+            if(!target_ofs.is_open()) return false;
+            return deflateInit2(&zs,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY)==Z_OK;
+        }
+        bool write(const unsigned char* data,const std::size_t len){
+            zs.next_in = const_cast<unsigned char*>(data); zs.avail_in = len;
+            frame_in += len;
+            return deflate_flush(Z_NO_FLUSH);
+        }
+        bool finish_frame(){
+            if(frame_in==0) return true;
+            zs.next_in = nullptr; zs.avail_in = 0;
+            if(!deflate_flush(Z_FINISH)) return false;
+            frames.push_back(Compress_Archive_Frame{frame_start,written-frame_start});
+            frame_start = written; frame_in = 0;
+            return deflateReset(&zs)==Z_OK;
+        }
+        // Flushed to disk: the index records the finished archive's size and mtime
+        bool close(){
+            target_ofs.close();
+            return !target_ofs.fail();
+        }
+        std::uint64_t frame_bytes() const { return frame_in; }
+        std::size_t frame_index() const { return frames.size(); }
+    };
+
+    // ===== Frame Reader =====
+    // Inflate a single frame starting at its compressed offset
+    class Compress_Frame_Reader{
+        std::ifstream source_ifs;
+        z_stream zs{};
+        std::uint64_t remain_in = 0;
+        std::uint64_t position = 0;
+        unsigned char in_buf[IO_CHUNK];
+    public:
+        ~Compress_Frame_Reader(){ inflateEnd(&zs); }
+
+        bool open(const std::filesystem::path archive_path,const Compress_Archive_Frame frame){
+            source_ifs.open(archive_path,std::ios::binary);
+            if(!source_ifs.is_open()) return false;
+            source_ifs.seekg(frame.offset);
+            remain_in = frame.length; position = 0;
+            return inflateInit2(&zs,15+16)==Z_OK;
+        }
+        std::size_t read(unsigned char* out,const std::size_t len){
+            zs.next_out = out; zs.avail_out = len;
+            while(zs.avail_out>0){
+                if(zs.avail_in==0){
+                    if(remain_in==0) break;
+                    source_ifs.read(reinterpret_cast<char*>(in_buf),std::min<std::uint64_t>(sizeof(in_buf),remain_in));
+                    std::size_t got = source_ifs.gcount();
+                    if(got==0) break;
+                    remain_in -= got;
+                    zs.next_in = in_buf; zs.avail_in = got;
+                }
+                int state = inflate(&zs,Z_NO_FLUSH);
+                if(state==Z_STREAM_END) break;
+                if(state!=Z_OK) return 0;
+            }
+            std::size_t have = len-zs.avail_out;
+            position += have;
+            return have;
+        }
+        bool seek_forward(const std::uint64_t target){
+            unsigned char skip_buf[IO_CHUNK];
+            while(position<target)
+                if(read(skip_buf,std::min<std::uint64_t>(sizeof(skip_buf),target-position))==0) return false;
+            return true;
+        }
+    };
+
+    inline bool Pipe_Read_Exact(FILE* pipe,unsigned char* buf,const std::size_t len){
+        return std::fread(buf,1,len,pipe)==len;
+    }
+
+    // tar run straight from an argument vector (no shell, so archive and member names are never parsed as shell
+    // syntax); mode 'r' reads its stdout through pipe(), 'w' writes its stdin, anything else connects neither
+    class Child_Process{
+        pid_t pid = -1;
+        FILE* stream = nullptr;
+    public:
+        Child_Process() = default;
+        Child_Process(const Child_Process&) = delete;
+        Child_Process& operator=(const Child_Process&) = delete;
+        ~Child_Process(){ wait(); }
+
+        bool open(const std::vector<std::string>& args,const char mode){
+            bool piped = mode=='r'||mode=='w';
+            int fds[2] = {-1,-1};
+            if(piped&&pipe2(fds,O_CLOEXEC)!=0) return false;
+            int child_end = mode=='r' ? fds[1] : fds[0], parent_end = mode=='r' ? fds[0] : fds[1];
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            if(piped) posix_spawn_file_actions_adddup2(&actions,child_end,mode=='r' ? STDOUT_FILENO : STDIN_FILENO);
+            std::vector<char*> argv;
+            for(const auto& arg: args) argv.push_back(const_cast<char*>(arg.c_str()));
+            argv.push_back(nullptr);
+            bool spawned = posix_spawnp(&pid,argv[0],&actions,nullptr,argv.data(),environ)==0;
+            posix_spawn_file_actions_destroy(&actions);
+            if(!spawned) pid = -1;
+            if(!piped) return spawned;
+            ::close(child_end);
+            if(spawned) stream = fdopen(parent_end,mode=='r' ? "r" : "w");
+            if(stream==nullptr) ::close(parent_end);
+            return stream!=nullptr;
+        }
+        FILE* pipe() const { return stream; }
+        // Close the pipe and reap the child: true when it exited with status 0
+        bool wait(){
+            if(stream!=nullptr){ std::fclose(stream); stream = nullptr; }
+            if(pid<0) return false;
+            int status = 0;
+            while(waitpid(pid,&status,0)<0&&errno==EINTR){}
+            pid = -1;
+            return WIFEXITED(status)&&WEXITSTATUS(status)==0;
+        }
+    };
+
+    // Size and mtime (ns) of the archive an index was made for; a re-created archive no longer matches
+    inline std::optional<std::pair<std::uint64_t,std::int64_t>> Archive_Stamp(const std::filesystem::path archive_path){
+        std::error_code ec;
+        std::uint64_t size = std::filesystem::file_size(archive_path,ec);
+        if(ec) return std::nullopt;
+        auto mtime = std::filesystem::last_write_time(archive_path,ec);
+        if(ec) return std::nullopt;
+        return std::make_pair(size,static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count()));
+    }
+};
+
+// ===== Index Storage =====
+// Write index sidecar: header line with the archive's size and mtime, one F line per frame, one M line per member
+// (followed by an L line with the target of a hard link)
+// Load index sidecar (nullopt when missing, malformed or made for another version of the archive)
+inline bool Compress_Archive_Index_Store(const std::filesystem::path archive_path,const Compress_Archive_Index& index){
+    auto stamp = Compress_Impl::Archive_Stamp(archive_path);
+    if(!stamp) return false;
+    std::ofstream ofs(Compress_Archive_Index_Path(archive_path),std::ios::trunc);
+    if(!ofs.is_open()) return false;
+    ofs<<"SFIDX 2 "<<stamp->first<<' '<<stamp->second<<'\n';
+    for(const auto& frame: index.frames)
+        ofs<<"F "<<frame.offset<<' '<<frame.length<<'\n';
+    for(const auto& member: index.members){
+        ofs<<"M "<<member.frame<<' '<<member.frame_offset<<' '<<member.raw_length<<' '<<member.size<<' '<<member.type<<' '<<member.name<<'\n';
+        if(member.type=='1') ofs<<"L "<<member.link<<'\n';
+    }
+    return ofs.good();
+}
+inline std::optional<Compress_Archive_Index> Compress_Archive_Index_Load(const std::filesystem::path archive_path){
+    std::ifstream ifs(Compress_Archive_Index_Path(archive_path));
+    if(!ifs.is_open()) return std::nullopt;
+    std::string line;
+    auto stamp = Compress_Impl::Archive_Stamp(archive_path);
+    if(!stamp||!std::getline(ifs,line)||line!="SFIDX 2 "+std::to_string(stamp->first)+' '+std::to_string(stamp->second)) return std::nullopt;
+
+    Compress_Archive_Index index;
+    while(std::getline(ifs,line)){
+        if(line.rfind("F ",0)==0){
+            Compress_Archive_Frame frame{};
+            if(std::sscanf(line.c_str(),"F %lu %lu",&frame.offset,&frame.length)!=2) return std::nullopt;
+            index.frames.push_back(frame);
+        }else if(line.rfind("M ",0)==0){
+            Compress_Archive_Member member{};
+            int name_pos = 0;
+            if(std::sscanf(line.c_str(),"M %zu %lu %lu %lu %c %n",&member.frame,&member.frame_offset,&member.raw_length,&member.size,&member.type,&name_pos)!=5||name_pos==0)
+                return std::nullopt;
+            member.name = line.substr(name_pos);
+            if(member.frame>=index.frames.size()) return std::nullopt;
+            index.members.push_back(std::move(member));
+        }else if(line.rfind("L ",0)==0){
+            if(index.members.empty()||index.members.back().type!='1') return std::nullopt;
+            index.members.back().link = line.substr(2);
+        }
+    }
+    return index;
+}
+
+// ===== Indexed Archive Creation =====
+// Stream `tar -c` output, cut it at member boundaries into independent gzip frames and record the index
+// The result is still a plain multi-member .tar.gz readable by `tar -xzf`
+inline bool Compress_Archive_Create_Indexed(const std::filesystem::path source_path,const std::filesystem::path archive_path){
+    using namespace Compress_Impl;
+    Child_Process tar;
+    if(!tar.open({"tar","-cf","-","-b","1","-C",source_path.parent_path().string(),"--",source_path.filename().string()},'r')) return false;
+    FILE* pipe = tar.pipe();
+
+    Compress_Archive_Index index;
+    Compress_Frame_Writer writer(index.frames);
+    bool SFBoolState = writer.open(archive_path);
+
+    unsigned char header[TAR_BLOCK];
+    unsigned char data_buf[IO_CHUNK];
+    while(SFBoolState&&Pipe_Read_Exact(pipe,header,TAR_BLOCK)){
+        if(Tar_Block_Zero(header)){
+            SFBoolState = writer.write(header,TAR_BLOCK);
+            break;
+        }
+        if(writer.frame_bytes()>=FRAME_THRESHOLD) SFBoolState = writer.finish_frame();
+        Compress_Archive_Member member{"",'0',0,writer.frame_index(),writer.frame_bytes(),0,""};
+
+        // Extension headers (GNU long name/link, pax) travel with the member they describe
+        std::optional<std::string> long_name, long_link;
+        while(SFBoolState&&(header[156]=='L'||header[156]=='K'||header[156]=='x'||header[156]=='g')){
+            std::uint64_t ext_size = Tar_Header_Size(header);
+            std::string ext_data((ext_size+TAR_BLOCK-1)/TAR_BLOCK*TAR_BLOCK,'\0');
+            SFBoolState = writer.write(header,TAR_BLOCK)
+                &&Pipe_Read_Exact(pipe,reinterpret_cast<unsigned char*>(ext_data.data()),ext_data.size())
+                &&writer.write(reinterpret_cast<unsigned char*>(ext_data.data()),ext_data.size());
+            if(header[156]=='L') long_name = std::string(ext_data.c_str());
+            else if(header[156]=='K') long_link = std::string(ext_data.c_str());
+            else if(header[156]=='x'){
+                if(auto pax = Tar_Pax_Record(ext_data.substr(0,ext_size),"path"); pax) long_name = pax;
+                if(auto pax = Tar_Pax_Record(ext_data.substr(0,ext_size),"linkpath"); pax) long_link = pax;
+            }
+            if(SFBoolState) SFBoolState = Pipe_Read_Exact(pipe,header,TAR_BLOCK);
+        }
+        if(!SFBoolState) break;
+
+        member.name = long_name ? *long_name : Tar_Header_Name(header);
+        member.type = header[156]=='\0' ? '0' : static_cast<char>(header[156]);
+        member.size = Tar_Header_Size(header);
+        if(member.type=='1')
+            member.link = long_link ? *long_link : std::string(reinterpret_cast<const char*>(header+157),strnlen(reinterpret_cast<const char*>(header+157),100));
+        SFBoolState = writer.write(header,TAR_BLOCK);
+
+        bool has_data = std::string_view("123456").find(member.type)==std::string_view::npos;
+        std::uint64_t data_remain = has_data ? (member.size+TAR_BLOCK-1)/TAR_BLOCK*TAR_BLOCK : 0;
+        while(SFBoolState&&data_remain>0){
+            std::size_t chunk = std::min<std::uint64_t>(sizeof(data_buf),data_remain);
+            SFBoolState = Pipe_Read_Exact(pipe,data_buf,chunk)&&writer.write(data_buf,chunk);
+            data_remain -= chunk;
+        }
+        member.raw_length = writer.frame_bytes()-member.frame_offset;
+        index.members.push_back(std::move(member));
+    }
+    // Trailing zero blocks belong to the last frame but to no member
+    std::size_t tail;
+    while(SFBoolState&&(tail=std::fread(data_buf,1,sizeof(data_buf),pipe))>0)
+        SFBoolState = writer.write(data_buf,tail);
+    if(SFBoolState) SFBoolState = writer.finish_frame();
+    if(!writer.close()) SFBoolState = false;
+
+    if(!tar.wait()) SFBoolState = false;
+    if(SFBoolState) SFBoolState = Compress_Archive_Index_Store(archive_path,index);
+    if(!SFBoolState){
+        File_TargetGeneral_Clean(archive_path);
+        File_TargetGeneral_Clean(Compress_Archive_Index_Path(archive_path));
+    }
+    return SFBoolState;
+}
+
+// ===== Archive Listing =====
+// List member names from the index (no decompression); falls back to `tar -tzf` for unindexed archives
+inline std::optional<std::vector<std::string>> Compress_Archive_List(const std::filesystem::path archive_path){
+    if(!std::filesystem::is_regular_file(archive_path)) return std::nullopt;
+    std::vector<std::string> names;
+    if(auto index = Compress_Archive_Index_Load(archive_path); index){
+        names.reserve(index->members.size());
+        for(const auto& member: index->members) names.push_back(member.name);
+        return names;
+    }
+    Compress_Impl::Child_Process tar;
+    if(!tar.open({"tar","-tzf",archive_path.string()},'r')) return std::nullopt;
+    char line[4096];
+    while(std::fgets(line,sizeof(line),tar.pipe())!=nullptr){
+        std::string name(line);
+        if(!name.empty()&&name.back()=='\n') name.pop_back();
+        names.push_back(std::move(name));
+    }
+    if(!tar.wait()) return std::nullopt;
+    return names;
+}
+
+// ===== Single Member Extraction =====
+// Extract one member (or one directory subtree) into DecompressStore
+// Indexed archives only inflate the frames holding the requested members; a hard link brings along the member
+// it links to (tar needs that file to create the link); without an index tar fails on a lone hard link
+inline bool Compress_Archive_Member_Extract(const std::filesystem::path archive_path,const std::string member_name){
+    using namespace Compress_Impl;
+    if(!std::filesystem::is_regular_file(archive_path)||member_name.empty()) return false;
+    File_StoreFolder_Create(DecompressStore);
+
+    auto index = Compress_Archive_Index_Load(archive_path);
+    if(!index){
+        Child_Process tar;
+        return tar.open({"tar","-xzf",archive_path.string(),"-C",DecompressStore.string(),"--occurrence=1","--",member_name},0)&&tar.wait();
+    }
+
+    std::string trimmed = member_name;
+    while(trimmed.size()>1&&trimmed.back()=='/') trimmed.pop_back();
+    std::vector<bool> selected(index->members.size(),false);
+    for(std::size_t idx=0; idx<index->members.size(); idx++){
+        std::string_view name = index->members[idx].name;
+        if(name.ends_with('/')) name.remove_suffix(1);
+        if(name==trimmed||(name.size()>trimmed.size()&&name.starts_with(trimmed)&&name[trimmed.size()]=='/'))
+            selected[idx] = true;
+    }
+    // Link targets come earlier in the archive than their links
+    for(std::size_t idx=index->members.size(); idx-->0; ){
+        const auto& member = index->members[idx];
+        if(!selected[idx]||member.type!='1') continue;
+        for(std::size_t prev=idx; prev-->0; )
+            if(index->members[prev].name==member.link){ selected[prev] = true; break; }
+    }
+    std::vector<const Compress_Archive_Member*> targets;
+    for(std::size_t idx=0; idx<index->members.size(); idx++) if(selected[idx]) targets.push_back(&index->members[idx]);
+    if(targets.empty()) return false;
+
+    // tar may exit before all of its input is written (a bad member): that is a failed write, not SIGPIPE
+    Pipe_Signal_Guard guard;
+    Child_Process tar;
+    if(!tar.open({"tar","-xf","-","-C",DecompressStore.string()},'w')) return false;
+    FILE* pipe = tar.pipe();
+
+    bool SFBoolState = true;
+    unsigned char data_buf[IO_CHUNK];
+    for(std::size_t idx=0; SFBoolState&&idx<targets.size();){
+        Compress_Frame_Reader reader;
+        std::size_t frame = targets[idx]->frame;
+        SFBoolState = reader.open(archive_path,index->frames[frame]);
+        for(; SFBoolState&&idx<targets.size()&&targets[idx]->frame==frame; idx++){
+            SFBoolState = reader.seek_forward(targets[idx]->frame_offset);
+            std::uint64_t remain = targets[idx]->raw_length;
+            while(SFBoolState&&remain>0){
+                std::size_t got = reader.read(data_buf,std::min<std::uint64_t>(sizeof(data_buf),remain));
+                SFBoolState = got>0&&std::fwrite(data_buf,1,got,pipe)==got;
+                remain -= got;
+            }
+        }
+    }
+    std::memset(data_buf,0,2*TAR_BLOCK);
+    std::fwrite(data_buf,1,2*TAR_BLOCK,pipe);
+    if(!tar.wait()) SFBoolState = false;
+    return SFBoolState;
+}
+
+// ===== Dictionary Compression =====
+// Trees of many small similar files: train one zstd dictionary from a sample of the tree (ZDICT_trainFromBuffer)
+// and store it once. Small files are packed in tree order into blocks of up to DICT_BLOCK_SIZE, each block one zstd
+// frame compressed against the dictionary, so matches reach across neighbouring files; a file of DICT_BLOCK_SIZE
+// or more is a frame of its own. Everything runs in-process on libzstd: frames are compressed on all hardware
+// threads with one shared CDict and decoded with one DDict, so a single member costs one seek and one block decode
+// Pack layout (<name>.zpack): "SFZPACK 3 <index bytes> <index raw bytes>", the text index as one zstd frame
+// (D <dict bytes>, P <folder>, F <offset> <length> <raw bytes>, M <frame> <start> <length> <file>, S <link> with
+// T <target> on the next line, E), then the dictionary and the frames (offsets relative to the end of the index).
+// Names and targets are written with backslash and newline escaped, so every record stays on its line.
+// Symlinks are stored as links; other special files make the pack fail
+struct Compress_Dict_Frame{
+    std::uint64_t offset;
+    std::uint64_t length;
+    std::uint64_t raw;
+};
+struct Compress_Dict_Member{
+    std::string name;
+    std::size_t frame;
+    std::uint64_t start;
+    std::uint64_t length;
+};
+struct Compress_Dict_Link{
+    std::string name;
+    std::string target;
+};
+struct Compress_Dict_Index{
+    std::uint64_t dictionary_length = 0;
+    std::uint64_t data_start = 0;
+    std::vector<std::string> folders;
+    std::vector<Compress_Dict_Frame> frames;
+    std::vector<Compress_Dict_Member> members;
+    std::vector<Compress_Dict_Link> links;
+};
+
+namespace Compress_Impl{
+    constexpr std::size_t DICT_SAMPLE_MAX = 2048;
+    constexpr std::uintmax_t DICT_SAMPLE_FILE_MAX = 128*1024;
+    constexpr std::size_t DICT_SIZE_MAX = 112640;
+    constexpr int DICT_LEVEL = 7;
+    constexpr std::uintmax_t DICT_BLOCK_SIZE = 64*1024;
+    // Frames up to this size are (de)compressed in memory, larger ones are streamed one after another
+    constexpr std::uintmax_t DICT_MEMBER_BUFFER_MAX = 64*1024*1024;
+    // Frames per worker task, each task with its own (de)compression context
+    constexpr std::size_t DICT_TASK_FRAMES = 16;
+
+    // Training samples: small regular files, evenly strided down to DICT_SAMPLE_MAX, concatenated
+    inline bool Dict_Train(const std::vector<std::filesystem::path>& files,const std::vector<std::uintmax_t>& sizes,std::string& dictionary){
+        std::vector<std::size_t> candidates;
+        for(std::size_t idx=0; idx<files.size(); idx++)
+            if(sizes[idx]>0&&sizes[idx]<=DICT_SAMPLE_FILE_MAX) candidates.push_back(idx);
+        if(candidates.size()<8) return false;
+        double stride = std::max(1.0,static_cast<double>(candidates.size())/DICT_SAMPLE_MAX);
+        std::string samples;
+        std::vector<std::size_t> sample_sizes;
+        for(double pos=0; pos<candidates.size(); pos+=stride){
+            std::ifstream ifs(files[candidates[static_cast<std::size_t>(pos)]],std::ios::binary);
+            std::string content((std::istreambuf_iterator<char>(ifs)),std::istreambuf_iterator<char>());
+            if(content.empty()) continue;
+            samples += content;
+            sample_sizes.push_back(content.size());
+        }
+        dictionary.resize(DICT_SIZE_MAX);
+        std::size_t length = ZDICT_trainFromBuffer(dictionary.data(),dictionary.size(),samples.data(),sample_sizes.data(),sample_sizes.size());
+        if(ZDICT_isError(length)) return false;
+        dictionary.resize(length);
+        return true;
+    }
+
+    // Frame settings: the pack's dictionary (or plain DICT_LEVEL without one), no dictionary id in the header
+    inline void Dict_Context_Prepare(ZSTD_CCtx* cctx,const ZSTD_CDict* cdict){
+        ZSTD_CCtx_reset(cctx,ZSTD_reset_session_and_parameters);
+        if(cdict!=nullptr) ZSTD_CCtx_refCDict(cctx,cdict);
+        else ZSTD_CCtx_setParameter(cctx,ZSTD_c_compressionLevel,DICT_LEVEL);
+        ZSTD_CCtx_setParameter(cctx,ZSTD_c_dictIDFlag,0);
+    }
+    // One buffered block as one frame
+    inline bool Dict_Block_Encode(ZSTD_CCtx* cctx,const ZSTD_CDict* cdict,const std::string& block,std::string& frame){
+        Dict_Context_Prepare(cctx,cdict);
+        frame.resize(ZSTD_compressBound(block.size()));
+        std::size_t length = ZSTD_compress2(cctx,frame.data(),frame.size(),block.data(),block.size());
+        if(ZSTD_isError(length)) return false;
+        frame.resize(length);
+        return true;
+    }
+    // One large file as one frame (content size in the header), handed to sink in pieces
+    template<typename Sink>
+    inline bool Dict_Frame_Encode(ZSTD_CCtx* cctx,const ZSTD_CDict* cdict,const std::filesystem::path file,const std::uintmax_t size,Sink&& sink){
+        std::ifstream ifs(file,std::ios::binary);
+        if(!ifs.is_open()) return false;
+        Dict_Context_Prepare(cctx,cdict);
+        ZSTD_CCtx_setPledgedSrcSize(cctx,size);
+        std::vector<char> in_buf(IO_CHUNK), out_buf(ZSTD_CStreamOutSize());
+        std::uintmax_t remain = size;
+        do{
+            std::size_t chunk = std::min<std::uintmax_t>(in_buf.size(),remain);
+            if(chunk>0&&!ifs.read(in_buf.data(),chunk)) return false;
+            remain -= chunk;
+            ZSTD_EndDirective mode = remain==0 ? ZSTD_e_end : ZSTD_e_continue;
+            ZSTD_inBuffer input{in_buf.data(),chunk,0};
+            std::size_t left;
+            do{
+                ZSTD_outBuffer output{out_buf.data(),out_buf.size(),0};
+                left = ZSTD_compressStream2(cctx,&output,&input,mode);
+                if(ZSTD_isError(left)||!sink(out_buf.data(),output.pos)) return false;
+            }while(mode==ZSTD_e_end ? left!=0 : input.pos<input.size);
+        }while(remain>0);
+        return true;
+    }
+    // Index text of a name or link target: backslash and newline escaped
+    inline std::string Dict_Name_Escape(const std::string_view name){
+        std::string escaped;
+        escaped.reserve(name.size());
+        for(const char ch: name){
+            if(ch=='\\') escaped += "\\\\";
+            else if(ch=='\n') escaped += "\\n";
+            else escaped += ch;
+        }
+        return escaped;
+    }
+    inline bool Dict_Name_Unescape(const std::string_view escaped,std::string& name){
+        name.clear();
+        for(std::size_t pos=0; pos<escaped.size(); pos++){
+            if(escaped[pos]!='\\'){ name += escaped[pos]; continue; }
+            if(++pos==escaped.size()) return false;
+            if(escaped[pos]=='\\') name += '\\';
+            else if(escaped[pos]=='n') name += '\n';
+            else return false;
+        }
+        return true;
+    }
+    // A name the pack may write under DecompressStore: relative, no empty, "." or ".." component
+    inline bool Dict_Name_Safe(const std::string_view name){
+        if(name.empty()||name.front()=='/'||name.find('\0')!=std::string_view::npos) return false;
+        for(std::size_t begin=0; begin<=name.size(); ){
+            std::size_t slash = std::min(name.find('/',begin),name.size());
+            std::string_view part = name.substr(begin,slash-begin);
+            if(part.empty()||part=="."||part=="..") return false;
+            begin = slash+1;
+        }
+        return true;
+    }
+    // The folder holding name inside DecompressStore, opened one component at a time with O_NOFOLLOW (missing ones
+    // are created), so no write goes through a symlink, even one the pack created itself; -1 on failure
+    inline int Dict_Store_Parent_Open(const std::string_view name,std::string& leaf){
+        int dir_fd = ::open(DecompressStore.c_str(),O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+        std::size_t begin = 0;
+        for(std::size_t slash; dir_fd>=0&&(slash = name.find('/',begin))!=std::string_view::npos; begin = slash+1){
+            std::string part(name.substr(begin,slash-begin));
+            int sub_fd = mkdirat(dir_fd,part.c_str(),0755)==0||errno==EEXIST
+                ? openat(dir_fd,part.c_str(),O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC) : -1;
+            close(dir_fd);
+            dir_fd = sub_fd;
+        }
+        leaf = name.substr(begin);
+        return dir_fd;
+    }
+    inline bool Dict_Store_Folder(const std::string_view name){
+        std::string leaf;
+        int dir_fd = Dict_Store_Parent_Open(name,leaf);
+        if(dir_fd<0) return false;
+        struct stat st{};
+        bool SFBoolState = mkdirat(dir_fd,leaf.c_str(),0755)==0
+            ||(errno==EEXIST&&fstatat(dir_fd,leaf.c_str(),&st,AT_SYMLINK_NOFOLLOW)==0&&S_ISDIR(st.st_mode));
+        close(dir_fd);
+        return SFBoolState;
+    }
+    // A symlink left by an earlier extraction is replaced, never written through
+    inline int Dict_Store_File_Open(const std::string_view name){
+        std::string leaf;
+        int dir_fd = Dict_Store_Parent_Open(name,leaf);
+        if(dir_fd<0) return -1;
+        int fd = openat(dir_fd,leaf.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_NOFOLLOW|O_CLOEXEC,0644);
+        if(fd<0&&errno==ELOOP&&unlinkat(dir_fd,leaf.c_str(),0)==0)
+            fd = openat(dir_fd,leaf.c_str(),O_WRONLY|O_CREAT|O_TRUNC|O_NOFOLLOW|O_CLOEXEC,0644);
+        close(dir_fd);
+        return fd;
+    }
+    inline bool Dict_Store_Link(const std::string_view name,const std::string& target){
+        std::string leaf;
+        int dir_fd = Dict_Store_Parent_Open(name,leaf);
+        if(dir_fd<0) return false;
+        bool SFBoolState = (unlinkat(dir_fd,leaf.c_str(),0)==0||errno==ENOENT)&&symlinkat(target.c_str(),dir_fd,leaf.c_str())==0;
+        close(dir_fd);
+        return SFBoolState;
+    }
+    inline bool Fd_Write_Full(const int fd,const char* buffer,const std::size_t length){
+        for(std::size_t done=0; done<length; ){
+            ssize_t put = write(fd,buffer+done,length-done);
+            if(put<0&&errno==EINTR) continue;
+            if(put<=0) return false;
+            done += put;
+        }
+        return true;
+    }
+    inline bool Fd_Read_Full(const int fd,char* buffer,const std::size_t length,const std::uint64_t offset){
+        for(std::size_t done=0; done<length; ){
+            ssize_t got = pread(fd,buffer+done,length-done,offset+done);
+            if(got<0&&errno==EINTR) continue;
+            if(got<=0) return false;
+            done += got;
+        }
+        return true;
+    }
+    // The frame at offset (length bytes) of the pack descriptor, decoded whole into raw
+    inline bool Dict_Frame_Load(ZSTD_DCtx* dctx,const ZSTD_DDict* ddict,const int pack_fd,const std::uint64_t offset,
+                                const Compress_Dict_Frame& frame,std::string& raw){
+        std::string compressed(frame.length,'\0');
+        if(!Fd_Read_Full(pack_fd,compressed.data(),compressed.size(),offset+frame.offset)) return false;
+        raw.resize(frame.raw);
+        std::size_t length = ZSTD_decompress_usingDDict(dctx,raw.data(),raw.size(),compressed.data(),compressed.size(),ddict);
+        return !ZSTD_isError(length)&&length==frame.raw;
+    }
+    // The frame decoded straight into target_fd, for frames too large to hold in memory
+    inline bool Dict_Frame_Decode(ZSTD_DCtx* dctx,const ZSTD_DDict* ddict,const int pack_fd,const std::uint64_t offset,
+                                  const Compress_Dict_Frame& frame,const int target_fd){
+        ZSTD_DCtx_reset(dctx,ZSTD_reset_session_and_parameters);
+        if(ddict!=nullptr) ZSTD_DCtx_refDDict(dctx,ddict);
+        std::vector<char> in_buf(IO_CHUNK), out_buf(ZSTD_DStreamOutSize());
+        std::size_t left = 1;
+        for(std::uint64_t done=0; done<frame.length; ){
+            std::size_t chunk = std::min<std::uint64_t>(in_buf.size(),frame.length-done);
+            if(!Fd_Read_Full(pack_fd,in_buf.data(),chunk,offset+frame.offset+done)) return false;
+            done += chunk;
+            ZSTD_inBuffer input{in_buf.data(),chunk,0};
+            // A full output buffer may leave decoded bytes behind: call again until it comes back partly empty
+            bool full = false;
+            do{
+                ZSTD_outBuffer output{out_buf.data(),out_buf.size(),0};
+                left = ZSTD_decompressStream(dctx,&output,&input);
+                if(ZSTD_isError(left)||!Fd_Write_Full(target_fd,out_buf.data(),output.pos)) return false;
+                full = output.pos==output.size;
+            }while(input.pos<input.size||full);
+        }
+        // 0 once the frame is complete and flushed
+        return left==0;
+    }
+    inline bool File_Copy_Range(std::ifstream& source_ifs,const std::uint64_t offset,std::uint64_t length,std::string& target){
+        source_ifs.seekg(offset);
+        target.resize(length);
+        return static_cast<bool>(source_ifs.read(target.data(),length));
+    }
+};
+
+// Load pack index (nullopt when missing, malformed, of another version or naming anything outside the pack's folder)
+inline std::optional<Compress_Dict_Index> Compress_Dict_Index_Load(std::ifstream& pack_ifs){
+    Compress_Dict_Index index;
+    std::string line, packed, text;
+    std::uint64_t packed_length = 0, text_length = 0;
+    if(!std::getline(pack_ifs,line)||std::sscanf(line.c_str(),"SFZPACK 3 %lu %lu",&packed_length,&text_length)!=2) return std::nullopt;
+    if(!Compress_Impl::File_Copy_Range(pack_ifs,pack_ifs.tellg(),packed_length,packed)) return std::nullopt;
+    index.data_start = pack_ifs.tellg();
+    text.resize(text_length);
+    if(std::size_t length = ZSTD_decompress(text.data(),text.size(),packed.data(),packed.size()); ZSTD_isError(length)||length!=text_length) return std::nullopt;
+    // Names come from the pack: absolute ones and ".." would write outside DecompressStore
+    auto name_load = [](const std::string_view escaped,std::string& name){
+        return Compress_Impl::Dict_Name_Unescape(escaped,name)&&Compress_Impl::Dict_Name_Safe(name);
+    };
+    std::istringstream text_iss(std::move(text));
+    while(std::getline(text_iss,line)){
+        if(line=="E") return index;
+        if(line.rfind("D ",0)==0) index.dictionary_length = std::strtoull(line.c_str()+2,nullptr,10);
+        else if(line.rfind("P ",0)==0){
+            if(!name_load(std::string_view(line).substr(2),index.folders.emplace_back())) return std::nullopt;
+        }
+        else if(line.rfind("F ",0)==0){
+            Compress_Dict_Frame frame{};
+            if(std::sscanf(line.c_str(),"F %lu %lu %lu",&frame.offset,&frame.length,&frame.raw)!=3) return std::nullopt;
+            index.frames.push_back(frame);
+        }else if(line.rfind("M ",0)==0){
+            Compress_Dict_Member member{};
+            int name_pos = 0;
+            if(std::sscanf(line.c_str(),"M %zu %lu %lu %n",&member.frame,&member.start,&member.length,&name_pos)!=3||name_pos==0) return std::nullopt;
+            if(member.frame>=index.frames.size()||member.start+member.length>index.frames[member.frame].raw) return std::nullopt;
+            if(!name_load(std::string_view(line).substr(name_pos),member.name)) return std::nullopt;
+            index.members.push_back(std::move(member));
+        }else if(line.rfind("S ",0)==0){
+            std::string target;
+            Compress_Dict_Link link;
+            if(!std::getline(text_iss,target)||target.rfind("T ",0)!=0||!name_load(std::string_view(line).substr(2),link.name)
+                ||!Compress_Impl::Dict_Name_Unescape(std::string_view(target).substr(2),link.target)||link.target.empty()) return std::nullopt;
+            index.links.push_back(std::move(link));
+        }
+    }
+    return std::nullopt;
+}
+
+// Dictionary and decoding context of one opened pack
+class Compress_Dict_Reader{
+    int pack_fd = -1;
+    ZSTD_DDict* ddict = nullptr;
+public:
+    Compress_Dict_Index index;
+
+    Compress_Dict_Reader() = default;
+    Compress_Dict_Reader(const Compress_Dict_Reader&) = delete;
+    Compress_Dict_Reader& operator=(const Compress_Dict_Reader&) = delete;
+    ~Compress_Dict_Reader(){
+        ZSTD_freeDDict(ddict);
+        if(pack_fd>=0) close(pack_fd);
+    }
+
+    bool open(const std::filesystem::path pack_path){
+        std::ifstream pack_ifs(pack_path,std::ios::binary);
+        if(!pack_ifs.is_open()) return false;
+        auto loaded = Compress_Dict_Index_Load(pack_ifs);
+        if(!loaded) return false;
+        index = std::move(*loaded);
+        if(index.dictionary_length>0){
+            std::string dictionary;
+            if(!Compress_Impl::File_Copy_Range(pack_ifs,index.data_start,index.dictionary_length,dictionary)) return false;
+            ddict = ZSTD_createDDict(dictionary.data(),dictionary.size());
+            if(ddict==nullptr) return false;
+        }
+        pack_fd = ::open(pack_path.c_str(),O_RDONLY|O_CLOEXEC);
+        return pack_fd>=0;
+    }
+    // Write the given members of one frame (all in that frame) to DecompressStore; the DCtx belongs to the
+    // calling thread, raw is its reusable block buffer, the DDict is shared
+    bool extract(ZSTD_DCtx* dctx,const std::size_t frame_idx,const std::vector<const Compress_Dict_Member*>& members,std::string& raw) const {
+        using namespace Compress_Impl;
+        const auto& frame = index.frames[frame_idx];
+        bool streamed = frame.raw>DICT_MEMBER_BUFFER_MAX;
+        if(!streamed&&!Dict_Frame_Load(dctx,ddict,pack_fd,index.data_start,frame,raw)) return false;
+        for(const auto* member: members){
+            int fd = Dict_Store_File_Open(member->name);
+            if(fd<0) return false;
+            bool SFBoolState = streamed ? Dict_Frame_Decode(dctx,ddict,pack_fd,index.data_start,frame,fd)
+                : Fd_Write_Full(fd,raw.data()+member->start,member->length);
+            if(close(fd)!=0||!SFBoolState) return false;
+        }
+        return true;
+    }
+};
+
+// Create <name>.zpack in CompressStore (frames without a dictionary when training is impossible)
+inline bool Compress_Dict_Create(const std::filesystem::path source_path){
+    using namespace Compress_Impl;
+    if(!std::filesystem::is_directory(source_path)) return false;
+    std::string name = source_path.filename().string();
+    std::filesystem::path data_path = CompressStore/(name+".zpack.data");
+    std::filesystem::path pack_path = CompressStore/(name+".zpack");
+
+    // The tree as it is: symlinks are not followed, member names keep the link's own path
+    Compress_Dict_Index index;
+    std::vector<std::filesystem::path> files;
+    std::vector<std::uintmax_t> sizes;
+    index.folders.push_back(name);
+    std::error_code ec;
+    for(auto it = std::filesystem::recursive_directory_iterator(source_path,ec); !ec&&it!=std::filesystem::recursive_directory_iterator(); it.increment(ec)){
+        std::string relate = (std::filesystem::path(name)/it->path().lexically_relative(source_path)).string();
+        auto status = it->symlink_status(ec);
+        if(ec) return false;
+        if(std::filesystem::is_symlink(status)){
+            auto target = std::filesystem::read_symlink(it->path(),ec);
+            if(ec) return false;
+            index.links.push_back(Compress_Dict_Link{relate,target.string()});
+        }
+        else if(std::filesystem::is_directory(status)) index.folders.push_back(relate);
+        else if(std::filesystem::is_regular_file(status)){
+            sizes.push_back(it->file_size(ec));
+            if(ec) return false;
+            index.members.push_back(Compress_Dict_Member{relate,0,0,0});
+            files.push_back(it->path());
+        }
+        else return false;
+    }
+    if(ec) return false;
+
+    // Frame plan: runs of small members up to DICT_BLOCK_SIZE, every larger member alone
+    std::vector<std::vector<std::size_t>> plan;
+    std::uintmax_t block_size = 0;
+    for(std::size_t idx=0; idx<files.size(); idx++){
+        if(sizes[idx]>=DICT_BLOCK_SIZE) plan.push_back({idx});
+        else{
+            if(plan.empty()||block_size+sizes[idx]>DICT_BLOCK_SIZE||sizes[plan.back().front()]>=DICT_BLOCK_SIZE){
+                plan.emplace_back();
+                block_size = 0;
+            }
+            plan.back().push_back(idx);
+            block_size += sizes[idx];
+        }
+    }
+    index.frames.assign(plan.size(),Compress_Dict_Frame{0,0,0});
+
+    std::string dictionary;
+    bool has_dictionary = Dict_Train(files,sizes,dictionary);
+    ZSTD_CDict* cdict = has_dictionary ? ZSTD_createCDict(dictionary.data(),dictionary.size(),DICT_LEVEL) : nullptr;
+    if(has_dictionary&&cdict==nullptr) return false;
+
+    // Frames that fit in memory are compressed in parallel and appended in the order they finish; larger ones
+    // follow, streamed. A member's place in its block is taken from what was actually read
+    std::ofstream data_ofs(data_path,std::ios::binary|std::ios::trunc);
+    std::mutex data_mtx;
+    std::uint64_t data_size = 0;
+    std::atomic<bool> SFBoolState = data_ofs.is_open();
+    std::vector<std::size_t> large;
+    Parallel_Work_Queue<std::pair<std::size_t,std::size_t>> queue;
+    for(std::size_t begin=0; begin<plan.size(); begin+=DICT_TASK_FRAMES)
+        queue.Push({begin,std::min(begin+DICT_TASK_FRAMES,plan.size())});
+    queue.Run(Parallel_Worker_Count(),[&](std::pair<std::size_t,std::size_t>& range){
+        std::unique_ptr<ZSTD_CCtx,decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(),&ZSTD_freeCCtx);
+        std::string block, frame;
+        for(std::size_t frame_idx=range.first; frame_idx<range.second&&SFBoolState; frame_idx++){
+            const auto& idxs = plan[frame_idx];
+            if(sizes[idxs.front()]>DICT_MEMBER_BUFFER_MAX){
+                std::lock_guard lock(data_mtx);
+                large.push_back(frame_idx);
+                continue;
+            }
+            bool encoded = static_cast<bool>(cctx);
+            block.clear();
+            for(std::size_t pos=0; encoded&&pos<idxs.size(); pos++){
+                std::ifstream ifs(files[idxs[pos]],std::ios::binary);
+                encoded = ifs.is_open();
+                index.members[idxs[pos]].frame = frame_idx;
+                index.members[idxs[pos]].start = block.size();
+                block.append(std::istreambuf_iterator<char>(ifs),std::istreambuf_iterator<char>());
+                index.members[idxs[pos]].length = block.size()-index.members[idxs[pos]].start;
+            }
+            encoded = encoded&&Dict_Block_Encode(cctx.get(),cdict,block,frame);
+            std::lock_guard lock(data_mtx);
+            if(!encoded){
+                SFBoolState = false;
+                queue.Cancel();
+                return;
+            }
+            index.frames[frame_idx] = Compress_Dict_Frame{dictionary.size()+data_size,frame.size(),block.size()};
+            data_ofs.write(frame.data(),frame.size());
+            data_size += frame.size();
+        }
+    });
+    if(SFBoolState&&!large.empty()){
+        std::unique_ptr<ZSTD_CCtx,decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(),&ZSTD_freeCCtx);
+        for(const auto frame_idx: large){
+            std::size_t idx = plan[frame_idx].front();
+            std::uint64_t begin = data_size;
+            SFBoolState = Dict_Frame_Encode(cctx.get(),cdict,files[idx],sizes[idx],[&](const char* data,std::size_t len){
+                data_ofs.write(data,len);
+                data_size += len;
+                return data_ofs.good();
+            });
+            if(!SFBoolState) break;
+            index.frames[frame_idx] = Compress_Dict_Frame{dictionary.size()+begin,data_size-begin,sizes[idx]};
+            index.members[idx] = Compress_Dict_Member{index.members[idx].name,frame_idx,0,sizes[idx]};
+        }
+    }
+    ZSTD_freeCDict(cdict);
+    data_ofs.close();
+    if(data_ofs.fail()) SFBoolState = false;
+
+    if(SFBoolState){
+        // Member names repeat their folders over and over, so the index is compressed as well
+        std::ostringstream text_oss;
+        text_oss<<"D "<<dictionary.size()<<'\n';
+        for(const auto& folder: index.folders) text_oss<<"P "<<Dict_Name_Escape(folder)<<'\n';
+        for(const auto& frame: index.frames) text_oss<<"F "<<frame.offset<<' '<<frame.length<<' '<<frame.raw<<'\n';
+        for(const auto& member: index.members)
+            text_oss<<"M "<<member.frame<<' '<<member.start<<' '<<member.length<<' '<<Dict_Name_Escape(member.name)<<'\n';
+        for(const auto& link: index.links) text_oss<<"S "<<Dict_Name_Escape(link.name)<<"\nT "<<Dict_Name_Escape(link.target)<<'\n';
+        text_oss<<"E\n";
+        std::string text = std::move(text_oss).str(), packed(ZSTD_compressBound(text.size()),'\0');
+        std::size_t packed_length = ZSTD_compress(packed.data(),packed.size(),text.data(),text.size(),DICT_LEVEL);
+        if(ZSTD_isError(packed_length)) SFBoolState = false;
+        std::ofstream pack_ofs(pack_path,std::ios::binary|std::ios::trunc);
+        pack_ofs<<"SFZPACK 3 "<<packed_length<<' '<<text.size()<<'\n';
+        pack_ofs.write(packed.data(),SFBoolState ? packed_length : 0);
+        pack_ofs.write(dictionary.data(),dictionary.size());
+        std::ifstream data_ifs(data_path,std::ios::binary);
+        if(data_size>0) pack_ofs<<data_ifs.rdbuf();
+        SFBoolState = SFBoolState&&pack_ofs.good();
+    }
+    File_TargetGeneral_Clean(data_path);
+    if(!SFBoolState) File_TargetGeneral_Clean(pack_path);
+    return SFBoolState;
+}
+// Extract a whole pack into DecompressStore/<name>: folders first, then every frame decoded on all hardware threads,
+// symlinks last (like tar, so no member is written through a link of the pack)
+inline bool Compress_Dict_Extract(const std::filesystem::path pack_path){
+    Compress_Dict_Reader reader;
+    if(!reader.open(pack_path)) return false;
+    for(const auto& folder: reader.index.folders)
+        if(!Compress_Impl::Dict_Store_Folder(folder)) return false;
+
+    std::vector<std::vector<const Compress_Dict_Member*>> by_frame(reader.index.frames.size());
+    for(const auto& member: reader.index.members) by_frame[member.frame].push_back(&member);
+    std::atomic<bool> SFBoolState = true;
+    Parallel_Work_Queue<std::pair<std::size_t,std::size_t>> queue;
+    for(std::size_t begin=0; begin<by_frame.size(); begin+=Compress_Impl::DICT_TASK_FRAMES)
+        queue.Push({begin,std::min(begin+Compress_Impl::DICT_TASK_FRAMES,by_frame.size())});
+    queue.Run(Parallel_Worker_Count(),[&](std::pair<std::size_t,std::size_t>& range){
+        std::unique_ptr<ZSTD_DCtx,decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),&ZSTD_freeDCtx);
+        std::string raw;
+        for(std::size_t frame_idx=range.first; frame_idx<range.second&&SFBoolState; frame_idx++){
+            if(by_frame[frame_idx].empty()) continue;
+            if(!dctx||!reader.extract(dctx.get(),frame_idx,by_frame[frame_idx],raw)){
+                SFBoolState = false;
+                queue.Cancel();
+            }
+        }
+    });
+    for(const auto& link: reader.index.links){
+        if(!SFBoolState) break;
+        if(!Compress_Impl::Dict_Store_Link(link.name,link.target)) SFBoolState = false;
+    }
+    return SFBoolState;
+}
+// Extract one file (or symlink) of a pack: the index is read, then only the dictionary and that file's frame
+inline bool Compress_Dict_Member_Extract(const std::filesystem::path pack_path,const std::string member_name){
+    Compress_Dict_Reader reader;
+    if(member_name.empty()||!reader.open(pack_path)) return false;
+    File_StoreFolder_Create(DecompressStore);
+
+    auto link = std::find_if(reader.index.links.begin(),reader.index.links.end(),[&](const Compress_Dict_Link& l){return l.name==member_name;});
+    if(link!=reader.index.links.end()) return Compress_Impl::Dict_Store_Link(link->name,link->target);
+    auto member = std::find_if(reader.index.members.begin(),reader.index.members.end(),[&](const Compress_Dict_Member& m){return m.name==member_name;});
+    if(member==reader.index.members.end()) return false;
+    std::unique_ptr<ZSTD_DCtx,decltype(&ZSTD_freeDCtx)> dctx(ZSTD_createDCtx(),&ZSTD_freeDCtx);
+    std::string raw;
+    return dctx&&reader.extract(dctx.get(),member->frame,{&*member},raw);
+}
+
 // ===== Core Compression =====
 // Compress or decompress files using tar with gzip
-// Supports two modes: Compress (create .tar.gz) and Decompress (extract .tar.gz)
-enum class CompressMode{Compress,Decompress,};
+// Supports four modes: Compress (create indexed .tar.gz), Decompress (extract .tar.gz),
+// DictCompress (create dictionary .zpack) and DictDecompress (extract .zpack)
+enum class CompressMode{Compress,Decompress,DictCompress,DictDecompress,};
 inline bool Compress(CompressMode tar_type,std::filesystem::path source_path){
     int result = -1;
     switch (tar_type){
     case CompressMode::Compress:{
         File_StoreFolder_Create(CompressStore);
-        std::string cmd = "tar -czf "+CompressStore.string()+"/"+source_path.filename().string()+".tar.gz "+source_path.filename().string();
-        result = system(cmd.data());
+        std::filesystem::path archive_path = CompressStore/(source_path.filename().string()+".tar.gz");
+        result = Compress_Archive_Create_Indexed(source_path,archive_path) ? 0 : -1;
         break;}    
     case CompressMode::Decompress:{
         File_StoreFolder_Create(DecompressStore);
-        std::string cmd = "tar -xzf "+source_path.string()+" -C "+DecompressStore.string();
-        result = system(cmd.data());
+        Compress_Impl::Child_Process tar;
+        result = tar.open({"tar","-xzf",source_path.string(),"-C",DecompressStore.string()},0)&&tar.wait() ? 0 : -1;
+        break;}
+    case CompressMode::DictCompress:{
+        File_StoreFolder_Create(CompressStore);
+        result = Compress_Dict_Create(source_path) ? 0 : -1;
+        break;}
+    case CompressMode::DictDecompress:{
+        File_StoreFolder_Create(DecompressStore);
+        result = Compress_Dict_Extract(source_path) ? 0 : -1;
         break;}
     default: break;
     }
@@ -45,6 +1046,10 @@ inline bool Compress_Interface(std::string tar_type,std::filesystem::path source
         return Compress(CompressMode::Compress, source_path); 
     else if (tar_type == "Decompress") 
         return Compress(CompressMode::Decompress, source_path);
+    else if (tar_type == "DictCompress")
+        return Compress(CompressMode::DictCompress, source_path);
+    else if (tar_type == "DictDecompress")
+        return Compress(CompressMode::DictDecompress, source_path);
     return false;
 }
 
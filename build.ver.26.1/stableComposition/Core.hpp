@@ -2,15 +2,90 @@
 #include "Compress.hpp"
 #include "GeneralFileOper.hpp"
 #include "TuiFileManager.hpp"
+#include "FileWipe.hpp"
+#include "FileCopy.hpp"
+#include "FileManifest.hpp"
+#include "FolderWatch.hpp"
+#include "ParallelTask.hpp"
 #include <sodium.h>
 
 #include <filesystem>
 #include <fstream>
 #include <stack>
 #include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
 // #include <iostream>
 
 enum class Crypto_Type {Enc,Dec};
+
+// ===== Plaintext Cleanup =====
+// DecStore_AutoWipe (SECURITY_TOOL_AUTOWIPE=1): plaintext removed by the crypto flows is wiped instead of unlinked
+// Remove a plaintext file or folder left behind by a crypto flow
+inline bool DecStore_AutoWipe = []{
+    const char* env = std::getenv("SECURITY_TOOL_AUTOWIPE");
+    return env!=nullptr&&std::string(env)=="1";
+}();
+inline void Crypto_Plaintext_Clean(const std::filesystem::path target_path){
+    if(DecStore_AutoWipe) File_Wipe_Parallel(target_path);
+    else File_TargetGeneral_Clean(target_path);
+}
+// ===== Batch Key =====
+// One Argon2 derivation shared by a batch of files: each file stores the same salt, so decryption is unchanged,
+// and every file still gets its own random secretstream header
+class Crypto_Batch_Key{
+public:
+    unsigned char salt[crypto_pwhash_SALTBYTES];
+    unsigned char key[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+
+    explicit Crypto_Batch_Key(const std::string& password){
+        if(sodium_init()<0)
+            throw std::runtime_error("libsodium init failed");
+        randombytes_buf(salt,sizeof(salt));
+        crypto_pwhash(key,sizeof(key),password.c_str(),password.size(),salt,
+            crypto_pwhash_OPSLIMIT_MODERATE,crypto_pwhash_MEMLIMIT_MODERATE,crypto_pwhash_ALG_DEFAULT);
+    }
+    Crypto_Batch_Key(const Crypto_Batch_Key&) = delete;
+    Crypto_Batch_Key& operator=(const Crypto_Batch_Key&) = delete;
+    ~Crypto_Batch_Key(){ sodium_memzero(key,sizeof(key)); }
+};
+// Decryption side of a batch: the key of every distinct salt is derived once and shared by the files carrying it
+// (a selection encrypted together costs one Argon2 run); derivations are serialised, each takes MEMLIMIT_MODERATE
+class Crypto_Key_Cache{
+    using Salt = std::array<unsigned char,crypto_pwhash_SALTBYTES>;
+    using Key = std::array<unsigned char,crypto_secretstream_xchacha20poly1305_KEYBYTES>;
+    std::mutex mtx;
+    std::string password;
+    std::map<Salt,Key> keys;
+public:
+    explicit Crypto_Key_Cache(std::string _password): password(std::move(_password)) {}
+    Crypto_Key_Cache(const Crypto_Key_Cache&) = delete;
+    Crypto_Key_Cache& operator=(const Crypto_Key_Cache&) = delete;
+    ~Crypto_Key_Cache(){
+        for(auto& [salt,key]: keys) sodium_memzero(key.data(),key.size());
+        sodium_memzero(password.data(),password.size());
+    }
+
+    void Key_Get(const unsigned char* salt,unsigned char* key){
+        Salt salt_key;
+        std::memcpy(salt_key.data(),salt,salt_key.size());
+        std::lock_guard lock(mtx);
+        auto it = keys.find(salt_key);
+        if(it==keys.end()){
+            it = keys.emplace(salt_key,Key{}).first;
+            crypto_pwhash(it->second.data(),it->second.size(),password.c_str(),password.size(),salt,
+                crypto_pwhash_OPSLIMIT_MODERATE,crypto_pwhash_MEMLIMIT_MODERATE,crypto_pwhash_ALG_DEFAULT);
+        }
+        std::memcpy(key,it->second.data(),it->second.size());
+    }
+};
+
 // ===== Core Crypto Classes =====
 // File stream admin for handling file I/O
 // File encryption class
@@ -43,6 +118,10 @@ public:
         crypto_pwhash(encrypt_key,crypto_secretstream_xchacha20poly1305_KEYBYTES,password.c_str(),password.size(),salt,
             crypto_pwhash_OPSLIMIT_MODERATE,crypto_pwhash_MEMLIMIT_MODERATE, crypto_pwhash_ALG_DEFAULT);
     }
+    void EncryptKey(const Crypto_Batch_Key& batch_key){
+        std::memcpy(salt,batch_key.salt,sizeof(salt));
+        std::memcpy(encrypt_key,batch_key.key,sizeof(encrypt_key));
+    }
 
     bool EncryptFile(const std::filesystem::path source_file,const std::filesystem::path target_file){
         fstream_admin.init_ifstream(source_file); fstream_admin.init_ofstream(target_file);
@@ -87,7 +166,8 @@ public:
             throw std::runtime_error("libsodium init failed");
     }
 
-    bool DecryptFile(const std::filesystem::path source_file,const std::filesystem::path target_file, const std::string password){
+    bool DecryptFile(const std::filesystem::path source_file,const std::filesystem::path target_file, const std::string password,
+        Crypto_Key_Cache* key_cache = nullptr){
         fstream_admin.init_ifstream(source_file); fstream_admin.init_ofstream(target_file);
         if(!fstream_admin.source_ifs.is_open()||!fstream_admin.target_ofs.is_open())
             return false;
@@ -98,7 +178,8 @@ public:
         fstream_admin.source_ifs.read(reinterpret_cast<char*>(salt),sizeof(salt));
 
         unsigned char decrypt_key[crypto_secretstream_xchacha20poly1305_KEYBYTES];
-        DecryptKey(password, salt, decrypt_key);
+        if(key_cache!=nullptr) key_cache->Key_Get(salt, decrypt_key);
+        else DecryptKey(password, salt, decrypt_key);
 
 
         if(crypto_secretstream_xchacha20poly1305_init_pull(&decrypt_state,decrypt_header,decrypt_key)!=0)
@@ -144,18 +225,22 @@ namespace Crypto_Impl{
 
     // ===== Crypto File Cleanup =====
     // Cleanup result structure after crypto operation
+    // Plaintext side (Enc source / partial Dec target) goes through Crypto_Plaintext_Clean
     struct Crypto_SFBoolState_Info_Clean{
         bool SFBoolState;
         std::filesystem::path source_file;
         std::filesystem::path target_file;
+        Crypto_Type crypto_type;
     };
     inline void Crypto_SFStateBoolState_Func_Clean(const Crypto_SFBoolState_Info_Clean SFBoolState_Info){
         if(SFBoolState_Info.SFBoolState) {
-            std::filesystem::remove(SFBoolState_Info.source_file);
+            if(SFBoolState_Info.crypto_type==Crypto_Type::Enc) Crypto_Plaintext_Clean(SFBoolState_Info.source_file);
+            else std::filesystem::remove(SFBoolState_Info.source_file);
             File_EmptyFolder_CleanParent_Recursive(SFBoolState_Info.source_file);
         }
         else{
-            std::filesystem::remove(SFBoolState_Info.target_file);
+            if(SFBoolState_Info.crypto_type==Crypto_Type::Dec) Crypto_Plaintext_Clean(SFBoolState_Info.target_file);
+            else std::filesystem::remove(SFBoolState_Info.target_file);
             File_EmptyFolder_CleanParent_Recursive(SFBoolState_Info.target_file);
         }
     }
@@ -178,6 +263,10 @@ namespace Crypto_Impl{
         std::filesystem::path source_file;
         std::string password;
         bool imply_SFBoolState;
+        // Enc only: key derived once for a whole batch instead of once per file
+        const Crypto_Batch_Key* batch_key = nullptr;
+        // Dec only: keys shared by the files of a batch, looked up by salt
+        Crypto_Key_Cache* key_cache = nullptr;
     };
     inline bool Crypto_Core_File(Crypto_Type crypto_type,const Crypto_Operate_Info object_info,std::filesystem::path* target_path_output){
         File_StoreFolder_Create(object_info.target_folder);
@@ -185,33 +274,54 @@ namespace Crypto_Impl{
         bool SFBoolState;
         switch(crypto_type){
             case Crypto_Type::Enc:{
+                // Without a source the target is left alone: it may be the ciphertext an earlier run wrote
+                std::error_code ec;
+                if(!std::filesystem::is_regular_file(object_info.source_file,ec)) return false;
                 target_file = File_Crypto_SingleFile_Create(crypto_type,object_info.target_folder,object_info.source_file);
                 Crypto_File_Encrypt cfe;
-                cfe.EncryptKey(object_info.password);
+                if(object_info.batch_key!=nullptr) cfe.EncryptKey(*object_info.batch_key);
+                else cfe.EncryptKey(object_info.password);
                 SFBoolState = cfe.EncryptFile(object_info.source_file,target_file);
                 break;
             }
             case Crypto_Type::Dec:{
                 target_file = File_Crypto_SingleFile_Create(crypto_type,object_info.target_folder,object_info.source_file);
                 Crypto_File_Decrypt cfd;
-                SFBoolState = cfd.DecryptFile(object_info.source_file,target_file,object_info.password);
+                SFBoolState = cfd.DecryptFile(object_info.source_file,target_file,object_info.password,object_info.key_cache);
                 break;
             }
             default: break;
         }
-        if(object_info.imply_SFBoolState){ Crypto_SFStateBoolState_Func_Clean(Crypto_SFBoolState_Info_Clean{SFBoolState,object_info.source_file,target_file});}
+        if(object_info.imply_SFBoolState){ Crypto_SFStateBoolState_Func_Clean(Crypto_SFBoolState_Info_Clean{SFBoolState,object_info.source_file,target_file,crypto_type});}
         if(target_path_output!=nullptr) *target_path_output = target_file;
         return SFBoolState;
     }
 
+    // The ciphertext is kept until the edit is over: if the plaintext digest did not change it is moved
+    // to EncStore as it is, otherwise the file is re-encrypted and the old ciphertext removed
     inline bool Crypto_File_Temporary(const Crypto_Operate_Info object_info){
         std::filesystem::path temporary_path;
-        bool SFBoolState_1 = Crypto_Core_File(Crypto_Type::Dec,object_info,&temporary_path);
-        if(!SFBoolState_1) return false;
+        bool SFBoolState_1 = Crypto_Core_File(Crypto_Type::Dec,Crypto_Operate_Info{object_info.target_folder,object_info.source_file,object_info.password,false},&temporary_path);
+        if(!SFBoolState_1){
+            Crypto_SFStateBoolState_Func_Clean(Crypto_SFBoolState_Info_Clean{false,object_info.source_file,temporary_path,Crypto_Type::Dec});
+            return false;
+        }
+        File_Manifest plaintext_before, plaintext_after;
+        File_Manifest_Create(temporary_path,plaintext_before);
 
         Terminal_MountCurrentTUI_LaunchNewTUI(File_Vim_TextCompiler,temporary_path);
 
+        File_Manifest_Create(temporary_path,plaintext_after);
+        std::filesystem::path target_file = EncStore/(temporary_path.filename().string()+".vlt");
+        if(!plaintext_before.empty()&&File_Manifest_Compare(plaintext_before,plaintext_after).Clean()){
+            File_StoreFolder_Create(EncStore);
+            if(target_file==object_info.source_file||File_Move_Path(object_info.source_file,target_file)){
+                Crypto_Plaintext_Clean(temporary_path);
+                return true;
+            }
+        }
         bool SFBoolState_2 = Crypto_Core_File(Crypto_Type::Enc,Crypto_Operate_Info{EncStore,temporary_path,object_info.password,true},nullptr);
+        if(SFBoolState_2&&target_file!=object_info.source_file) std::filesystem::remove(object_info.source_file);
         return SFBoolState_2;
     }
 
@@ -242,23 +352,82 @@ namespace Crypto_Impl{
                 }
             }
         }
-        File_TargetFolder_Clean(object_info.source_file);
+        if(object_info.imply_SFBoolState){
+            if(crypto_type==Crypto_Type::Enc) Crypto_Plaintext_Clean(object_info.source_file);
+            else File_TargetFolder_Clean(object_info.source_file);
+        }
         if(target_path_output!=nullptr) *target_path_output = target_base_folder;
         return true;
 
         SFBoolState_Failed:
-        File_TargetFolder_Clean(target_base_folder);
+        if(crypto_type==Crypto_Type::Dec) Crypto_Plaintext_Clean(target_base_folder);
+        else File_TargetFolder_Clean(target_base_folder);
         return false;
     }
 
+    // ===== Unchanged File Reuse =====
+    // Re-encrypt an edited Tmp folder: a file whose plaintext digest still matches the one taken at decryption
+    // gets its old .vlt hard-linked instead of a new key derivation and encryption (same password, same content)
+    // The tree is built in a staging folder and replaces the old encrypted tree only once complete
+    inline bool Crypto_Folder_Reencrypt_Changed(const Crypto_Operate_Info object_info,const std::filesystem::path cipher_folder,const File_Manifest& plaintext_before){
+        File_Manifest plaintext_after;
+        File_Manifest_Create(object_info.source_file,plaintext_after);
+        File_StoreFolder_Create(object_info.target_folder);
+        std::filesystem::path staging_folder = File_Non_Repeating_Path(object_info.target_folder,L"."+object_info.source_file.filename().wstring()+L".staging");
+        File_StoreFolder_Create(staging_folder);
+
+        auto Staging_Fill = [&]{
+            std::stack<std::filesystem::path> Folder_cache;
+            Folder_cache.push(object_info.source_file);
+            while(!Folder_cache.empty()){
+                std::filesystem::path folder_current = Folder_cache.top(); Folder_cache.pop();
+                for(const auto& entry: std::filesystem::directory_iterator(folder_current)){
+                    std::filesystem::path relative = entry.path().lexically_relative(object_info.source_file);
+                    std::filesystem::path target_position = staging_folder/relative;
+                    if(std::filesystem::is_directory(entry.path())){
+                        File_StoreFolder_Create(target_position);
+                        Folder_cache.push(entry.path());
+                        continue;
+                    }
+                    const File_Manifest_Entry* before = File_Manifest_Find(plaintext_before,relative.string());
+                    const File_Manifest_Entry* after = File_Manifest_Find(plaintext_after,relative.string());
+                    if(before!=nullptr&&after!=nullptr&&sodium_memcmp(before->digest.data(),after->digest.data(),before->digest.size())==0){
+                        std::error_code ec;
+                        std::filesystem::create_hard_link(cipher_folder/(relative.string()+".vlt"),staging_folder/(relative.string()+".vlt"),ec);
+                        if(!ec) continue;
+                    }
+                    if(!Crypto_Core_File(Crypto_Type::Enc,Crypto_Operate_Info{target_position.parent_path(),entry.path(),object_info.password,false},nullptr))
+                        return false;
+                }
+            }
+            return true;
+        };
+        if(!Staging_Fill()){
+            File_TargetFolder_Clean(staging_folder);
+            return false;
+        }
+        // Old ciphertext goes first (the target is usually the same folder); reused files live on through their links
+        File_TargetFolder_Clean(cipher_folder);
+        std::filesystem::path target_base_folder = object_info.target_folder/object_info.source_file.filename();
+        if(std::filesystem::exists(target_base_folder)) target_base_folder = File_Non_Repeating_Path(object_info.target_folder,object_info.source_file.filename().wstring());
+        std::error_code ec;
+        std::filesystem::rename(staging_folder,target_base_folder,ec);
+        if(ec) return false;
+        Crypto_Plaintext_Clean(object_info.source_file);
+        return true;
+    }
+
+    // The encrypted tree stays in place while the folder is edited, so unchanged files can keep their ciphertext
     inline bool Crypto_Folder_Temporary_Recursive(const Crypto_Operate_Info object_info){
         std::filesystem::path temporary_path;
-        bool SFBoolState_1 = Crypto_Folder_File_Recursive(Crypto_Type::Dec,object_info,&temporary_path);
+        bool SFBoolState_1 = Crypto_Folder_File_Recursive(Crypto_Type::Dec,Crypto_Operate_Info{object_info.target_folder,object_info.source_file,object_info.password,false},&temporary_path);
         if(!SFBoolState_1) return false;
+        File_Manifest plaintext_before;
+        File_Manifest_Create(temporary_path,plaintext_before);
 
         Terminal_MountCurrentTUI_LaunchNewTUI(Terminal_FileManager_Interface,temporary_path);
 
-        bool SFBoolState_2 = Crypto_Folder_File_Recursive(Crypto_Type::Enc,Crypto_Operate_Info{EncStore,temporary_path,object_info.password,true},nullptr);
+        bool SFBoolState_2 = Crypto_Folder_Reencrypt_Changed(Crypto_Operate_Info{EncStore,temporary_path,object_info.password,true},object_info.source_file,plaintext_before);
         return SFBoolState_2;
     }
 
@@ -268,6 +437,8 @@ namespace Crypto_Impl{
             SFBoolState_2 = Compress_Interface("Compress",object_info.source_file);
 
             object_info.source_file = CompressStore/(object_info.source_file.filename().string()+".tar.gz");
+            // The index lists member names in plaintext; it must not outlive the plaintext archive
+            File_TargetGeneral_Clean(Compress_Archive_Index_Path(object_info.source_file));
             SFBoolState_1 = Crypto_Core_File(crypto_type,object_info,nullptr);
             
             if(target_path_output!=nullptr) *target_path_output = object_info.target_folder/(object_info.source_file.filename().string()+".vlt");
@@ -301,6 +472,109 @@ namespace Crypto_Impl{
 };
 
 
+// ===== Watched Drop Folders =====
+// Encrypt one batch handed over by Folder_Watch: a single key derivation, then the files on every hardware thread
+// Each file lands in EncStore/<drop folder name>/<relative folder>/<name>.vlt and its plaintext is removed as by Enc;
+// a file gone by the time its turn comes (already encrypted, or deleted) is skipped
+struct Crypto_Batch_Stats{
+    std::uint64_t files = 0;
+    std::uint64_t failed = 0;
+    double seconds = 0;
+};
+inline Crypto_Batch_Stats Crypto_Batch_Encrypt(const Folder_Watch_Batch& batch,const std::string& password){
+    auto begin = std::chrono::steady_clock::now();
+    Crypto_Batch_Key batch_key(password);
+    std::atomic<std::uint64_t> files = 0, failed = 0;
+    Parallel_Work_Queue<std::size_t> queue;
+    for(std::size_t idx=0; idx<batch.size(); idx++) queue.Push(idx);
+    queue.Run(Parallel_Worker_Count(),[&](std::size_t& idx){
+        const Folder_Watch_Item& item = batch[idx];
+        std::error_code ec;
+        if(!std::filesystem::is_regular_file(std::filesystem::symlink_status(item.file,ec))) return;
+        std::filesystem::path target_folder = EncStore/item.root.filename()/item.file.parent_path().lexically_relative(item.root);
+        bool SFBoolState = Crypto_Impl::Crypto_Core_File(Crypto_Type::Enc,
+            Crypto_Impl::Crypto_Operate_Info{target_folder.lexically_normal(),item.file,password,true,&batch_key},nullptr);
+        if(SFBoolState) files++;
+        else failed++;
+    });
+    return Crypto_Batch_Stats{files,failed,std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count()};
+}
+
+// ===== Marked Selection Batches =====
+// One job over the entries marked in the file manager: folders are expanded into per-file tasks first,
+// then every file runs on a single worker pool. Enc derives one key for the batch, Dec one key per distinct salt
+// Targets follow Enc/Dec (<store>/<name>.vlt, <store>/<folder>/<relative>); an entry's source is removed once
+// all of its files succeeded, otherwise only the outputs written for that entry are removed
+// workers = 0 uses every hardware thread
+inline File_Batch_Result File_Batch_Run(const File_Batch_Action action,const std::vector<std::filesystem::path>& targets,const std::string& password,const unsigned workers){
+    auto begin = std::chrono::steady_clock::now();
+    struct Batch_Task{
+        std::size_t target;
+        std::filesystem::path source;
+        std::filesystem::path target_folder;
+        std::filesystem::path output;
+    };
+    std::vector<Batch_Task> tasks;
+    std::vector<std::uint64_t> failed_files(targets.size(),0);
+    std::filesystem::path store = action==File_Batch_Action::Encrypt ? EncStore : DecStore;
+    for(std::size_t idx=0; idx<targets.size(); idx++){
+        std::error_code ec;
+        if(action==File_Batch_Action::Compress||!std::filesystem::is_directory(targets[idx],ec)){
+            tasks.push_back(Batch_Task{idx,targets[idx],store,{}});
+            continue;
+        }
+        std::filesystem::path target_base_folder = store/targets[idx].filename();
+        File_StoreFolder_Create(target_base_folder);
+        for(auto it = std::filesystem::recursive_directory_iterator(targets[idx],ec); !ec&&it!=std::filesystem::recursive_directory_iterator(); it.increment(ec)){
+            std::filesystem::path target_position = target_base_folder/it->path().lexically_relative(targets[idx]);
+            if(it->is_directory(ec)) File_StoreFolder_Create(target_position);
+            else tasks.push_back(Batch_Task{idx,it->path(),target_position.parent_path(),{}});
+        }
+        if(ec) failed_files[idx]++;
+    }
+
+    // Derived only after the walk, so an unreadable selection costs no Argon2 run
+    std::unique_ptr<Crypto_Batch_Key> batch_key;
+    std::unique_ptr<Crypto_Key_Cache> key_cache;
+    if(action==File_Batch_Action::Encrypt&&!tasks.empty()) batch_key = std::make_unique<Crypto_Batch_Key>(password);
+    if(action==File_Batch_Action::Decrypt) key_cache = std::make_unique<Crypto_Key_Cache>(password);
+    std::vector<std::atomic<std::uint64_t>> failed_tasks(targets.size());
+    // Compress writes CompressStore/<name>.tar.gz: entries of one name run one after another; every crypto task
+    // has its own source file, so each is a group of its own
+    Parallel_Keyed_Run(tasks.size(),workers,
+        [&](const std::size_t idx){
+            return action==File_Batch_Action::Compress ? Compress_Store_Name(tasks[idx].source) : tasks[idx].source.string();
+        },
+        [&](const std::size_t idx){
+            Batch_Task& task = tasks[idx];
+            bool SFBoolState;
+            if(action==File_Batch_Action::Compress) SFBoolState = Compress_Interface("Compress",task.source);
+            else SFBoolState = Crypto_Impl::Crypto_Core_File(action==File_Batch_Action::Encrypt ? Crypto_Type::Enc : Crypto_Type::Dec,
+                Crypto_Impl::Crypto_Operate_Info{task.target_folder,task.source,password,false,batch_key.get(),key_cache.get()},&task.output);
+            if(!SFBoolState) failed_tasks[task.target]++;
+        });
+
+    File_Batch_Result result;
+    std::vector<std::filesystem::path> sources_done;
+    for(std::size_t idx=0; idx<targets.size(); idx++){
+        bool target_failed = failed_files[idx]+failed_tasks[idx]!=0;
+        result.target_failed.push_back(target_failed);
+        if(!target_failed){
+            result.done++;
+            sources_done.push_back(targets[idx]);
+        }else result.failed++;
+    }
+    if(action==File_Batch_Action::Encrypt&&DecStore_AutoWipe) File_Wipe_Parallel(sources_done);
+    else if(action!=File_Batch_Action::Compress&&!sources_done.empty()) File_Remove_Parallel(sources_done);
+    for(const auto& task: tasks){
+        if(failed_files[task.target]+failed_tasks[task.target]==0||task.output.empty()) continue;
+        if(action==File_Batch_Action::Decrypt) Crypto_Plaintext_Clean(task.output);
+        else File_TargetGeneral_Clean(task.output);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+    return result;
+}
+
 // ===== Main Crypto Interface =====
 // Public interface for all crypto operations
 // Modes: Enc, Dec, Tmp (edit), TarEnc (compress+encrypt), TarDec, TarTmp
@@ -1,7 +1,9 @@
 
 #include "GeneralFileOper.hpp"
 #include "TuiFileManager.hpp"
+#include "TuiRender.hpp"
 #include "Shell.hpp"
+#include "PathCompletion.hpp"
 #include "Core.hpp"
 #include "Compress.hpp"
 #include <ncursesw/ncurses.h>
@@ -15,7 +17,7 @@
 #define Main_Menu 4
 #define Crypto_Menu_Num 6
 #define Shell_Menu_Num 2
-#define Tar_Menu_Num 2
+#define Tar_Menu_Num 6
 // ===== Terminal Screen Texts =====
 std::string TUI_Title = "Security File Manager Tool";
 const std::string Menu[Main_Menu] = {
@@ -39,6 +41,10 @@ const std::string Shell_Menu[Shell_Menu_Num] = {
 const std::string Tar_Menu[Tar_Menu_Num] = {
     "Tar Compress",
     "Tar Decompress",
+    "Tar List",
+    "Tar Extract Member",
+    "Dict Compress",
+    "Dict Decompress",
 };
 enum class Menu_Option {Main,Crypto,Shell,Tar,};
 const std::string* Menu_Array_Match[] = {Menu,Crypto_Menu,Shell_Menu,Tar_Menu,};
@@ -74,6 +80,16 @@ std::optional<std::filesystem::path> TUI_KidWin_InPath() {
             return std::nullopt;
         }
         if(wch==ENTER) break;
+        // Tab completes the last path component (same index as the shell); the bell when it cannot grow
+        if(result==OK&&wch==L'\t'){
+            std::string typed = String_WString_TO_UTF8(raw_path);
+            Path_Completion_Result completion = Path_Completion_Index::instance().Complete(std::filesystem::current_path(),typed);
+            if(completion.common.size()>typed.size()){
+                raw_path = String_UTF8_TO_WString(completion.common);
+                tmp_len = raw_path.size();
+            }else Terminal_Error_Ring();
+            continue;
+        }
         if(wch==KEY_BACKSPACE){
             if(tmp_len!=0) {
                 tmp_len--;
@@ -91,30 +107,23 @@ std::optional<std::filesystem::path> TUI_KidWin_InPath() {
     auto [target_path,ec] = Input_Path_Check_Abs(raw_path);
     return ec ? std::nullopt : std::optional<std::filesystem::path>{target_path};
 }
-std::string TUI_KidWin_inPwd() {
-    auto hide_password = [](int for_time){
-        std::string show_string = "$Password$";
-        for(int i=0;i<for_time;i++)
-            show_string+="*";
-        return show_string;
-    };
-
-    std::string raw_pwd="";
+std::string TUI_KidWin_InMember() {
+    std::wstring raw_member=L"";
     int win_height = 1, win_pos = LINES - 1;
     WINDOW* win = TUI_KidWin_Components::KidWin_Create(win_height,COLS,win_pos,0);
     WINDOW* backup = TUI_KidWin_Components::KidWin_Backup_LastLine(stdscr,win_pos);
-    
-    int tmp_len = raw_pwd.size();
+
+    int tmp_len = raw_member.size();
     while(true){
         werase(win);
-        std::string show_string = hide_password(tmp_len);
-        mvwaddstr(win,0,0,show_string.data());
-        mvwaddch(win,0,show_string.size(),' '|A_STANDOUT);
+        std::wstring show_string = L"$Member$"+raw_member;
+        mvwaddwstr(win,0,0,show_string.data());
+        mvwaddch(win,0,WString_Cols_Count(show_string),L' '|A_STANDOUT);
         wrefresh(win);
 
         wint_t wch;
         int result = get_wch(&wch);
-        if(wch==ESC){
+        if(wch==ESC) {
             TUI_KidWin_Components::KidWin_Restore(backup, stdscr);
             TUI_KidWin_Components::KidWin_Destroy(win);
             return "";
@@ -123,34 +132,38 @@ std::string TUI_KidWin_inPwd() {
         if(wch==KEY_BACKSPACE){
             if(tmp_len!=0) {
                 tmp_len--;
-                raw_pwd.pop_back();
+                raw_member.pop_back();
             }
         }
         if(result==OK){
-            raw_pwd+=wch;
+            raw_member+=static_cast<wchar_t>(wch);
             tmp_len++;
         }
     }
     TUI_KidWin_Components::KidWin_Restore(backup, stdscr);
     TUI_KidWin_Components::KidWin_Destroy(win);
-    return raw_pwd;
+    return std::filesystem::path(raw_member).string();
 }
 
 
 void TUI_Title_Draw(const std::string show_str){
-    mvaddstr(0,0,show_str.data()); refresh();
+    if(Terminal_Render_Frame::instance().Row_Begin(0,Render_Row_Hash().Add(show_str).Value()))
+        mvaddstr(0,0,show_str.data());
 }
 void TUI_Menu_Draw(const Screen_Row_Info& scrl,const int for_time,const std::string* menu){
     int scrl_cur_y = scrl.fix+scrl.offset;
     int scrl_bp_idx = scrl.bp-scrl.fix;
     int scrl_cur_idx = scrl_bp_idx+scrl.offset;
 
+    Terminal_Render_Frame& frame = Terminal_Render_Frame::instance();
     for(int idx=scrl_bp_idx; idx<scrl_bp_idx+for_time; idx++){
         int for_offset = idx - scrl_bp_idx;
         std::string entry = menu[idx];
+        if(!frame.Row_Begin(scrl.fix+for_offset,Render_Row_Hash().Add(entry).Add(idx==scrl_cur_idx).Value())) continue;
         mvaddstr(scrl.fix+for_offset,0,entry.data());
         if(idx==scrl_cur_idx){mvaddch(scrl_cur_y,entry.size(),' '|A_STANDOUT);}
     }
+    frame.Rows_Clear_From(scrl.fix+for_time);
 }
 class TUI_Main_Screen_Draw{
     Screen_Row_Info scrl{1,1,0,-1,-1};
@@ -165,7 +178,7 @@ class TUI_Main_Screen_Draw{
         if(scrl_total_To_bp_len<=scrl.vsb) TUI_Menu_Draw(scrl,scrl_total_To_bp_len,Menu_Array_Match[static_cast<int>(current_menu)]);
         else TUI_Menu_Draw(scrl,scrl.vsb,Menu_Array_Match[static_cast<int>(current_menu)]);
 
-        refresh();
+        Terminal_Render_Frame::instance().Frame_Commit(ch);
     }
 
     void Menu_Chain_Map() const {
@@ -211,6 +224,17 @@ class TUI_Main_Screen_Draw{
                 Compress_Interface("Compress",*target_path);
             }else if(scroll_idx==1) {
                 Compress_Interface("Decompress",*target_path);
+            }else if(scroll_idx==2) {
+                auto members = Compress_Archive_List(*target_path);
+                if(members==std::nullopt) { Terminal_Error_Ring(); return; }
+                Terminal_MountCurrentTUI_LaunchNewTUI(File_Less_TextViewer,*members);
+            }else if(scroll_idx==3) {
+                auto member = TUI_KidWin_InMember();
+                if(member==""||!Compress_Archive_Member_Extract(*target_path,member)) Terminal_Error_Ring();
+            }else if(scroll_idx==4) {
+                if(!Compress_Interface("DictCompress",*target_path)) Terminal_Error_Ring();
+            }else if(scroll_idx==5) {
+                if(!Compress_Interface("DictDecompress",*target_path)) Terminal_Error_Ring();
             }else return;
         }
         return;
@@ -226,13 +250,14 @@ public:
         return *this;
     }
     void Main_Graphic_Draw(const int ch) {
-        clear();
+        Terminal_Render_Frame::instance().Frame_Begin();
         TUI_Title_Draw(TUI_Title);
         Menu_Entry_Draw(ch);
         
+        // Menu actions may write to the terminal outside curses: the next frame repaints everything
         if(ch==ENTER){
             Menu_Chain_Map();
-            refresh();
+            Terminal_Render_Frame::Invalidate();
         }
 
     }
@@ -242,28 +267,27 @@ public:
 
 // ===== Terminal Main Event Cycle =====
 inline void TUI_Main_Event_Cycle() {
-    setlocale(LC_ALL, ""); initscr(); noecho(); cbreak(); keypad(stdscr,TRUE); curs_set(0); set_escdelay(25);
+    Terminal_Render_Init();
+    Terminal_Event_Loop events;
 
     TUI_Main_Screen_Draw main_object(Menu_Option::Main);
-    bool screen_size_state = false;
     while (true) {
-        Terminal_Screen_yx_Size initial = Terminal_yx_Size_Monitor();
-        if (!screen_size_state) main_object.Main_Graphic_Draw(KINT);
+        main_object.Main_Graphic_Draw(KINT);
 
-        int ch = getch();
-        if (Terminal_Screen_yx_Size monitor = Terminal_yx_Size_Monitor(); monitor!=initial) {
-            screen_size_state = true; main_object.Main_Graphic_Draw(KINT);
-        }
+        Terminal_Event event = events.Wait();
+        if (event.type!=Terminal_Event_Type::Key) continue;
+        int ch = event.key;
         if (ch==ESC||ch=='q') break;
+        if (ch==KEY_F(12)) Terminal_Render_Frame::instance().Overlay_Toggle();
         if (ch==ENTER||ch==KEY_UP||ch==KEY_DOWN) main_object.Main_Graphic_Draw(ch);
         if(TUI_Main_Screen_Draw::temp_menu!=std::nullopt && ch==ENTER){
             const TUI_Main_Screen_Draw temp_object(*TUI_Main_Screen_Draw::temp_menu);
             main_object = temp_object;
-            TUI_Main_Screen_Draw::temp_menu = std::nullopt; screen_size_state = false;
+            TUI_Main_Screen_Draw::temp_menu = std::nullopt;
         }else if(!TUI_Main_Screen_Draw::menu_chain.empty() && ch==KEY_LEFT){
             const TUI_Main_Screen_Draw temp_object(TUI_Main_Screen_Draw::menu_chain.top());
             main_object = temp_object;
-            TUI_Main_Screen_Draw::menu_chain.pop(); screen_size_state = false;
+            TUI_Main_Screen_Draw::menu_chain.pop();
         }
     }
     endwin();
@@ -0,0 +1,138 @@
+#pragma once
+#include "ParallelTask.hpp"
+#include "TuiRender.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <ncursesw/ncurses.h>
+
+// ===== Terminal Size =====
+// Bring curses to the terminal's current size; false when it did not change
+inline bool Terminal_Resize_Apply(){
+    struct winsize ws{};
+    if(ioctl(STDOUT_FILENO,TIOCGWINSZ,&ws)!=0&&ioctl(STDIN_FILENO,TIOCGWINSZ,&ws)!=0) return false;
+    if(ws.ws_row==0||ws.ws_col==0||(ws.ws_row==LINES&&ws.ws_col==COLS)) return false;
+    resizeterm(ws.ws_row,ws.ws_col);
+    Terminal_Render_Frame::Invalidate();
+    return true;
+}
+// Signals an event loop reads through its signalfd (they stay blocked while it lives)
+inline sigset_t Terminal_Event_Signals(){
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals,SIGWINCH);
+    return signals;
+}
+
+// ===== Terminal Event Loop =====
+// One poll() over stdin, a SIGWINCH signalfd, the background progress eventfd and a timerfd; nothing wakes the
+// process while it is idle (no getch timeout). Keys are drained from curses without blocking, a resize is applied
+// before it is reported, and progress wakeups are rate limited: a ring within PROGRESS_INTERVAL of the last
+// reported one arms the timer and is reported when it fires
+// SIGWINCH is blocked for the loop's lifetime; threads started meanwhile inherit the mask, so none takes it
+enum class Terminal_Event_Type{Key,Resize,Progress};
+struct Terminal_Event{
+    Terminal_Event_Type type;
+    int key = ERR;
+};
+
+class Terminal_Event_Loop{
+    static constexpr auto PROGRESS_INTERVAL = std::chrono::milliseconds(100);
+
+    int signal_fd = -1;
+    int timer_fd = -1;
+    sigset_t mask_before;
+    bool timer_armed = false;
+    std::chrono::steady_clock::time_point progress_last{};
+
+    void Timer_Arm(const std::chrono::nanoseconds delay){
+        itimerspec spec{};
+        spec.it_value.tv_sec = delay.count()/1000000000;
+        spec.it_value.tv_nsec = std::max<long long>(delay.count()%1000000000,1);
+        if(timerfd_settime(timer_fd,0,&spec,nullptr)==0) timer_armed = true;
+    }
+    // A key curses already has (or can read without waiting); ERR when there is none
+    static int Key_Take(){
+        nodelay(stdscr,TRUE);
+        int ch = getch();
+        nodelay(stdscr,FALSE);
+        return ch;
+    }
+    // Report progress now, or leave it to the timer when the last report was too recent
+    bool Progress_Due(){
+        auto now = std::chrono::steady_clock::now();
+        if(now-progress_last>=PROGRESS_INTERVAL){
+            progress_last = now;
+            return true;
+        }
+        if(!timer_armed&&timer_fd>=0) Timer_Arm(PROGRESS_INTERVAL-(now-progress_last));
+        return timer_fd<0;
+    }
+public:
+    Terminal_Event_Loop(){
+        sigset_t signals = Terminal_Event_Signals();
+        pthread_sigmask(SIG_BLOCK,&signals,&mask_before);
+        signal_fd = signalfd(-1,&signals,SFD_NONBLOCK|SFD_CLOEXEC);
+        timer_fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+        // A resize while no loop was listening (e.g. inside a child program) is picked up here
+        Terminal_Resize_Apply();
+    }
+    Terminal_Event_Loop(const Terminal_Event_Loop&) = delete;
+    Terminal_Event_Loop& operator=(const Terminal_Event_Loop&) = delete;
+    ~Terminal_Event_Loop(){
+        if(signal_fd>=0) close(signal_fd);
+        if(timer_fd>=0) close(timer_fd);
+        pthread_sigmask(SIG_SETMASK,&mask_before,nullptr);
+    }
+
+    // Block until something happens
+    Terminal_Event Wait(){
+        while(true){
+            if(int ch = Key_Take(); ch==KEY_RESIZE){
+                // curses noticed a resize itself (the signal reached its handler while a child ran)
+                Terminal_Render_Frame::Invalidate();
+                return Terminal_Event{Terminal_Event_Type::Resize};
+            }else if(ch!=ERR){
+                Terminal_Render_Frame::instance().Input_Mark();
+                return Terminal_Event{Terminal_Event_Type::Key,ch};
+            }
+
+            pollfd fds[4] = {
+                {STDIN_FILENO,POLLIN,0},
+                {signal_fd,POLLIN,0},
+                {Parallel_Progress_Event::instance().Fd(),POLLIN,0},
+                {timer_fd,POLLIN,0},
+            };
+            if(poll(fds,4,-1)<0){
+                if(errno==EINTR) continue;
+                return Terminal_Event{Terminal_Event_Type::Key,getch()};
+            }
+            if(fds[1].revents&POLLIN){
+                signalfd_siginfo info;
+                while(read(signal_fd,&info,sizeof(info))==sizeof(info)){}
+                if(Terminal_Resize_Apply()) return Terminal_Event{Terminal_Event_Type::Resize};
+            }
+            if(fds[3].revents&POLLIN){
+                std::uint64_t expirations;
+                [[maybe_unused]] ssize_t got = read(timer_fd,&expirations,sizeof(expirations));
+                timer_armed = false;
+                progress_last = std::chrono::steady_clock::now();
+                return Terminal_Event{Terminal_Event_Type::Progress};
+            }
+            if(fds[2].revents&POLLIN){
+                Parallel_Progress_Event::instance().Drain();
+                if(Progress_Due()) return Terminal_Event{Terminal_Event_Type::Progress};
+            }
+            // The terminal went away: report a quit key instead of spinning on POLLHUP
+            if(fds[0].revents&(POLLHUP|POLLERR)&&!(fds[0].revents&POLLIN)) return Terminal_Event{Terminal_Event_Type::Key,'q'};
+        }
+    }
+};
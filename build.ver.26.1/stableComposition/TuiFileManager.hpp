@@ -1,29 +1,47 @@
 #pragma once
 #include "GeneralFileOper.hpp"
+#include "FolderListCache.hpp"
+#include "FolderUsageCache.hpp"
+#include "FileEntryView.hpp"
+#include "FileWipe.hpp"
+#include "FileCopy.hpp"
+#include "FileFind.hpp"
+#include "TuiRender.hpp"
+#include "TuiEvent.hpp"
 
 #include <string>
 #include <stack>
 #include <optional>
 #include <filesystem>
 #include <concepts>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
 
 #include <fmt/xchar.h>
 #include <ncursesw/ncurses.h>
 #include <locale.h>
+#include <fnmatch.h>
 
 #define ESC 27
 #define ENTER 10
 
-#define KEYS 12
+#define KEYS 29
 #define KINT -1
 // ===== Key Set =====
 // Valid input key set
 // Check if key is in valid key set
 constexpr int Input_Key_Set[KEYS] = {
     KEY_UP,KEY_DOWN,KEY_LEFT,
-    KEY_F(1),KEY_F(2),
+    KEY_F(1),KEY_F(2),KEY_F(3),KEY_F(12),
     KEY_BACKSPACE,127,8,KEY_DC,
     ENTER,
+    'w','c','x','v','n','s','/',
+    ' ','a','i','+','u','e','d','z',
     'q',ESC,
 };
 constexpr bool Input_Key_Check(const int ch) {
@@ -33,27 +51,25 @@ constexpr bool Input_Key_Check(const int ch) {
     return false;
 }
 
-// ===== Window Size =====
-//Screen size struct and monitor
-struct Terminal_Screen_yx_Size {
-    int Y; int X;
-    bool operator==(const Terminal_Screen_yx_Size & object) const{return Y==object.Y&&X==object.X;}
-    bool operator!=(const Terminal_Screen_yx_Size & object) const{return !(*this==object);}
-};
-inline Terminal_Screen_yx_Size Terminal_yx_Size_Monitor() {
-    int y,x; getmaxyx(stdscr,y,x);
-    return Terminal_Screen_yx_Size{y,x};
-};
-
 // ===== Terminal Utility Functions =====
-// Launch new TUI in child process (mount current TUI state)
+// Launch new TUI in child process (mount current TUI state); it gets the signals the event loop holds back
 // Tuiminal Error Ring (beep and flash)
 template<typename Fn, typename... Args> requires std::invocable<Fn, Args...>
 void Terminal_MountCurrentTUI_LaunchNewTUI(Fn Func_call, Args&&... args){
-    def_prog_mode();
-    endwin();
+    // Called from the shell (curses never started, or left with endwin) there is no screen to put aside
+    bool curses_active = stdscr!=nullptr&&!isendwin();
+    if(curses_active){
+        def_prog_mode();
+        endwin();
+    }
+    sigset_t signals = Terminal_Event_Signals(), mask_before;
+    pthread_sigmask(SIG_UNBLOCK,&signals,&mask_before);
     Func_call(std::forward<Args>(args)...);
+    pthread_sigmask(SIG_SETMASK,&mask_before,nullptr);
+    if(!curses_active) return;
     reset_prog_mode();
+    Terminal_Resize_Apply();
+    Terminal_Render_Frame::Invalidate();
 }
 void Terminal_Error_Ring() { beep(); flash();}
 
@@ -69,8 +85,9 @@ namespace TUI_KidWin_Components{
         delwin(win);
     }
 
+    // The backup sits on the saved line itself, so overwrite() puts it back in place
     WINDOW* KidWin_Backup_LastLine(const WINDOW* target_win, const int starty){
-        WINDOW* backup = newwin(1,COLS,0,0);
+        WINDOW* backup = newwin(1,COLS,starty,0);
         copywin(target_win,backup,starty,0,0,0,0,COLS-1,0);
         return backup;
     }
@@ -81,16 +98,20 @@ namespace TUI_KidWin_Components{
 
 }
 // ===== File Manager TUI =====
-// Draw title bar with current path
+// Draw title bar with current path and listing status (rows go through Terminal_Render_Frame: only changed rows are drawn)
 
 // Scroll information structure
 // Handle scroll events (up/down navigation)
-// Draw file entries with permissions
+// Clamp scroll position to the list size
+// Draw file entries with permissions and sizes (rows in the order of the sorted / filtered view)
 
-// Input dialog for file/folder name (kid window)
+// Input dialog for file/folder name or search pattern (kid window)
 // Create new file or folder
-void TUI_Title_Draw(std::filesystem::path source_path) {
-    mvaddwstr(0,0,source_path.generic_wstring().data()); refresh();
+void TUI_Title_Draw(std::filesystem::path source_path, const std::wstring_view status = L"") {
+    std::wstring title = source_path.generic_wstring();
+    title += status;
+    if (Terminal_Render_Frame::instance().Row_Begin(0,Render_Row_Hash().Add(std::wstring_view(title)).Value()))
+        mvaddwstr(0,0,title.data());
 }
 
 struct Screen_Row_Info {
@@ -114,21 +135,88 @@ void Scroll_Event_Response(Screen_Row_Info& scrl, const int ch) {
         }else Terminal_Error_Ring();
     }
 }
-void File_Entry_Draw(const Screen_Row_Info& scrl,const int for_time, /*vector<path,wstring>*/const auto& Entries) {
+// Keep the cursor inside the list after entries disappeared
+void Scroll_Clamp(Screen_Row_Info& scrl) {
+    int scrl_cur_idx = scrl.bp-scrl.fix+scrl.offset;
+    if (scrl.total<=0) { scrl.bp = scrl.fix; scrl.offset = 0; return; }
+    if (scrl_cur_idx<scrl.total) return;
+    int overflow = scrl_cur_idx-(scrl.total-1);
+    int take_offset = overflow<scrl.offset ? overflow : scrl.offset;
+    scrl.offset -= take_offset;
+    scrl.bp -= overflow-take_offset;
+}
+// Size column: file length, or tree size of a sub-folder once the background worker has it ("...")
+constexpr int SIZE_COLS = 6;
+inline std::string File_Entry_Size_Format(File_Entry_Table& Entries, const std::size_t idx) {
+    if (Entries.Entry_DType(idx)!=DT_DIR) return File_Size_Human(Entries.Entry_Size(idx));
+    auto usage = Entries.Entry_Usage(idx);
+    return usage ? File_Size_Human(*usage) : "...";
+}
+// Marks of one folder level, kept by name so they survive re-sorting, filtering and a reloaded listing
+class File_Entry_Marks {
+    struct Name_Hash {
+        using is_transparent = void;
+        std::size_t operator()(const std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+    std::unordered_set<std::string,Name_Hash,std::equal_to<>> names;
+public:
+    bool Marked(const std::string_view name) const { return names.find(name)!=names.end(); }
+    void Set(const std::string_view name, const bool marked) {
+        if (!marked) { if (auto it = names.find(name); it!=names.end()) names.erase(it); }
+        else if (!Marked(name)) names.emplace(name);
+    }
+    void Toggle(const std::string_view name) { Set(name,!Marked(name)); }
+    void Clear() { names.clear(); }
+    bool empty() const { return names.empty(); }
+    std::size_t size() const { return names.size(); }
+    // Marked entries still in the listing, in listing order
+    std::vector<std::filesystem::path> Paths(const File_Entry_Table& Entries) const {
+        std::vector<std::filesystem::path> paths;
+        for (std::size_t idx=0; idx<Entries.size()&&paths.size()<names.size(); idx++)
+            if (Marked(Entries.Entry_Name(idx))) paths.push_back(Entries.Entry_Path(idx));
+        return paths;
+    }
+};
+void File_Entry_Draw(const Screen_Row_Info& scrl,const int for_time,const File_Entry_View& View,const File_Entry_Marks& Marks) {
+    File_Entry_Table& Entries = View.Table();
     int scrl_cur_y = scrl.fix+scrl.offset;
     int scrl_bp_idx = scrl.bp-scrl.fix;
     int scrl_cur_idx = scrl_bp_idx+scrl.offset;
 
+    // Columns are written straight from the table (short strings stay in SSO, the name is a cached view),
+    // so a redraw allocates nothing once every shown row was decoded; rows that look the same are skipped
+    // Shown rows are stat'ed first, so the Stat phase of the frame is measured apart from drawing
+    {
+        Render_Phase_Timer timer(Render_Phase::Stat);
+        for(int idx=scrl_bp_idx; idx<scrl_bp_idx+for_time; idx++) Entries.Entry_Stat(View.Entry(idx));
+    }
+    Terminal_Render_Frame& frame = Terminal_Render_Frame::instance();
     for(int idx=scrl_bp_idx; idx<scrl_bp_idx+for_time; idx++){
         int for_offset = idx - scrl_bp_idx;
-        std::wstring entry = fmt::format(L"{} {}",String_UTF8_TO_WString(File_Permission_Gain(Entries[idx].filepath)),
-            Entries[idx].filename);
-        mvaddwstr(scrl.fix+for_offset,0,entry.data());
-        if(idx==scrl_cur_idx){mvaddch(scrl_cur_y,WString_Cols_Count(entry),' '|A_STANDOUT);}
+        int row_y = scrl.fix+for_offset;
+        std::size_t entry = View.Entry(idx);
+        std::string perms = File_Permission_Mode_Format(Entries.Entry_Mode(entry));
+        std::string size = File_Entry_Size_Format(Entries,entry);
+        int name_x = perms.size()+1+SIZE_COLS+1;
+        std::wstring_view name = Entries.Entry_WName(entry);
+        bool marked = !Marks.empty()&&Marks.Marked(Entries.Entry_Name(entry));
+        if(!frame.Row_Begin(row_y,Render_Row_Hash().Add(perms).Add(size).Add(name).Add(idx==scrl_cur_idx).Add(marked).Value())) continue;
+        mvaddstr(row_y,0,perms.data());
+        mvaddstr(row_y,name_x-1-size.size(),size.data());
+        if(marked){ mvaddch(row_y,name_x-1,'*'); attron(A_BOLD); }
+        mvaddnwstr(row_y,name_x,name.data(),name.size());
+        if(marked) attroff(A_BOLD);
+        if(idx==scrl_cur_idx){mvaddch(scrl_cur_y,name_x+Entries.Entry_Width(entry),' '|A_STANDOUT);}
     }
+    frame.Rows_Clear_From(scrl.fix+for_time);
 }
 
-std::wstring TUI_KidWin_InStr(std::wstring init_name) {
+// Printable input (search patterns may use glob characters)
+// on_change sees the text after every edit (type-to-filter); Esc reports an empty text to it as well
+inline bool Input_Printable_Char_Check(const int key_code) { return key_code>=32&&key_code!=127; }
+std::wstring TUI_KidWin_InStr(std::wstring init_name, const std::wstring label = L"$Name$",
+    bool (*char_check)(int) = File_Input_FileName_Char_Check,
+    const std::function<void(const std::wstring&)>& on_change = {}) {
     int win_height = 1, win_pos = LINES - 1;
     WINDOW* win = TUI_KidWin_Components::KidWin_Create(win_height,COLS,win_pos,0);
     WINDOW* backup = TUI_KidWin_Components::KidWin_Backup_LastLine(stdscr,win_pos);
@@ -136,7 +224,7 @@ std::wstring TUI_KidWin_InStr(std::wstring init_name) {
     int tmp_len = init_name.size();
     while(true){
         werase(win);
-        std::wstring show_string = L"$Name$"+init_name;
+        std::wstring show_string = label+init_name;
         // int width = std::min{WString_Cols_Count(show_string),COLS-1};
         mvwaddwstr(win,0,0,show_string.data());
         mvwaddch(win,0,WString_Cols_Count(show_string),L' '|A_STANDOUT);
@@ -144,12 +232,15 @@ std::wstring TUI_KidWin_InStr(std::wstring init_name) {
 
         wint_t wch;
         int result = get_wch(&wch);
+        if(result==ERR) continue;
         if(wch==ESC){
+            if(on_change) on_change(L"");
             TUI_KidWin_Components::KidWin_Restore(backup, stdscr);
             TUI_KidWin_Components::KidWin_Destroy(win);
             return L"";
         }
         if(wch==ENTER) break;
+        std::size_t before_len = init_name.size();
         if(wch==KEY_BACKSPACE){
             if(tmp_len!=0) {
                 tmp_len--;
@@ -157,16 +248,63 @@ std::wstring TUI_KidWin_InStr(std::wstring init_name) {
             }
         }
         if(result==OK){
-            if(File_Input_FileName_Char_Check(wch)){
+            if(char_check(wch)){
                 init_name+=static_cast<wchar_t>(wch);
                 tmp_len++;
             }
         }
+        if(on_change&&init_name.size()!=before_len) on_change(init_name);
     }
     TUI_KidWin_Components::KidWin_Restore(backup, stdscr);
     TUI_KidWin_Components::KidWin_Destroy(win);
     return init_name;
 }
+// Masked password input; label lets a second prompt ask for confirmation
+std::string TUI_KidWin_inPwd(const std::string label = "$Password$") {
+    auto hide_password = [&label](int for_time){
+        std::string show_string = label;
+        for(int i=0;i<for_time;i++)
+            show_string+="*";
+        return show_string;
+    };
+
+    std::string raw_pwd="";
+    int win_height = 1, win_pos = LINES - 1;
+    WINDOW* win = TUI_KidWin_Components::KidWin_Create(win_height,COLS,win_pos,0);
+    WINDOW* backup = TUI_KidWin_Components::KidWin_Backup_LastLine(stdscr,win_pos);
+    
+    int tmp_len = raw_pwd.size();
+    while(true){
+        werase(win);
+        std::string show_string = hide_password(tmp_len);
+        mvwaddstr(win,0,0,show_string.data());
+        mvwaddch(win,0,show_string.size(),' '|A_STANDOUT);
+        wrefresh(win);
+
+        wint_t wch;
+        int result = get_wch(&wch);
+        if(result==ERR) continue;
+        if(wch==ESC){
+            TUI_KidWin_Components::KidWin_Restore(backup, stdscr);
+            TUI_KidWin_Components::KidWin_Destroy(win);
+            return "";
+        }
+        if(wch==ENTER) break;
+        if(wch==KEY_BACKSPACE){
+            if(tmp_len!=0) {
+                tmp_len--;
+                raw_pwd.pop_back();
+            }
+        }
+        if(result==OK){
+            raw_pwd+=wch;
+            tmp_len++;
+        }
+    }
+    TUI_KidWin_Components::KidWin_Restore(backup, stdscr);
+    TUI_KidWin_Components::KidWin_Destroy(win);
+    return raw_pwd;
+}
 void TUI_FileCreate(const std::filesystem::path& current_path, const int choice) {
     std::wstring raw_name[] = {L"newFile.txt",L"newFolder.txt"};
     std::wstring target_name = raw_name[choice%2];
@@ -183,32 +321,89 @@ void TUI_FileCreate(const std::filesystem::path& current_path, const int choice)
 //renamed functions ...
 
 
+// ===== Batch Actions =====
+// Encrypt / decrypt / compress the marked entries as one job (defined with the crypto core, Core.hpp)
+enum class File_Batch_Action {Encrypt,Decrypt,Compress};
+struct File_Batch_Result {
+    std::uint64_t done = 0;
+    std::uint64_t failed = 0;
+    double seconds = 0;
+    // Per target, in the order given
+    std::vector<bool> target_failed;
+};
+inline File_Batch_Result File_Batch_Run(const File_Batch_Action action,const std::vector<std::filesystem::path>& targets,const std::string& password,const unsigned workers = 0);
+
+
 // ===== File Manager TUI Draw =====
 class Terminal_File_Manager_Draw {
     Screen_Row_Info scrl{1,1,0,-1,-1};
     std::filesystem::path current_path;
-    
+    // Sorted / filtered rows of the listing; shared by the copies kept in folder_chain
+    std::shared_ptr<File_Entry_View> view = std::make_shared<File_Entry_View>();
+    // Marked entries of this folder level, shared the same way; mark_anchor is the entry Space last toggled
+    std::shared_ptr<File_Entry_Marks> marks = std::make_shared<File_Entry_Marks>();
+    std::string mark_anchor;
+
+    // The view brought up to date with the cached listing and the current sort mode
+    File_Entry_View& View_Refresh() const {
+        view->Refresh(Folder_List_Cache::instance().Folder_List(current_path),sort_mode);
+        return *view;
+    }
+    std::size_t Cursor_Row() const { return scrl.bp-scrl.fix+scrl.offset; }
+    // Put the cursor on a row, centred when the list scrolls
+    void Row_Focus(const std::size_t row) {
+        int vsb = LINES-1;
+        scrl.total = view->size(); scrl.vsb = vsb;
+        scrl.offset = std::min<int>(row,vsb/2);
+        scrl.bp = scrl.fix+row-scrl.offset;
+    }
+
+    // Marked entries, or the one under the cursor when nothing is marked
+    std::vector<std::filesystem::path> Selection_Paths() const {
+        File_Entry_View& View = View_Refresh();
+        if (!marks->empty()) return marks->Paths(View.Table());
+        if (View.empty()) return {};
+        return {View.Table().Entry_Path(View.Entry(Cursor_Row()))};
+    }
+
     // Draw file list with scroll
 
     // Navigate into folder or open file
-    // Delete selected file or folder
+    // Delete the selection (marked entries or the highlighted one)
+    // Securely wipe the selection on one worker pool
+    // Copy/cut selected entry to the clipboard, paste it here under a non-repeating name
+    // Listings come from Folder_List_Cache; the folder is only read again after it changed
+    // Sub-folder sizes are requested from Folder_Usage_Cache once the whole listing is read, and drawn once they arrive
+    // A big folder is drawn while it loads; the scroll total grows as entries land
     void File_Info_Draw(const int ch) {
-        auto Entries = File_Folder_List_Info(current_path);
+        {
+            Render_Phase_Timer timer(Render_Phase::List);
+            auto Entries = Folder_List_Cache::instance().Folder_List(current_path);
+            if (Entries->Load_Done()) Folder_Usage_Cache::instance().Request(Entries);
+            View_Refresh();
+        }
+        File_Entry_View& View = *view;
         
-        scrl.total = Entries.size(); scrl.vsb = LINES-1;
+        scrl.total = View.size(); scrl.vsb = LINES-1;
+        Scroll_Clamp(scrl);
         Scroll_Event_Response(scrl,ch);
 
+        Terminal_Render_Frame& frame = Terminal_Render_Frame::instance();
+        frame.List_Scroll(current_path.native(),scrl.bp-scrl.fix,scrl.fix,scrl.fix+scrl.vsb-1);
         int scrl_total_To_bp_len = scrl.total+(scrl.fix-1)-scrl.bp+1;
-        if(scrl_total_To_bp_len<=scrl.vsb) File_Entry_Draw(scrl,scrl_total_To_bp_len,Entries);
-        else File_Entry_Draw(scrl,scrl.vsb,Entries);
+        if(scrl_total_To_bp_len<=scrl.vsb) File_Entry_Draw(scrl,scrl_total_To_bp_len,View,*marks);
+        else File_Entry_Draw(scrl,scrl.vsb,View,*marks);
 
-        refresh();
+        frame.Frame_Commit(ch);
     }
 
     void File_Chain_Map() const {
-        auto Items = File_Folder_List_Info(current_path);
-        auto [p,n] = Items[scrl.bp-scrl.fix+scrl.offset];
-        if (std::filesystem::is_directory(p)) {
+        File_Entry_View& View = View_Refresh();
+        if (View.empty()) return;
+        std::size_t idx = View.Entry(Cursor_Row());
+        std::filesystem::path p = View.Table().Entry_Path(idx);
+        if (View.Table().Entry_Is_Directory(idx)) {
+            scroll_memory[current_path.string()] = scrl;
             folder_chain.push(*this); temp_folder = p;
         }else {
             Terminal_MountCurrentTUI_LaunchNewTUI(File_Vim_TextCompiler,p);
@@ -216,37 +411,271 @@ class Terminal_File_Manager_Draw {
         }
     }
     void File_Remove() const {
-        auto Items = File_Folder_List_Info(current_path);
-        auto [p,n] = Items[scrl.bp-scrl.fix+scrl.offset];
-        File_TargetGeneral_Clean(p);
+        std::vector<std::filesystem::path> targets = Selection_Paths();
+        if (targets.empty()) return;
+        bool SFBoolState = File_Remove_Parallel(targets);
+        marks->Clear();
+        Folder_List_Cache::instance().Folder_Invalidate(current_path);
+        if (!SFBoolState) Terminal_Error_Ring();
+    }
+    void File_Wipe() const {
+        std::vector<std::filesystem::path> targets = Selection_Paths();
+        if (targets.empty()) return;
+        File_Wipe_Stats stats = File_Wipe_Parallel(targets);
+        marks->Clear();
+        Folder_List_Cache::instance().Folder_Invalidate(current_path);
+        if (stats.failed!=0) Terminal_Error_Ring();
+    }
+    void File_Clipboard_Set(const bool cut) const {
+        File_Entry_View& View = View_Refresh();
+        if (View.empty()) return;
+        clipboard = File_Clipboard{View.Table().Entry_Path(View.Entry(Cursor_Row())),cut};
+    }
+    void File_Paste() const {
+        if (!clipboard) { Terminal_Error_Ring(); return; }
+        std::filesystem::path source = clipboard->source;
+        std::filesystem::path target = File_Non_Repeating_Path(current_path,source.filename().wstring());
+        bool SFBoolState;
+        if (clipboard->cut) {
+            SFBoolState = File_Move_Path(source,target);
+            if (SFBoolState) clipboard = std::nullopt;
+            Folder_List_Cache::instance().Folder_Invalidate(source.parent_path());
+        }else SFBoolState = File_Copy_Parallel(source,target).failed==0;
+        Folder_List_Cache::instance().Folder_Invalidate(current_path);
+        if (!SFBoolState) Terminal_Error_Ring();
     }
 
 public:
     inline static std::stack<Terminal_File_Manager_Draw> folder_chain;
     inline static std::optional<std::filesystem::path> temp_folder = std::nullopt;
-
-    explicit Terminal_File_Manager_Draw(std::filesystem::path file_path): current_path(file_path){}
+    // Last scroll state per folder, restored when the folder is entered again
+    inline static std::unordered_map<std::string,Screen_Row_Info> scroll_memory;
+    // Sort mode shared by every folder level ('s' cycles it)
+    inline static File_Sort_Mode sort_mode = File_Sort_Mode::Directory;
+    // Copy/cut source shared by every folder level
+    struct File_Clipboard { std::filesystem::path source; bool cut; };
+    inline static std::optional<File_Clipboard> clipboard = std::nullopt;
+    // Matches of the last F3 search (sorted), the one currently shown, and the folder (with its folder_chain
+    // depth) the search ran in: every jump starts from there
+    static constexpr std::size_t SEARCH_MAX = 100000;
+    inline static std::vector<std::string> search_matches;
+    inline static std::size_t search_pos = 0;
+    inline static std::filesystem::path search_root;
+    inline static std::size_t search_depth = 0;
+    // Outcome of the last batch action, shown in the title until the next key
+    inline static std::wstring batch_status;
+
+    explicit Terminal_File_Manager_Draw(std::filesystem::path file_path): current_path(file_path){
+        Folder_List_Cache::instance().Folder_Load_Retry(current_path);
+        if(auto it = scroll_memory.find(current_path.string()); it!=scroll_memory.end()) scrl = it->second;
+    }
     Terminal_File_Manager_Draw operator=(const Terminal_File_Manager_Draw & object) {
         if (this==&object) return *this;
         this->current_path = object.current_path;
         this->scrl = object.scrl;
+        this->view = object.view;
+        this->marks = object.marks;
+        this->mark_anchor = object.mark_anchor;
         return *this;
     }
 
+    void Scroll_Remember() const { scroll_memory[current_path.string()] = scrl; }
+    // Escape while the listing loads: keep what was read so far; false when nothing was loading
+    bool Load_Cancel() const { return Folder_List_Cache::instance().Folder_List(current_path)->Load_Cancel(); }
+
+    // Put the cursor on entry `name` of this folder, centred when the list scrolls (waits for the whole listing)
+    void Entry_Focus(const std::string& name) {
+        Folder_List_Cache::instance().Folder_List(current_path)->Load_Wait();
+        File_Entry_View& View = View_Refresh();
+        for (std::size_t idx=0; idx<View.Table().size(); idx++) {
+            if (View.Table().Entry_Name(idx)!=name) continue;
+            if (std::size_t row = View.Row_Of(idx); row<View.size()) Row_Focus(row);
+            return;
+        }
+    }
+    // Next sort mode; the cursor stays on the entry it was on
+    void Sort_Cycle() {
+        File_Entry_View& View = View_Refresh();
+        std::optional<std::size_t> entry;
+        if (Cursor_Row()<View.size()) entry = View.Entry(Cursor_Row());
+        sort_mode = File_Sort_Mode_Next(sort_mode);
+        View_Refresh();
+        if (entry) Row_Focus(View.Row_Of(*entry));
+    }
+    // Type-to-filter: the list narrows on every key, Enter keeps the filter, Esc drops it
+    void Filter_Input() {
+        std::wstring initial = String_UTF8_TO_WString(view->Filter());
+        TUI_KidWin_InStr(initial,L"$Filter$",Input_Printable_Char_Check,[this](const std::wstring& text){
+            View_Refresh().Filter_Set(std::filesystem::path(text).string());
+            scrl.bp = scrl.fix; scrl.offset = 0;
+            Main_Graphic_Draw(KINT);
+        });
+        // The dialog put back the last row as it was before filtering began
+        Terminal_Render_Frame::instance().Row_Forget(LINES-1);
+        Main_Graphic_Draw(KINT);
+    }
+    // Space: toggle the mark under the cursor; true when the cursor can move on to the next row
+    bool Mark_Toggle() {
+        File_Entry_View& View = View_Refresh();
+        if (View.empty()) return false;
+        mark_anchor = View.Table().Entry_Name(View.Entry(Cursor_Row()));
+        marks->Toggle(mark_anchor);
+        return Cursor_Row()+1<View.size();
+    }
+    // 'a': mark every row from the last toggled entry down (or up) to the cursor
+    void Mark_Range() {
+        File_Entry_View& View = View_Refresh();
+        if (View.empty()) return;
+        std::size_t anchor_row = Cursor_Row();
+        for (std::size_t row=0; !mark_anchor.empty()&&row<View.size(); row++)
+            if (View.Table().Entry_Name(View.Entry(row))==mark_anchor) { anchor_row = row; break; }
+        std::size_t first = std::min(anchor_row,Cursor_Row()), last = std::max(anchor_row,Cursor_Row());
+        for (std::size_t row=first; row<=last; row++) marks->Set(View.Table().Entry_Name(View.Entry(row)),true);
+    }
+    // 'i': invert the marks of the shown rows (a filter limits it to what matches)
+    void Mark_Invert() {
+        File_Entry_View& View = View_Refresh();
+        for (std::size_t row=0; row<View.size(); row++) marks->Toggle(View.Table().Entry_Name(View.Entry(row)));
+    }
+    // '+': mark the shown rows matching a glob; plain text matches names containing it, as F3 does
+    void Mark_Glob() {
+        std::wstring pattern = TUI_KidWin_InStr(L"",L"$Mark$",Input_Printable_Char_Check);
+        if (!pattern.empty()) {
+            std::string glob = std::filesystem::path(pattern).string();
+            if (glob.find_first_of("*?[")==std::string::npos) glob = "*"+glob+"*";
+            File_Entry_View& View = View_Refresh();
+            std::string name;
+            for (std::size_t row=0; row<View.size(); row++) {
+                name = View.Table().Entry_Name(View.Entry(row));
+                if (fnmatch(glob.c_str(),name.c_str(),FNM_CASEFOLD)==0) marks->Set(name,true);
+            }
+        }
+        Terminal_Render_Frame::instance().Row_Forget(LINES-1);
+        Main_Graphic_Draw(KINT);
+    }
+    // 'e' / 'd' / 'z': one job over the selection, one password prompt (asked twice before encrypting)
+    void Batch_Action(const File_Batch_Action action) {
+        std::vector<std::filesystem::path> targets = Selection_Paths();
+        std::string password;
+        if (!targets.empty()&&action!=File_Batch_Action::Compress) {
+            password = TUI_KidWin_inPwd();
+            if (!password.empty()&&action==File_Batch_Action::Encrypt&&TUI_KidWin_inPwd("$Again$")!=password) password.clear();
+        }
+        Terminal_Render_Frame::instance().Row_Forget(LINES-1);
+        if (targets.empty()||(password.empty()&&action!=File_Batch_Action::Compress)) {
+            Terminal_Error_Ring(); Main_Graphic_Draw(KINT); return;
+        }
+        batch_status = fmt::format(L"  [working on {}]",targets.size());
+        Main_Graphic_Draw(KINT);
+        File_Batch_Result result = File_Batch_Run(action,targets,password);
+        batch_status = fmt::format(L"  [{} done, {} failed, {:.1f}s]",result.done,result.failed,result.seconds);
+        marks->Clear();
+        Folder_List_Cache::instance().Folder_Invalidate(current_path);
+        if (result.failed!=0) Terminal_Error_Ring();
+        Main_Graphic_Draw(KINT);
+    }
+    // Search below the current folder; plain text matches names containing it, glob characters are used as-is
+    std::optional<std::filesystem::path> File_Search() const {
+        std::wstring pattern = TUI_KidWin_InStr(L"",L"$Find$",Input_Printable_Char_Check);
+        if (pattern.empty()) return std::nullopt;
+        std::string glob = std::filesystem::path(pattern).string();
+        if (glob.find_first_of("*?[")==std::string::npos) glob = "*"+glob+"*";
+        File_Find_Filter filter;
+        filter.name_glob = glob;
+        filter.name_icase = true;
+        search_matches.clear();
+        search_root = current_path;
+        search_depth = folder_chain.size();
+        File_Find_Parallel(current_path,filter,[](const std::string& match){
+            search_matches.push_back(match);
+            return search_matches.size()<SEARCH_MAX;
+        });
+        std::sort(search_matches.begin(),search_matches.end());
+        search_pos = 0;
+        if (search_matches.empty()) return std::nullopt;
+        return search_matches[0];
+    }
+    std::optional<std::filesystem::path> Search_Next() const {
+        if (search_matches.empty()) return std::nullopt;
+        search_pos = (search_pos+1)%search_matches.size();
+        return search_matches[search_pos];
+    }
+    // Back to the search folder (unwinding the levels earlier jumps pushed), then down to the folder holding target,
+    // pushing every level so Left walks back up
+    static void Search_Jump(Terminal_File_Manager_Draw& main_object, const std::filesystem::path& target) {
+        while (folder_chain.size()>search_depth&&main_object.current_path!=search_root) {
+            main_object.Scroll_Remember();
+            main_object = folder_chain.top();
+            folder_chain.pop();
+        }
+        std::filesystem::path relative = target.parent_path().lexically_relative(main_object.current_path);
+        if (relative.empty()||*relative.begin()=="..") {
+            // Left the search folder some other way since: start over from it
+            main_object.Scroll_Remember();
+            const Terminal_File_Manager_Draw root_object(search_root); main_object = root_object;
+            relative = target.parent_path().lexically_relative(search_root);
+            if (relative.empty()||*relative.begin()=="..") { Terminal_Error_Ring(); return; }
+        }
+        for (const auto& part: relative) {
+            if (part==".") continue;
+            main_object.Scroll_Remember();
+            folder_chain.push(main_object);
+            const Terminal_File_Manager_Draw next_object(main_object.current_path/part); main_object = next_object;
+        }
+        main_object.Entry_Focus(target.filename().string());
+    }
+
     // Main drawing function
+    // Listing work (reading, sorting, filtering, marking) is timed as the List phase of the frame
     void Main_Graphic_Draw(const int ch) {
-        clear();
-        TUI_Title_Draw(current_path);
-        File_Info_Draw(ch);
+        if (ch==KEY_F(12)) Terminal_Render_Frame::instance().Overlay_Toggle();
+        Terminal_Render_Frame::instance().Frame_Begin();
+        int scroll_ch = ch;
+        std::shared_ptr<File_Entry_Table> Entries;
+        {
+            Render_Phase_Timer timer(Render_Phase::List);
+            if (ch!=KINT) batch_status.clear();
+            if (ch=='s') Sort_Cycle();
+            else if (ch==' ') scroll_ch = Mark_Toggle() ? KEY_DOWN : KINT;
+            else if (ch=='a') Mark_Range();
+            else if (ch=='i') Mark_Invert();
+            else if (ch=='u') marks->Clear();
+            Entries = Folder_List_Cache::instance().Folder_List(current_path);
+            View_Refresh();
+        }
+        std::wstring status;
+        if (Entries->Loading()) status = fmt::format(L"  [loading {}, Esc stops]",Entries->size());
+        else if (Entries->Load_Cancelled()) status = fmt::format(L"  [stopped at {}]",Entries->size());
+        if (sort_mode!=File_Sort_Mode::Directory) status += fmt::format(L"  [sort: {}]",String_UTF8_TO_WString(File_Sort_Mode_Name(sort_mode)));
+        if (File_Entry_View& View = View_Refresh(); !View.Filter().empty())
+            status += fmt::format(L"  [/{} {}/{}]",String_UTF8_TO_WString(View.Filter()),View.size(),View.Entries_Total());
+        if (!marks->empty()) status += fmt::format(L"  [marked {}]",marks->size());
+        status += batch_status;
+        TUI_Title_Draw(current_path,status);
+        File_Info_Draw(scroll_ch);
 
         if (ch==KEY_F(1)) {
             TUI_FileCreate(current_path,0);
+            Folder_List_Cache::instance().Folder_Invalidate(current_path);
         }else if (ch==KEY_F(2)) {
             TUI_FileCreate(current_path,1);
+            Folder_List_Cache::instance().Folder_Invalidate(current_path);
         }else if (ch==ENTER) {
             File_Chain_Map();
         }else if (ch==8||ch==127||ch==KEY_BACKSPACE||ch==KEY_DC) {
             File_Remove();
+        }else if (ch=='w') {
+            File_Wipe();
+        }else if (ch=='c'||ch=='x') {
+            File_Clipboard_Set(ch=='x');
+        }else if (ch=='v') {
+            File_Paste();
+        }else if (ch=='/') {
+            Filter_Input();
+        }else if (ch=='+') {
+            Mark_Glob();
+        }else if (ch=='e'||ch=='d'||ch=='z') {
+            Batch_Action(ch=='e' ? File_Batch_Action::Encrypt : ch=='d' ? File_Batch_Action::Decrypt : File_Batch_Action::Compress);
         }
     }
 };
@@ -254,38 +683,60 @@ public:
 
 // ===== File Manager Event Loop =====
 // Main event cycle for file manager TUI
+// Sleeps in Terminal_Event_Loop: keys, resizes and background progress (sizes computed, entries read) each wake it
 inline void Terminal_Screen_Event_Cycle(std::filesystem::path source_path){
-    setlocale(LC_ALL,""); initscr(); noecho(); cbreak(); keypad(stdscr,TRUE); curs_set(0); set_escdelay(25);
+    Terminal_Render_Init();
+    Terminal_Event_Loop events;
 
     Terminal_File_Manager_Draw main_object(source_path);
     
-    bool screen_size_state = false;
+    std::uint64_t usage_seen = Folder_Usage_Cache::instance().Generation();
+    std::uint64_t load_seen = File_Entry_Table::Load_Generation();
+    bool redraw = true;
     while(true){
-        Terminal_Screen_yx_Size initial = Terminal_yx_Size_Monitor();
-        if (!screen_size_state) main_object.Main_Graphic_Draw(KINT);
-
-        int ch = getch();
-        if (auto monitor = Terminal_yx_Size_Monitor(); monitor!=initial) {
-            screen_size_state = true; main_object.Main_Graphic_Draw(KINT);
+        if (redraw) main_object.Main_Graphic_Draw(KINT);
+        redraw = true;
+
+        Terminal_Event event = events.Wait();
+        if (event.type==Terminal_Event_Type::Progress) {
+            auto generation = Folder_Usage_Cache::instance().Generation();
+            auto load_generation = File_Entry_Table::Load_Generation();
+            redraw = generation!=usage_seen||load_generation!=load_seen;
+            usage_seen = generation; load_seen = load_generation;
+            continue;
         }
+        if (event.type==Terminal_Event_Type::Resize) continue;
+        int ch = event.key;
 
-        if (!Input_Key_Check(ch)) continue;
+        if (!Input_Key_Check(ch)) { redraw = false; continue; }
+        if(ch==ESC&&main_object.Load_Cancel()) continue;
         if(ch==ESC||ch=='q') break;
         
         if (ch==8||ch==127||ch==KEY_BACKSPACE||ch==KEY_DC
-            ||ch==KEY_UP||ch==KEY_DOWN||ch==ENTER||ch==KEY_F(1)||ch==KEY_F(2)) {
+            ||ch==KEY_UP||ch==KEY_DOWN||ch==ENTER||ch==KEY_F(1)||ch==KEY_F(2)
+            ||ch=='w'||ch=='c'||ch=='x'||ch=='v'||ch=='s'||ch=='/'
+            ||ch==' '||ch=='a'||ch=='i'||ch=='+'||ch=='u'||ch=='e'||ch=='d'||ch=='z'||ch==KEY_F(12)) {
             main_object.Main_Graphic_Draw(ch);
         }
 
         if(Terminal_File_Manager_Draw::temp_folder!=std::nullopt && std::filesystem::exists(*(Terminal_File_Manager_Draw::temp_folder)) && ch==ENTER){
             const Terminal_File_Manager_Draw temp_object(*(Terminal_File_Manager_Draw::temp_folder)); main_object = temp_object;
-            Terminal_File_Manager_Draw::temp_folder = std::nullopt; screen_size_state = false;
+            Terminal_File_Manager_Draw::temp_folder = std::nullopt;
         }
         
+        if(ch==KEY_F(3)||ch=='n'){
+            auto match = ch==KEY_F(3) ? main_object.File_Search() : main_object.Search_Next();
+            if(match){
+                Terminal_File_Manager_Draw::Search_Jump(main_object,*match);
+                main_object.Main_Graphic_Draw(KINT);
+            }else Terminal_Error_Ring();
+        }
+
         if(ch==KEY_LEFT){
             if(!Terminal_File_Manager_Draw::folder_chain.empty()){
+                main_object.Scroll_Remember();
                 main_object =  Terminal_File_Manager_Draw::folder_chain.top(); 
-                Terminal_File_Manager_Draw::folder_chain.pop(); screen_size_state = false;
+                Terminal_File_Manager_Draw::folder_chain.pop();
             }
         }
     }
@@ -0,0 +1,290 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <ncursesw/ncurses.h>
+#include <locale.h>
+
+// ===== Screen Setup =====
+// Terminal modes shared by every TUI; idlok lets ncurses scroll with the terminal's scroll region
+// Safe to call again from a nested TUI (initscr only initialises once)
+inline void Terminal_Render_Init(){
+    setlocale(LC_ALL,""); initscr(); noecho(); cbreak(); keypad(stdscr,TRUE); curs_set(0); set_escdelay(25);
+    idlok(stdscr,TRUE);
+}
+
+// ===== Row Signature =====
+// FNV-1a over everything a row shows; odd values only, so a signature never equals a model marker
+class Render_Row_Hash{
+    std::uint64_t state = 1469598103934665603ull;
+    void Bytes_Add(const void* data, const std::size_t size){
+        const auto* ptr = static_cast<const unsigned char*>(data);
+        for(std::size_t idx=0; idx<size; idx++){ state ^= ptr[idx]; state *= 1099511628211ull; }
+        state ^= 0xFF; state *= 1099511628211ull;
+    }
+public:
+    Render_Row_Hash& Add(const std::string_view text){ Bytes_Add(text.data(),text.size()); return *this; }
+    Render_Row_Hash& Add(const std::wstring_view text){ Bytes_Add(text.data(),text.size()*sizeof(wchar_t)); return *this; }
+    Render_Row_Hash& Add(const long long value){ Bytes_Add(&value,sizeof(value)); return *this; }
+    std::uint64_t Value() const { return state|1; }
+};
+
+// ===== Render Instrumentation =====
+// SECURITY_TOOL_RENDER_LOG=<file>: every frame appends one line there, and a p50/p99 summary every SUMMARY_FRAMES
+// F12 toggles an overlay on the bottom row with the last frame and the rolling percentiles
+// Per frame: latency from the key (Input_Mark) or from Frame_Begin to the end of doupdate, split into listing,
+// stat and drawing (the rest); read/write syscalls and bytes written by the UI thread (/proc/thread-self/io)
+// Nothing is timed or read while both are off
+enum class Render_Phase{List,Stat};
+struct Terminal_Render_Stats{
+    std::uint64_t frames = 0;
+    int rows_drawn = 0;
+    std::uint64_t bytes_last = 0;
+    std::uint64_t bytes_total = 0;
+    std::uint64_t syscalls_last = 0;
+    std::int64_t latency_us = 0;
+    std::int64_t list_us = 0;
+    std::int64_t stat_us = 0;
+    std::int64_t draw_us = 0;
+};
+struct Thread_IO_Counters{
+    std::uint64_t bytes_written = 0;
+    std::uint64_t syscalls = 0;
+};
+// The calling thread's I/O counters; syscalls are the read/write class ones (syscr+syscw), this read included
+inline Thread_IO_Counters Thread_IO_Read(){
+    Thread_IO_Counters counters;
+    int fd = open("/proc/thread-self/io",O_RDONLY|O_CLOEXEC);
+    if(fd<0) return counters;
+    char buf[512];
+    ssize_t len = read(fd,buf,sizeof(buf)-1);
+    close(fd);
+    if(len<=0) return counters;
+    buf[len] = '\0';
+    auto Field = [&buf](const char* name)->std::uint64_t{
+        const char* field = std::strstr(buf,name);
+        return field!=nullptr ? std::strtoull(field+std::strlen(name),nullptr,10) : 0;
+    };
+    counters.bytes_written = Field("wchar:");
+    counters.syscalls = Field("syscr:")+Field("syscw:");
+    return counters;
+}
+
+// ===== Differential Rendering =====
+// Model of the previous frame: one signature per screen row. A draw pass offers every row to Row_Begin,
+// which clears and hands back only rows whose content changed (a cursor move redraws two rows);
+// nothing is erased up front, and doupdate() sends just the cells ncurses finds different
+// A list scrolled by a few entries is shifted with wscrl inside its region (terminal scroll region) and only
+// the rows it exposes are drawn. Whoever else draws on the terminal (child programs) calls Invalidate()
+class Terminal_Render_Frame{
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::uint64_t ROW_BLANK = 0;
+    static constexpr std::uint64_t ROW_UNKNOWN = 2;
+    static constexpr std::size_t LATENCY_WINDOW = 512;
+    static constexpr std::uint64_t SUMMARY_FRAMES = 100;
+    inline static std::uint64_t invalidations = 0;
+
+    std::vector<std::uint64_t> rows;
+    int cols = 0;
+    std::uint64_t invalidations_seen = 0;
+    std::string list_shown;
+    int list_first = 0;
+    Terminal_Render_Stats stats;
+    Terminal_Render_Stats stats_last;
+    FILE* log_file = nullptr;
+
+    bool overlay = false;
+    bool measuring = false;
+    std::uint64_t overlay_shown = ROW_UNKNOWN;
+    Clock::time_point frame_begin;
+    Clock::time_point input_time;
+    bool input_pending = false;
+    Thread_IO_Counters io_begin;
+    std::int64_t phase_us[2] = {0,0};
+    std::array<std::int64_t,LATENCY_WINDOW> latency_window{};
+    std::size_t latency_count = 0;
+
+    Terminal_Render_Frame(){
+        if(const char* env = std::getenv("SECURITY_TOOL_RENDER_LOG"); env!=nullptr&&*env!='\0')
+            log_file = std::fopen(env,"a");
+    }
+    ~Terminal_Render_Frame(){
+        if(log_file==nullptr) return;
+        Summary_Log();
+        std::fclose(log_file);
+    }
+    bool Overlay_Row(const int y) const { return overlay&&y==static_cast<int>(rows.size())-1; }
+    void Summary_Log(){
+        if(latency_count==0) return;
+        std::fprintf(log_file,"summary frames %llu p50_us %lld p99_us %lld max_us %lld\n",static_cast<unsigned long long>(stats.frames),
+            static_cast<long long>(Latency_Percentile(50)),static_cast<long long>(Latency_Percentile(99)),static_cast<long long>(Latency_Percentile(100)));
+    }
+    // Bottom row: the previous frame's numbers (this one is measured only once doupdate returns)
+    void Overlay_Draw(){
+        char text[256];
+        std::snprintf(text,sizeof(text)," frame %llu %.2fms (list %.2f stat %.2f draw %.2f) rows %d sys %llu bytes %llu | p50 %.2f p99 %.2f ms ",
+            static_cast<unsigned long long>(stats_last.frames),stats_last.latency_us/1000.0,stats_last.list_us/1000.0,stats_last.stat_us/1000.0,
+            stats_last.draw_us/1000.0,stats_last.rows_drawn,static_cast<unsigned long long>(stats_last.syscalls_last),
+            static_cast<unsigned long long>(stats_last.bytes_last),
+            Latency_Percentile(50)/1000.0,Latency_Percentile(99)/1000.0);
+        std::uint64_t signature = Render_Row_Hash().Add(std::string_view(text)).Add(static_cast<long long>(cols)).Value();
+        if(overlay_shown==signature) return;
+        overlay_shown = signature;
+        move(rows.size()-1,0); clrtoeol();
+        attron(A_REVERSE); addnstr(text,std::max(cols-1,0)); attroff(A_REVERSE);
+    }
+    void Frame_Measure(const int key){
+        auto now = Clock::now();
+        Thread_IO_Counters io_end = Thread_IO_Read();
+        stats.latency_us = std::chrono::duration_cast<std::chrono::microseconds>(now-(input_pending ? input_time : frame_begin)).count();
+        input_pending = false;
+        stats.list_us = phase_us[0]; stats.stat_us = phase_us[1];
+        stats.draw_us = std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now-frame_begin).count()-stats.list_us-stats.stat_us,0);
+        stats.bytes_last = io_end.bytes_written-io_begin.bytes_written;
+        stats.bytes_total += stats.bytes_last;
+        // Minus the read of /proc that took the second sample
+        stats.syscalls_last = io_end.syscalls-io_begin.syscalls-(io_end.syscalls>io_begin.syscalls ? 1 : 0);
+        latency_window[latency_count%LATENCY_WINDOW] = stats.latency_us;
+        latency_count++;
+        stats_last = stats;
+        if(log_file==nullptr) return;
+        std::fprintf(log_file,"frame %llu key %d rows %d bytes %llu syscalls %llu latency_us %lld list_us %lld stat_us %lld draw_us %lld\n",
+            static_cast<unsigned long long>(stats.frames),key,stats.rows_drawn,static_cast<unsigned long long>(stats.bytes_last),
+            static_cast<unsigned long long>(stats.syscalls_last),static_cast<long long>(stats.latency_us),
+            static_cast<long long>(stats.list_us),static_cast<long long>(stats.stat_us),static_cast<long long>(stats.draw_us));
+        if(stats.frames%SUMMARY_FRAMES==0) Summary_Log();
+        std::fflush(log_file);
+    }
+public:
+    Terminal_Render_Frame(const Terminal_Render_Frame&) = delete;
+    Terminal_Render_Frame& operator=(const Terminal_Render_Frame&) = delete;
+
+    static Terminal_Render_Frame& instance(){
+        static Terminal_Render_Frame render_frame;
+        return render_frame;
+    }
+    // The screen no longer shows the model (another program used the terminal): repaint everything next frame
+    static void Invalidate(){
+        invalidations++;
+        clearok(curscr,TRUE);
+    }
+
+    bool Enabled() const { return log_file!=nullptr||overlay; }
+    // F12: show or hide the overlay; the row under it is drawn again by the next frame
+    void Overlay_Toggle(){
+        overlay = !overlay;
+        overlay_shown = ROW_UNKNOWN;
+        if(!rows.empty()) rows.back() = ROW_UNKNOWN;
+    }
+    // A key was read: the next commit measures its latency from now
+    void Input_Mark(){
+        if(!Enabled()) return;
+        input_time = Clock::now();
+        input_pending = true;
+    }
+    void Phase_Add(const Render_Phase phase, const Clock::duration spent){
+        phase_us[static_cast<int>(phase)] += std::chrono::duration_cast<std::chrono::microseconds>(spent).count();
+    }
+    // p-th percentile of the last LATENCY_WINDOW frame latencies (microseconds)
+    std::int64_t Latency_Percentile(const int percent) const {
+        std::size_t count = std::min(latency_count,LATENCY_WINDOW);
+        if(count==0) return 0;
+        std::array<std::int64_t,LATENCY_WINDOW> sorted = latency_window;
+        std::size_t nth = std::min(count-1,count*percent/100);
+        std::nth_element(sorted.begin(),sorted.begin()+nth,sorted.begin()+count);
+        return sorted[nth];
+    }
+
+    // Start a frame; the model is dropped after a resize or an Invalidate()
+    void Frame_Begin(){
+        if(static_cast<int>(rows.size())!=LINES||cols!=COLS||invalidations_seen!=invalidations){
+            rows.assign(LINES,ROW_UNKNOWN);
+            cols = COLS;
+            invalidations_seen = invalidations;
+            list_shown.clear();
+            overlay_shown = ROW_UNKNOWN;
+        }
+        stats.rows_drawn = 0;
+        measuring = Enabled();
+        if(!measuring) return;
+        frame_begin = Clock::now();
+        phase_us[0] = phase_us[1] = 0;
+        io_begin = Thread_IO_Read();
+    }
+    // True when row y has to be drawn (it is cleared and the cursor put at its start); the overlay row is never handed out
+    bool Row_Begin(const int y, const std::uint64_t signature){
+        if(y<0||y>=static_cast<int>(rows.size())||rows[y]==signature||Overlay_Row(y)) return false;
+        rows[y] = signature;
+        move(y,0); clrtoeol();
+        stats.rows_drawn++;
+        return true;
+    }
+    // Row y was drawn over behind the model's back (a dialog restoring its backup): draw it again next frame
+    void Row_Forget(const int y){
+        if(y>=0&&y<static_cast<int>(rows.size())) rows[y] = ROW_UNKNOWN;
+    }
+    // Blank the rows from y down that still show something
+    void Rows_Clear_From(int y){
+        for(y=std::max(y,0); y<static_cast<int>(rows.size()); y++){
+            if(rows[y]==ROW_BLANK||Overlay_Row(y)) continue;
+            rows[y] = ROW_BLANK;
+            move(y,0); clrtoeol();
+            stats.rows_drawn++;
+        }
+    }
+    // list_id shows entries from first on rows [top,bottom]; when the same list moved by less than a page,
+    // shift what is on screen instead of drawing every row again
+    void List_Scroll(const std::string_view list_id, const int first, const int top, const int bottom){
+        int lines = first-list_first;
+        bool same_list = list_shown==list_id;
+        list_shown = list_id; list_first = first;
+        if(!same_list||lines==0||std::abs(lines)>bottom-top||top<0||bottom>=static_cast<int>(rows.size())||overlay) return;
+        for(int y=top; y<=bottom; y++) if(rows[y]==ROW_UNKNOWN) return;
+
+        scrollok(stdscr,TRUE); setscrreg(top,bottom);
+        wscrl(stdscr,lines);
+        setscrreg(0,LINES-1); scrollok(stdscr,FALSE);
+        if(lines>0){
+            for(int y=top; y<=bottom; y++) rows[y] = y+lines<=bottom ? rows[y+lines] : ROW_BLANK;
+        }else{
+            for(int y=bottom; y>=top; y--) rows[y] = y+lines>=top ? rows[y+lines] : ROW_BLANK;
+        }
+    }
+    // Send the frame in one doupdate(); key is only used for the log
+    void Frame_Commit(const int key){
+        if(overlay) Overlay_Draw();
+        wnoutrefresh(stdscr);
+        stats.frames++;
+        doupdate();
+        if(measuring) Frame_Measure(key);
+        measuring = false;
+    }
+    const Terminal_Render_Stats& Stats() const { return stats; }
+};
+
+// Time spent in one phase of the current frame (nothing is measured while instrumentation is off)
+class Render_Phase_Timer{
+    Render_Phase phase;
+    bool enabled;
+    std::chrono::steady_clock::time_point begin;
+public:
+    explicit Render_Phase_Timer(const Render_Phase _phase)
+        : phase(_phase), enabled(Terminal_Render_Frame::instance().Enabled()) {
+        if(enabled) begin = std::chrono::steady_clock::now();
+    }
+    Render_Phase_Timer(const Render_Phase_Timer&) = delete;
+    Render_Phase_Timer& operator=(const Render_Phase_Timer&) = delete;
+    ~Render_Phase_Timer(){
+        if(enabled) Terminal_Render_Frame::instance().Phase_Add(phase,std::chrono::steady_clock::now()-begin);
+    }
+};
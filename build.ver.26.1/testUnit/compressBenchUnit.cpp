@@ -0,0 +1,80 @@
+// Benchmark: indexed tar.gz (Compress) vs zstd dictionary pack (DictCompress) on a small-file tree
+// Build: g++-12 -std=c++20 -I.. -I../stableComposition compressBenchUnit.cpp -lz -lzstd -lfmt -pthread -o compressBench
+// Usage: ./compressBench [source_folder]   (without argument a synthetic config/log tree is generated)
+#include "../stableComposition/Compress.hpp"
+#include <fmt/core.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+std::filesystem::path make_corpus(const std::filesystem::path root, const int file_count) {
+    std::mt19937 rng(26);
+    const std::vector<std::string> keys = {"listen_port","worker_threads","log_level","upstream_host","timeout_ms",
+        "retry_limit","tls_certificate","cache_size","allowed_origin","health_check_path"};
+    File_StoreFolder_Create(root);
+    for(int i=0; i<file_count; i++){
+        std::filesystem::path folder = root/fmt::format("service_{:03}",i%200);
+        File_StoreFolder_Create(folder);
+        std::ofstream ofs(folder/fmt::format("node_{:05}.conf",i));
+        int sections = 4+rng()%20;
+        for(int sec=0; sec<sections; sec++){
+            ofs<<fmt::format("[{}]\n",keys[(i+sec)%keys.size()]);
+            for(const auto& key: keys)
+                ofs<<fmt::format("{} = {}  # {}\n",key,(rng()%8)*1024,sec%3==0 ? "managed by deploy pipeline" : "default");
+        }
+    }
+    return root;
+}
+
+double time_ms(const std::function<bool()>& task, bool& state) {
+    auto begin = std::chrono::steady_clock::now();
+    state = task();
+    return std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-begin).count();
+}
+
+int main(int argc, char** argv) {
+    std::filesystem::path source = argc>1 ? std::filesystem::absolute(argv[1])
+        : make_corpus(std::filesystem::current_path()/"bench_corpus",20000);
+    std::string name = source.filename().string();
+    std::filesystem::path archive = CompressStore/(name+".tar.gz");
+    std::filesystem::path pack = CompressStore/(name+".zpack");
+
+    std::vector<std::string> members;
+    for(const auto& entry: std::filesystem::recursive_directory_iterator(source))
+        if(entry.is_regular_file()) members.push_back((name/entry.path().lexically_relative(source)).string());
+    std::uintmax_t raw_size = 0;
+    for(const auto& member: members) raw_size += std::filesystem::file_size(source.parent_path()/member);
+
+    bool s1,s2,s3,s4,s5,s6;
+    double gz_create = time_ms([&]{return Compress_Interface("Compress",source);},s1);
+    double zd_create = time_ms([&]{return Compress_Interface("DictCompress",source);},s2);
+    File_TargetFolder_Clean(DecompressStore/name);
+    double gz_extract = time_ms([&]{return Compress_Interface("Decompress",archive);},s3);
+    File_TargetFolder_Clean(DecompressStore/name);
+    double zd_extract = time_ms([&]{return Compress_Interface("DictDecompress",pack);},s4);
+    File_TargetFolder_Clean(DecompressStore/name);
+
+    const int picks = 50;
+    std::mt19937 rng(50);
+    std::vector<std::string> sample;
+    for(int i=0; i<picks; i++) sample.push_back(members[rng()%members.size()]);
+    double gz_member = time_ms([&]{ for(const auto& m: sample) if(!Compress_Archive_Member_Extract(archive,m)) return false; return true; },s5);
+    double zd_member = time_ms([&]{ for(const auto& m: sample) if(!Compress_Dict_Member_Extract(pack,m)) return false; return true; },s6);
+    File_TargetFolder_Clean(DecompressStore/name);
+
+    // Both sides as needed for single-member access: the tar.gz counts with its .idx sidecar, the pack holds its index
+    std::uintmax_t gz_bytes = std::filesystem::file_size(archive)+std::filesystem::file_size(Compress_Archive_Index_Path(archive));
+    std::uintmax_t zd_bytes = std::filesystem::file_size(pack);
+    auto ratio = [raw_size](const std::uintmax_t bytes){ return static_cast<double>(raw_size)/bytes; };
+    fmt::print("files: {}  raw bytes: {}\n",members.size(),raw_size);
+    fmt::print("{:<12}{:>14}{:>10}{:>14}{:>14}{:>18}\n","mode","bytes","ratio","create ms","extract ms",fmt::format("{} members ms",picks));
+    fmt::print("{:<12}{:>14}{:>10.2f}{:>14.1f}{:>14.1f}{:>18.1f}{}\n","tar.gz",gz_bytes,ratio(gz_bytes),
+        gz_create,gz_extract,gz_member,(s1&&s3&&s5) ? "" : "  (failed)");
+    fmt::print("{:<12}{:>14}{:>10.2f}{:>14.1f}{:>14.1f}{:>18.1f}{}\n","zstd+dict",zd_bytes,ratio(zd_bytes),
+        zd_create,zd_extract,zd_member,(s2&&s4&&s6) ? "" : "  (failed)");
+    return 0;
+}